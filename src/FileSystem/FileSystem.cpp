@@ -3,24 +3,166 @@
 
 FileManager* FileSystem::fm;
 BufPageManager* FileSystem::bpm;
+constinit BufConfig FileSystem::config;
+bool FileSystem::autovacuum = false;
 int FileSystem::count = 0;
 
+std::map<std::string, int>& FileSystem::quotas() {
+    static std::map<std::string, int> quotas;
+    return quotas;
+}
+
+std::map<std::string, int>& FileSystem::pageSizes() {
+    static std::map<std::string, int> pageSizes;
+    return pageSizes;
+}
+
+std::map<std::string, BufPageManager*>& FileSystem::pools() {
+    static std::map<std::string, BufPageManager*> pools;
+    return pools;
+}
+
 void FileSystem::init() {
     if (!count++) {        
         //MyBitMap::initConst();
         fm = new FileManager();
-        bpm = new BufPageManager(fm);
+        fm->setDirect(config.directIO);
+        for (auto& p : pageSizes()) fm->setPageSize(p.first, p.second);
+        bpm = new BufPageManager(fm, config);
     }
 }
 
 void FileSystem::release() {
     if (!--count) {    
+        for (auto& p : pools()) {
+            p.second->dump();
+            p.second->close();
+            delete p.second;
+        }
+        pools().clear();
+        bpm->dump();
         bpm->close();
         delete bpm;
         delete fm;
     }
 }
 
-void FileSystem::save() {
-    bpm->close();
-}
\ No newline at end of file
+BufPageManager* FileSystem::pool(const std::string& db) {
+    auto it = pools().find(db);
+    return it == pools().end() ? bpm : it->second;
+}
+
+BufPageManager* FileSystem::openPool(const std::string& db, const std::string& dumpFile, int pageIdx) {
+    auto it = pools().find(db);
+    if (it != pools().end()) return it->second;
+    BufConfig c = config;
+    // without a quota, a database with larger pages gets as many bytes as the shared pool;
+    // in its larger pages it still gets at least one shard, like any pool
+    auto quota = quotas().find(db);
+    int shift = pageIdx - PAGE_SIZE_IDX;
+    c.maxCapacity = config.maxCapacity >> shift;
+    c.capacity = std::clamp((quota == quotas().end() ? config.capacity : quota->second) >> shift, BUF_MIN_SHARD_PAGES, c.maxCapacity);
+    c.pageSizeIdx = pageIdx;
+    c.dumpFile = dumpFile;
+    // the compressed cache stays with the shared pool, a quota only counts buffer frames
+    c.tierBytes = 0;
+    return pools()[db] = new BufPageManager(fm, c);
+}
+
+void FileSystem::closePool(const std::string& db) {
+    auto it = pools().find(db);
+    if (it == pools().end()) return;
+    it->second->close();
+    delete it->second;
+    pools().erase(it);
+}
+
+// a file is cached by one pool only, but which one is not recorded; pools without its pages skip it cheaply
+void FileSystem::flushFiles(const std::string& path) {
+    for (int fileID : fm->openFilesUnder(path)) {
+        bpm->flushFile(fileID);
+        for (auto& p : pools()) p.second->flushFile(fileID);
+    }
+}
+
+void FileSystem::closeFiles(const std::string& path, bool discard) {
+    for (int fileID : fm->openFilesUnder(path)) {
+        bpm->invalidateFile(fileID, !discard);
+        for (auto& p : pools()) p.second->invalidateFile(fileID, !discard);
+        fm->closeFile(fileID);
+    }
+}
+
+void FileSystem::setPageSize(const std::string& dir, int idx) {
+    if (idx == PAGE_SIZE_IDX) pageSizes().erase(dir);
+    else pageSizes()[dir] = idx;
+    if (count) fm->setPageSize(dir, idx);
+}
+
+bool FileSystem::setOption(const std::string& key, const std::string& value) {
+    if (key == "buffer_pool_size") {
+        // a pool smaller than one shard cannot hold the pages a statement keeps pinned, see BufPageManager::minCapacity
+        int pages;
+        if (!parsePoolSize(value, pages) || pages < BUF_MIN_SHARD_PAGES || pages > config.maxCapacity) return false;
+        config.capacity = pages;
+        return true;
+    }
+    if (key == "db_buffer_pool_size") {
+        // <database>:<bytes>[K|M|G], may be given once per database
+        size_t colon = value.find(':');
+        int pages;
+        if (colon == 0 || colon == std::string::npos || !parsePoolSize(value.substr(colon + 1), pages)) return false;
+        if (pages < BUF_MIN_SHARD_PAGES || pages > config.maxCapacity) return false;
+        quotas()[value.substr(0, colon)] = pages;
+        return true;
+    }
+    if (key == "replace") return parseReplacePolicy(value, config.replace);
+    if (key == "io") return parseIOBackend(value, config.io);
+    if (key == "flusher") {
+        if (value != "on" && value != "off") return false;
+        config.flusher = value == "on";
+        return true;
+    }
+    if (key == "readahead") {
+        if (value != "on" && value != "off") return false;
+        config.readAhead = value == "on";
+        return true;
+    }
+    if (key == "hugepages") {
+        if (value != "on" && value != "off") return false;
+        config.hugePages = value == "on";
+        return true;
+    }
+    if (key == "direct") {
+        if (value != "on" && value != "off") return false;
+        config.directIO = value == "on";
+        return true;
+    }
+    if (key == "compressed_cache") {
+        int pages;
+        if (value == "0" || value == "off") {
+            config.tierBytes = 0;
+            return true;
+        }
+        if (!parsePoolSize(value, pages)) return false;
+        config.tierBytes = (long long)pages * PAGE_SIZE;
+        return true;
+    }
+    if (key == "warmup") {
+        if (value != "on" && value != "off") return false;
+        config.warmup = value == "on";
+        return true;
+    }
+    if (key == "autovacuum") {
+        if (value != "on" && value != "off") return false;
+        autovacuum = value == "on";
+        return true;
+    }
+    if (key == "warmup_interval") {
+        // seconds between dumps of the hot page list, 0 for shutdown only
+        if (value.empty() || value.size() > 6 || value.find_first_not_of("0123456789") != string::npos) return false;
+        config.dumpInterval = stoi(value);
+        return true;
+    }
+    return false;
+}
@@ -1,15 +1,44 @@
 #pragma once
 
+#include <map>
+#include <string>
+
 #include "fileio/FileManager.h"
 #include "bufmanager/BufPageManager.h"
 
 class FileSystem {
 public:
     static FileManager* fm;
+    // the shared buffer pool, used by every database without a pool of its own
     static BufPageManager* bpm;
+    // buffer pool settings, applied by init(); constant-initialized, so init() may run from constructors of globals
+    static BufConfig config;
+    // buffer pool quotas in pages of PAGE_SIZE, by database name; such a database gets its own pool
+    // (this and the maps below are function-local statics for the same reason)
+    static std::map<std::string, int>& quotas();
+    // page size exponents other than PAGE_SIZE_IDX, by directory ending with '/'
+    static std::map<std::string, int>& pageSizes();
+    // pools created for databases with a quota, by database name
+    static std::map<std::string, BufPageManager*>& pools();
+    // vacuum tables after deletes and updates leave enough dead rows, set by --autovacuum
+    static bool autovacuum;
+    // the pool caching the files of database db, the shared pool if db has none
+    static BufPageManager* pool(const std::string& db);
+    // create the pool of database db with its quota and pages of 1 << pageIdx bytes; its hot page list is kept in dumpFile
+    static BufPageManager* openPool(const std::string& db, const std::string& dumpFile, int pageIdx = PAGE_SIZE_IDX);
+    // write back and free the pool of database db, if any
+    static void closePool(const std::string& db);
     static void init();
     static void release();
-    static void save();
+    // write back the dirty pages of the open files at path (a file or a directory), keeping them cached
+    static void flushFiles(const std::string& path);
+    // drop the pages of the open files at path from the buffer and close them;
+    // with discard the dirty pages are thrown away, for files that are about to be removed
+    static void closeFiles(const std::string& path, bool discard);
+    // files opened under dir from now on have pages of 1 << idx bytes; kept for the file manager created by init()
+    static void setPageSize(const std::string& dir, int idx);
+    // set a startup option, e.g. ("replace", "clock"); returns false on unknown key or bad value
+    static bool setOption(const std::string& key, const std::string& value);
 private:
     static int count;
-};
\ No newline at end of file
+};
@@ -0,0 +1,112 @@
+#ifndef BUF_CONFIG
+#define BUF_CONFIG
+#include <ctype.h>
+#include <limits.h>
+#include <string>
+#include "FindReplace.h"
+#include "../fileio/AsyncIO.h"
+#include "../utils/pagedef.h"
+/*
+ * BufConfig
+ * 缓存管理器的启动参数
+ */
+struct BufConfig {
+	/*
+	 * 缓存页面个数，以及运行时可以扩大到的页面个数
+	 */
+	int capacity, maxCapacity;
+	int shardNum;
+	ReplacePolicy replace;
+	/*
+	 * 是否启动后台写回线程，以及它的唤醒间隔(毫秒)
+	 */
+	bool flusher;
+	int flushInterval;
+	/*
+	 * 后台写回线程保证每个分片中即将被替换的cleanReserve分之一的页面是干净的
+	 */
+	int cleanReserve;
+	/*
+	 * 写回使用的异步IO实现、队列深度和线程池的线程个数
+	 */
+	IOBackend io;
+	int ioDepth, ioWorkers;
+	/*
+	 * 是否对顺序访问做预读，以及预读窗口的上限(页)
+	 */
+	bool readAhead;
+	int readAheadMax;
+	/*
+	 * 缓存页面区是否尝试使用大页
+	 */
+	bool hugePages;
+	/*
+	 * 文件是否以O_DIRECT打开，由FileSystem交给FileManager
+	 */
+	bool directIO;
+	/*
+	 * 预热：关闭时把缓存中的页面按从热到冷的顺序记录到dumpFile，启动时在后台读回
+	 * dumpInterval(秒)大于0时还定期记录；dumpFile为空时不预热
+	 */
+	bool warmup;
+	int dumpInterval;
+	std::string dumpFile;
+	/*
+	 * 压缩缓存的字节数，为0时不使用
+	 */
+	long long tierBytes;
+	/*
+	 * 页面字节数以2为底的指数，缓存的文件的页面必须是这个大小
+	 */
+	int pageSizeIdx;
+	/*
+	 * 构造函数是constexpr，全局的BufConfig(如FileSystem::config)在任何全局对象的构造函数运行之前就已经初始化
+	 */
+	constexpr BufConfig(): capacity(CAP), maxCapacity(BUF_MAX_CAPACITY), shardNum(BUF_SHARD_NUM), replace(LRU_REPLACE),
+		flusher(true), flushInterval(BUF_FLUSH_INTERVAL), cleanReserve(BUF_CLEAN_RESERVE),
+		io(URING_IO), ioDepth(AIO_DEPTH), ioWorkers(AIO_WORKERS),
+		readAhead(true), readAheadMax(BUF_READAHEAD_MAX), hugePages(true), directIO(false),
+		warmup(true), dumpInterval(0), tierBytes(0), pageSizeIdx(PAGE_SIZE_IDX) {}
+	constexpr BufConfig(int c, int n, ReplacePolicy p): BufConfig() {
+		capacity = c;
+		shardNum = n;
+		replace = p;
+	}
+};
+/*
+ * @函数名parsePoolSize
+ * @参数value:字节数，可以带K、M、G后缀，例如"512M"
+ * @参数pages:函数返回时，记录对应的页面个数
+ * @参数pageIdx:页面字节数以2为底的指数
+ * 返回:格式正确并且至少有一个页面时返回true
+ */
+inline bool parsePoolSize(const std::string& value, int& pages, int pageIdx = PAGE_SIZE_IDX) {
+	size_t i = 0;
+	long long bytes = 0;
+	for (; i < value.size() && isdigit((unsigned char)value[i]); ++ i) {
+		bytes = bytes * 10 + (value[i] - '0');
+		if (bytes > (1LL << 50)) {
+			return false;
+		}
+	}
+	if (i == 0) {
+		return false;
+	}
+	if (i + 1 == value.size()) {
+		switch (toupper((unsigned char)value[i])) {
+			case 'K': bytes <<= 10; break;
+			case 'M': bytes <<= 20; break;
+			case 'G': bytes <<= 30; break;
+			default: return false;
+		}
+	} else if (i != value.size()) {
+		return false;
+	}
+	long long n = bytes >> pageIdx;
+	if (n < 1 || n > INT_MAX) {
+		return false;
+	}
+	pages = (int)n;
+	return true;
+}
+#endif
@@ -1,47 +1,1022 @@
 #ifndef BUF_PAGE_MANAGER
 #define BUF_PAGE_MANAGER
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BufConfig.h"
 #include "FindReplace.h"
+#include "LRUReplace.h"
+#include "ClockReplace.h"
+#include "LRUKReplace.h"
+#include "TwoQReplace.h"
+#include "FrameArena.h"
+#include "CompressedTier.h"
 #include "../utils/pagedef.h"
 #include "../fileio/FileManager.h"
+#include "../utils/PageTable.h"
 #include "../utils/MyLinkList.h"
+struct BufPageManager;
+/*
+ * BufferFullError
+ * 要读入页面时分片中所有的页面都被pin住、没有页面可以替换，由getPage、allocPage等抛出
+ * 缓存的状态不变，调用者放掉一些页面后可以重试，或者换一个更大的缓存
+ */
+struct BufferFullError : std::runtime_error {
+	BufferFullError() : std::runtime_error("All pages in buffer shard are pinned, the buffer pool is too small") {}
+};
+/*
+ * BufRing
+ * 大表顺序扫描使用的私有环形缓存
+ * 扫描中没有命中的页面只读进环里的页面，环满后原地复用最早的页面，
+ * 命中和复用都不通知替换算法，因此扫描大表不会把缓存中的热点页面挤出去
+ * 环里的页面按分片划分，每个分片最多perShard个
+ */
+struct BufRing {
+	struct Slot {
+		int local, fileID, pageID;
+	};
+	int perShard;
+	std::vector<std::vector<Slot>> slots;
+	std::vector<int> pos;
+	BufRing(int size, int shardNum)
+		: perShard(std::max((size + shardNum - 1) / shardNum, 1)), slots(shardNum), pos(shardNum, 0) {}
+};
+/*
+ * PageGuard
+ * 持有一个被pin住的缓存页面，析构时自动unpin
+ * pin住的页面不会被替换算法选中，因此guard存在期间页面首地址一直有效
+ */
+class PageGuard {
+private:
+	BufPageManager* bpm;
+	int index;
+	BufType data;
+public:
+	int fileID, pageID;
+	PageGuard(): bpm(NULL), index(-1), data(NULL), fileID(-1), pageID(-1) {}
+	PageGuard(BufPageManager* bpm, int index, BufType data, int fileID, int pageID)
+		: bpm(bpm), index(index), data(data), fileID(fileID), pageID(pageID) {}
+	PageGuard(const PageGuard&) = delete;
+	PageGuard& operator=(const PageGuard&) = delete;
+	PageGuard(PageGuard&& other) noexcept: PageGuard() {
+		*this = std::move(other);
+	}
+	PageGuard& operator=(PageGuard&& other) noexcept;
+	~PageGuard() {
+		release();
+	}
+	/*
+	 * @函数名release
+	 * 功能:提前unpin页面，之后guard不再持有任何页面
+	 */
+	void release();
+	/*
+	 * @函数名markDirty
+	 * 功能:标记guard持有的页面被写过
+	 */
+	void markDirty();
+	bool holds(int f, int p) const {
+		return bpm != NULL && fileID == f && pageID == p;
+	}
+	BufType get() const {
+		return data;
+	}
+	int getIndex() const {
+		return index;
+	}
+};
 /*
  * BufPageManager
  * 实现了一个缓存的管理器
+ * 缓存页面按(fileID,pageID)划分到shardNum个分片中，每个分片有自己的hash表、替换算法和锁，
+ * 因此多个线程可以同时调用getPage、markDirty等函数
+ * 缓存页面数组的下标index与分片的对应关系为：index = 分片内下标 * shardNum + 分片号
+ * 后台写回线程定期把每个分片中即将被替换的脏页按文件页的顺序写回，使替换时尽量不需要同步写磁盘
+ * 预读：通过getPageGuard顺序访问文件时，提前为后面的页面分配缓存页面，由预读线程异步读入，
+ * 窗口从BUF_READAHEAD_MIN开始每次翻倍，直到readAheadMax；读入完成之前访问这些页面的线程会等待
+ * 内存映射：FileManager映射了的页面直接返回映射中的地址，不占用缓存页面，
+ * 这些页面的下标是负数(见mapIndex)，pin、access对它们没有作用，被标记为脏页的页面在flush、close时用msync写回
+ * 按文件操作：flushFile、invalidateFile通过每个分片中的文件页面链表只处理一个文件的页面，不影响其他文件的缓存
+ * 压缩缓存：被替换出去的干净页面(脏页写回之后)压缩后放进分片的CompressedTier，没有命中时先在其中查找，
+ * 环形缓存中的页面不放入
+ * 预热：dump把缓存中的页面按从热到冷的顺序以(文件名,页号)记录下来，下次启动时预热线程按文件页的顺序
+ * 分批读回最热的capacity个页面，读回期间缓存照常使用
  */
 struct BufPageManager {
 public:
-	int last;
+	struct Shard {
+		mutex latch;
+		int last;
+		/*
+		 * 分片内每个页面被pin的次数，按分片内下标存放
+		 */
+		int* pin;
+		PageTable* hash;
+		/*
+		 * 每个文件在分片中的页面组成的链表，第fileID个链表中是该文件的页面的分片内下标
+		 * 与hash表同时修改，用于flushFile、invalidateFile只处理一个文件的页面
+		 */
+		MyLinkList* files;
+		FindReplace* replace;
+		/*
+		 * 页面是否由环形缓存读入并且之后没有被普通访问过，按分片内下标存放
+		 */
+		bool* ring;
+		/*
+		 * 页面是否正在被预读线程读入，按分片内下标存放，读完后通过loaded通知等待的线程
+		 */
+		bool* loading;
+		condition_variable loaded;
+		/*
+		 * getPage命中与未命中的次数，替换脏页时同步写回的次数
+		 */
+		long long hits, misses, evictWrites;
+		/*
+		 * 预读的页面数，以及访问时页面还没有读完需要等待的次数
+		 */
+		long long prefetched, prefetchWaits;
+		/*
+		 * 访问次数，每BUF_TICK_ACCESSES次把tick加一
+		 */
+		unsigned accesses;
+		/*
+		 * 压缩缓存，不使用时为NULL；在其中找到和没有找到页面的次数
+		 */
+		CompressedTier* tier;
+		long long tierHits, tierMisses;
+	};
+	/*
+	 * 每个文件的顺序访问状态，按fileID存放，各自由latch保护，不同文件的访问互不等待
+	 * active:文件打开以来被访问过
+	 * last:上一次访问的页号 run:连续顺序访问的次数 window:当前预读窗口 next:第一个还没有预读的页号
+	 */
+	struct SeqState {
+		mutex latch;
+		bool active;
+		int last, run, window, next;
+		bool advised;
+	};
+	struct FlushItem {
+		int fileID, pageID, index;
+		bool operator<(const FlushItem& other) const {
+			return fileID != other.fileID ? fileID < other.fileID : pageID < other.pageID;
+		}
+	};
+	/*
+	 * capacity可以在运行时用resize修改，不超过maxCapacity
+	 * 下标的编码保证缓存页面正好是[0, capacity)，扩大、缩小时已有页面的下标不变
+	 */
+	int capacity, maxCapacity, shardNum;
+	/*
+	 * 页面字节数以2为底的指数，缓存的文件的页面都是这个大小
+	 */
+	int pageIdx;
+	ReplacePolicy policy;
+	int flushInterval, cleanReserve;
+	thread flusher;
+	/*
+	 * flushLatch保护flushStop，flushPass保证同一时间只有一轮写回
+	 */
+	mutex flushLatch, flushPass;
+	condition_variable flushCond;
+	bool flushStop;
+	atomic<bool> flushWanted;
+	/*
+	 * 写回使用的异步IO，在flushPass的保护下使用，为NULL时同步写
+	 */
+	AsyncIO* aio;
+	/*
+	 * 后台及close写回的页面数和请求次数
+	 */
+	atomic<long long> flushedPages, flushCalls;
+	/*
+	 * 被修改过、还没有msync的映射页面，由mapLatch保护
+	 */
+	mutex mapLatch;
+	set<pair<int, int>> mapDirty;
+	atomic<long long> mapAccesses, mapSyncs;
+	/*
+	 * 预读：readAio为NULL时只向内核提示POSIX_FADV_WILLNEED
+	 * 预读线程每次从prefetchQueue中取出一批已经分配好缓存页面的请求
+	 */
+	bool readAhead;
+	int readAheadMax;
+	SeqState* seqStates;
+	AsyncIO* readAio;
+	thread prefetcher;
+	mutex prefetchLatch;
+	condition_variable prefetchCond, prefetchIdle;
+	deque<vector<FlushItem>> prefetchQueue;
+	bool prefetchBusy, prefetchStop;
+	/*
+	 * 预热：dumpFile为空时不预热；dumper线程每dumpInterval秒调用一次dump，dumpPass保证同一时间只有一次dump
+	 * warmLatch保证预热的一批页面与invalidateFile、resize不会交错
+	 */
+	string dumpFile;
+	int dumpInterval;
+	thread warmer, dumper;
+	mutex warmLatch, dumpLatch, dumpPass;
+	condition_variable dumpCond;
+	atomic<bool> warmStop;
+	bool dumpStop;
+	atomic<long long> warmLoaded, warmTotal;
 	FileManager* fileManager;
-	MyHashMap* hash;
-	FindReplace* replace;
-	//MyLinkList* bpl;
+	Shard* shards;
 	bool* dirty;
 	/*
-	 * 缓存页面数组
+	 * stamp[index]:页面最后一次被访问时的tick，dump时用来比较不同分片中页面的冷热
+	 * tick在读入页面时加一，命中时每个分片每BUF_TICK_ACCESSES次才加一，避免每次访问都修改共享的计数
+	 */
+	unsigned* stamp;
+	atomic<unsigned> tick;
+	/*
+	 * 缓存页面区，下标为index的页面是arena->frame(index)
+	 */
+	FrameArena* arena;
+	int shardOf(int fileID, int pageID) {
+		uint h = (uint)fileID * 0x9E3779B1u ^ (uint)pageID * 0x85EBCA77u;
+		h ^= h >> 15;
+		return h % shardNum;
+	}
+	int toIndex(int shardID, int local) {
+		return local * shardNum + shardID;
+	}
+	int toLocal(int index) {
+		return index / shardNum;
+	}
+	Shard& shardOfIndex(int index) {
+		return shards[index % shardNum];
+	}
+	int shardCapacity(int shardID) {
+		return (capacity - shardID + shardNum - 1) / shardNum;
+	}
+	FindReplace* newReplace(int c, const int* pin) {
+		switch (policy) {
+			case CLOCK_REPLACE: return new ClockReplace(c, pin);
+			case LRU2_REPLACE: return new LRUKReplace(c, pin);
+			case TWO_Q_REPLACE: return new TwoQReplace(c, pin);
+			default: return new LRUReplace(c, pin);
+		}
+	}
+	/*
+	 * 以下划线开头的函数要求调用者已经持有对应分片的锁
+	 * _bind、_unbind同时修改hash表和文件页面链表
+	 */
+	void _bind(Shard& s, int local, int fileID, int pageID) {
+		s.hash->replace(local, fileID, pageID);
+		s.files->insert(fileID, local);
+	}
+	void _unbind(Shard& s, int local) {
+		s.hash->remove(local);
+		s.files->del(local);
+		s.ring[local] = false;
+	}
+	BufType _loadFrame(Shard& s, int index, int typeID, int pageID) {
+		BufType b = arena->frame(index);
+		int k1, k2;
+		s.hash->getKeys(toLocal(index), k1, k2);
+		if (dirty[index]) {
+			fileManager->writePage(k1, k2, b, 0);
+			dirty[index] = false;
+			++s.evictWrites;
+			_wakeFlusher();
+		}
+		if (s.tier != NULL && k1 != -1 && !s.ring[toLocal(index)]) {
+			s.tier->put(k1, k2, b);
+		}
+		_bind(s, toLocal(index), typeID, pageID);
+		s.ring[toLocal(index)] = false;
+		stamp[index] = tick.fetch_add(1, memory_order_relaxed);
+		return b;
+	}
+	/*
+	 * 把没有命中的页面读进b：先在压缩缓存中查找，找不到时读文件
+	 */
+	void _readFrame(Shard& s, int fileID, int pageID, BufType b) {
+		if (s.tier != NULL) {
+			if (s.tier->take(fileID, pageID, b)) {
+				++s.tierHits;
+				return;
+			}
+			++s.tierMisses;
+		}
+		fileManager->readPage(fileID, pageID, b, 0);
+	}
+	int _findVictim(Shard& s) {
+		int local = s.replace->find();
+		if (local == -1) {
+			_noFrame();
+		}
+		return local;
+	}
+	void _noFrame() {
+		throw BufferFullError();
+	}
+	/*
+	 * 在hash表中查找页面，页面正在被预读时等待读完
+	 */
+	int _lookup(Shard& s, unique_lock<mutex>& lock, int fileID, int pageID) {
+		while (true) {
+			int local = s.hash->findIndex(fileID, pageID);
+			if (local == -1 || !s.loading[local]) {
+				return local;
+			}
+			++s.prefetchWaits;
+			s.loaded.wait(lock);
+		}
+	}
+	BufType _fetchPage(int shardID, int typeID, int pageID, int& index) {
+		Shard& s = shards[shardID];
+		int local = _findVictim(s);
+		index = toIndex(shardID, local);
+		BufType b = _loadFrame(s, index, typeID, pageID);
+		s.replace->load(local, ((long long)typeID << 32) | (uint)pageID);
+		return b;
+	}
+	void _access(Shard& s, int index) {
+		s.ring[toLocal(index)] = false;
+		if (++s.accesses % BUF_TICK_ACCESSES == 0) {
+			tick.fetch_add(1, memory_order_relaxed);
+		}
+		stamp[index] = tick.load(memory_order_relaxed);
+		if (index == s.last) {
+			return;
+		}
+		s.replace->access(toLocal(index));
+		s.last = index;
+	}
+	void _writeBack(Shard& s, int index) {
+		if (dirty[index]) {
+			int f, p;
+			s.hash->getKeys(toLocal(index), f, p);
+			fileManager->writePage(f, p, arena->frame(index), 0);
+			dirty[index] = false;
+		}
+		// pin住的页面只写回，不归还
+		if (s.pin[toLocal(index)] > 0) {
+			return;
+		}
+		s.replace->free(toLocal(index));
+		_unbind(s, toLocal(index));
+	}
+	BufType _allocPage(int shardID, unique_lock<mutex>& lock, int fileID, int pageID, int& index, bool ifRead) {
+		Shard& s = shards[shardID];
+		index = _lookup(s, lock, fileID, pageID);
+		if (index != -1) {
+			index = toIndex(shardID, index);
+			_access(s, index);
+			return arena->frame(index);
+		}
+		BufType b = _fetchPage(shardID, fileID, pageID, index);
+		if (ifRead) {
+			_readFrame(s, fileID, pageID, b);
+		} else if (s.tier != NULL) {
+			// 页面将被改写
+			s.tier->erase(fileID, pageID);
+		}
+		return b;
+	}
+	BufType _getPage(int shardID, unique_lock<mutex>& lock, int fileID, int pageID, int& index) {
+		Shard& s = shards[shardID];
+		index = _lookup(s, lock, fileID, pageID);
+		if (index != -1) {
+			++s.hits;
+			index = toIndex(shardID, index);
+			_access(s, index);
+			return arena->frame(index);
+		}
+		++s.misses;
+		BufType b = _fetchPage(shardID, fileID, pageID, index);
+		_readFrame(s, fileID, pageID, b);
+		return b;
+	}
+	/*
+	 * pin住脏页并清除脏页标记，放进items等待写回
+	 * 写回期间页面如果被修改，会重新被标记为脏页
+	 */
+	void _collect(Shard& s, int index, vector<FlushItem>& items) {
+		int f, p;
+		s.hash->getKeys(toLocal(index), f, p);
+		++s.pin[toLocal(index)];
+		dirty[index] = false;
+		items.push_back(FlushItem{f, p, index});
+	}
+	/*
+	 * 以下函数不要求持有分片的锁，但要求持有flushPass
+	 * _writeSorted按(fileID,pageID)排序后写回items，文件中相邻的页面合并成一个向量写请求，
+	 * 所有请求一起交给异步IO，写完后unpin
 	 */
-	BufType* addr;
-	BufType allocMem() {
-		return new unsigned int[(PAGE_SIZE >> 2)];
+	void _writeSorted(vector<FlushItem>& items) {
+		sort(items.begin(), items.end());
+		vector<struct iovec> iov(items.size());
+		vector<IORequest> reqs;
+		vector<size_t> starts;
+		for (size_t i = 0, j; i < items.size(); i = j) {
+			for (j = i; j < items.size() && j - i < IOV_MAX && items[j].fileID == items[i].fileID
+					&& items[j].pageID == items[i].pageID + (int)(j - i); ++ j) {
+				iov[j].iov_base = arena->frame(items[j].index);
+				iov[j].iov_len = (size_t)1 << pageIdx;
+			}
+			reqs.emplace_back();
+			fileManager->pageRequest(reqs.back(), items[i].fileID, items[i].pageID, &iov[i], j - i, true);
+			starts.push_back(i);
+		}
+		if (aio != NULL) {
+			vector<IORequest*> ptrs;
+			for (IORequest& req : reqs) {
+				if (req.fd != -1) {
+					ptrs.push_back(&req);
+				}
+			}
+			aio->submit(ptrs.data(), ptrs.size());
+			aio->wait();
+		}
+		for (size_t k = 0; k < reqs.size(); ++ k) {
+			// 同步写，或者异步写失败、只写了一部分时重新同步写；压缩的文件的请求没有提交，在这里压缩后写
+			if (aio == NULL || reqs[k].result != (ssize_t)reqs[k].iovcnt << pageIdx) {
+				vector<BufType> bufs;
+				for (int j = 0; j < reqs[k].iovcnt; ++ j) {
+					bufs.push_back((BufType)reqs[k].iov[j].iov_base);
+				}
+				const FlushItem& first = items[starts[k]];
+				fileManager->writePages(first.fileID, first.pageID, bufs.data(), bufs.size());
+			}
+		}
+		flushCalls += reqs.size();
+		flushedPages += items.size();
+		for (const FlushItem& item : items) {
+			unpin(item.index);
+		}
 	}
-	BufType fetchPage(int typeID, int pageID, int& index) {
-		BufType b;
-		index = replace->find();
-		b = addr[index];
-		if (b == NULL) {
-			b = allocMem();
-			addr[index] = b;
+	/*
+	 * 从mapDirty中取出文件fileID的页面，fileID为-1时取出所有页面
+	 */
+	set<pair<int, int>> _takeMapped(int fileID) {
+		set<pair<int, int>> pages;
+		lock_guard<mutex> guard(mapLatch);
+		if (fileID == -1) {
+			pages.swap(mapDirty);
 		} else {
-			if (dirty[index]) {
-				int k1, k2;
-				hash->getKeys(index, k1, k2);
-				fileManager->writePage(k1, k2, b, 0);
-				dirty[index] = false;
+			auto from = mapDirty.lower_bound(make_pair(fileID, INT_MIN));
+			auto to = mapDirty.lower_bound(make_pair(fileID + 1, INT_MIN));
+			pages.insert(from, to);
+			mapDirty.erase(from, to);
+		}
+		return pages;
+	}
+	/*
+	 * 把被修改过的映射页面按(fileID,pageID)的顺序msync，相邻的页面合并
+	 * fileID不为-1时只处理该文件的页面
+	 */
+	void _syncMapped(int fileID = -1) {
+		set<pair<int, int>> pages = _takeMapped(fileID);
+		for (auto it = pages.begin(); it != pages.end(); ) {
+			int fileID = it->first, pageID = it->second, n = 0;
+			for (; it != pages.end() && it->first == fileID && it->second == pageID + n; ++ it, ++ n);
+			fileManager->syncPages(fileID, pageID, n);
+			++mapSyncs;
+		}
+	}
+	/*
+	 * (fileID,pageID)被映射时返回映射中的地址并在index中记录编码后的下标，否则返回NULL
+	 */
+	BufType _mapped(int fileID, int pageID, int& index) {
+		BufType b = fileManager->mapPage(fileID, pageID);
+		if (b != NULL) {
+			index = mapIndex(fileID, pageID);
+			++mapAccesses;
+		}
+		return b;
+	}
+	void _flushFile(int fileID) {
+		_syncMapped(fileID);
+		vector<FlushItem> items;
+		for (int i = 0; i < shardNum; ++ i) {
+			Shard& s = shards[i];
+			lock_guard<mutex> guard(s.latch);
+			for (int local = s.files->getFirst(fileID); !s.files->isHead(local); local = s.files->next(local)) {
+				int index = toIndex(i, local);
+				if (dirty[index]) {
+					_collect(s, index, items);
+				}
+			}
+		}
+		_writeSorted(items);
+	}
+	void _flush() {
+		_syncMapped();
+		vector<FlushItem> items;
+		for (int i = 0; i < shardNum; ++ i) {
+			lock_guard<mutex> guard(shards[i].latch);
+			for (int j = i; j < capacity; j += shardNum) {
+				if (dirty[j]) {
+					_collect(shards[i], j, items);
+				}
+			}
+		}
+		_writeSorted(items);
+	}
+	void _cleanPass() {
+		vector<FlushItem> items;
+		vector<int> victims;
+		for (int i = 0; i < shardNum; ++ i) {
+			Shard& s = shards[i];
+			lock_guard<mutex> guard(s.latch);
+			victims.clear();
+			s.replace->peek(max(shardCapacity(i) / cleanReserve, 1), victims);
+			for (int local : victims) {
+				int index = toIndex(i, local);
+				if (dirty[index] && s.pin[local] == 0) {
+					_collect(s, index, items);
+				}
+			}
+		}
+		_writeSorted(items);
+	}
+	void _wakeFlusher() {
+		if (flusher.joinable() && !flushWanted.exchange(true)) {
+			flushCond.notify_one();
+		}
+	}
+	void _flusherLoop() {
+		unique_lock<mutex> lock(flushLatch);
+		while (!flushStop) {
+			flushCond.wait_for(lock, chrono::milliseconds(flushInterval), [this]() {
+				return flushStop || flushWanted.load();
+			});
+			if (flushStop) {
+				break;
+			}
+			flushWanted = false;
+			lock.unlock();
+			{
+				lock_guard<mutex> pass(flushPass);
+				_cleanPass();
+			}
+			lock.lock();
+		}
+	}
+	/*
+	 * 为ring挑选下一个页面：原地复用最早的页面，或者从缓存中另取一个页面放进环里
+	 * 没有可用的页面时返回-1
+	 */
+	int _ringFrame(Shard& s, int shardID, BufRing* ring, int fileID, int pageID) {
+		vector<BufRing::Slot>& slots = ring->slots[shardID];
+		int& pos = ring->pos[shardID];
+		if ((int)slots.size() < ring->perShard) {
+			int local = s.replace->find();
+			if (local == -1) {
+				return -1;
+			}
+			slots.push_back(BufRing::Slot{local, fileID, pageID});
+			pos = slots.size() - 1;
+		} else {
+			pos = (pos + 1) % ring->perShard;
+			BufRing::Slot& slot = slots[pos];
+			int f = -1, p = -1;
+			// 缓存缩小后页面可能已经不存在
+			bool valid = slot.local < shardCapacity(shardID);
+			if (valid) {
+				s.hash->getKeys(slot.local, f, p);
+			}
+			// 页面被别人访问过、正在使用或者已经被替换掉时，从缓存中另取一个页面放进环里
+			if (!valid || !s.ring[slot.local] || s.pin[slot.local] > 0 || f != slot.fileID || p != slot.pageID) {
+				int local = s.replace->find();
+				if (local == -1) {
+					return -1;
+				}
+				slot.local = local;
 			}
+			slot.fileID = fileID;
+			slot.pageID = pageID;
+		}
+		return slots[pos].local;
+	}
+	BufType _getRingPage(int shardID, unique_lock<mutex>& lock, int fileID, int pageID, int& index, BufRing* ring) {
+		Shard& s = shards[shardID];
+		int local = _lookup(s, lock, fileID, pageID);
+		if (local != -1) {
+			++s.hits;
+			index = toIndex(shardID, local);
+			return arena->frame(index);
+		}
+		++s.misses;
+		local = _ringFrame(s, shardID, ring, fileID, pageID);
+		if (local == -1) {
+			_noFrame();
 		}
-		hash->replace(index, typeID, pageID);
+		index = toIndex(shardID, local);
+		BufType b = _loadFrame(s, index, fileID, pageID);
+		s.ring[local] = true;
+		_readFrame(s, fileID, pageID, b);
 		return b;
 	}
+	/*
+	 * 为预读的页面分配缓存页面，pin住并标记为正在读入
+	 * 页面已经在缓存或压缩缓存中，或者没有可用的页面时返回-1
+	 */
+	int _reserve(int shardID, int fileID, int pageID, BufRing* ring) {
+		Shard& s = shards[shardID];
+		if (s.hash->findIndex(fileID, pageID) != -1 || (s.tier != NULL && s.tier->contains(fileID, pageID))) {
+			return -1;
+		}
+		int local = ring != NULL ? _ringFrame(s, shardID, ring, fileID, pageID) : s.replace->find();
+		if (local == -1) {
+			return -1;
+		}
+		int index = toIndex(shardID, local);
+		_loadFrame(s, index, fileID, pageID);
+		if (ring != NULL) {
+			s.ring[local] = true;
+		} else {
+			s.replace->load(local, ((long long)fileID << 32) | (uint)pageID);
+		}
+		s.loading[local] = true;
+		++s.pin[local];
+		return index;
+	}
+	/*
+	 * 在调用者的线程中为pages分配缓存页面，交给预读线程读入
+	 */
+	void _prefetch(int fileID, const vector<int>& pages, BufRing* ring) {
+		if (readAio == NULL) {
+			for (int pageID : pages) {
+				fileManager->advise(fileID, pageID, 1, POSIX_FADV_WILLNEED);
+			}
+			return;
+		}
+		vector<FlushItem> items;
+		for (int pageID : pages) {
+			if (fileManager->mapPage(fileID, pageID) != NULL) {
+				continue;
+			}
+			int shardID = shardOf(fileID, pageID);
+			lock_guard<mutex> guard(shards[shardID].latch);
+			int index = _reserve(shardID, fileID, pageID, ring);
+			if (index != -1) {
+				items.push_back(FlushItem{fileID, pageID, index});
+			}
+		}
+		if (!items.empty()) {
+			lock_guard<mutex> guard(prefetchLatch);
+			prefetchQueue.push_back(move(items));
+			prefetchCond.notify_one();
+		}
+	}
+	/*
+	 * 记录一次对(fileID,pageID)的访问，顺序访问时预读后面的页面
+	 * 环形缓存的扫描预读到环里，窗口不超过环的一半
+	 */
+	void _readAhead(int fileID, int pageID, BufRing* ring) {
+		if (!readAhead) {
+			return;
+		}
+		int from, to;
+		bool advise = false;
+		{
+			SeqState& st = seqStates[fileID];
+			lock_guard<mutex> guard(st.latch);
+			if (!st.active) {
+				st.active = true;
+				st.last = pageID;
+				st.run = 0;
+				st.window = BUF_READAHEAD_MIN;
+				st.next = pageID + 1;
+				st.advised = false;
+				return;
+			}
+			if (pageID == st.last) {
+				return;
+			}
+			if (pageID != st.last + 1) {
+				st.run = 0;
+				st.window = BUF_READAHEAD_MIN;
+				st.next = pageID + 1;
+				st.last = pageID;
+				return;
+			}
+			st.last = pageID;
+			// 连续两次顺序访问之后才开始预读，剩下的已预读页面不到半个窗口时再预读一个窗口
+			if (++st.run < 2 || st.next - pageID > st.window / 2) {
+				return;
+			}
+			int window = st.window;
+			if (ring != NULL) {
+				window = min(window, max(ring->perShard * shardNum / 2, 1));
+			}
+			from = max(st.next, pageID + 1);
+			to = pageID + 1 + window;
+			advise = !st.advised;
+			st.advised = true;
+			st.window = min(st.window * 2, readAheadMax);
+			st.next = max(to, st.next);
+		}
+		// 查询文件大小和提示内核都是系统调用，在锁外进行
+		if (advise) {
+			fileManager->advise(fileID, 0, 0, POSIX_FADV_SEQUENTIAL);
+		}
+		to = min(to, fileManager->getPageNum(fileID));
+		if (from >= to) {
+			return;
+		}
+		vector<int> pages;
+		for (int p = from; p < to; ++ p) {
+			pages.push_back(p);
+		}
+		_prefetch(fileID, pages, ring);
+	}
+	/*
+	 * 预读线程：读入一批页面，相邻的页面合并成一个请求；读失败的页面从缓存中去掉，之后访问时重新读
+	 */
+	void _readBatch(vector<FlushItem>& items) {
+		sort(items.begin(), items.end());
+		vector<struct iovec> iov(items.size());
+		vector<IORequest> reqs;
+		vector<size_t> starts;
+		for (size_t i = 0, j; i < items.size(); i = j) {
+			for (j = i; j < items.size() && j - i < IOV_MAX && items[j].fileID == items[i].fileID
+					&& items[j].pageID == items[i].pageID + (int)(j - i); ++ j) {
+				iov[j].iov_base = arena->frame(items[j].index);
+				iov[j].iov_len = (size_t)1 << pageIdx;
+			}
+			reqs.emplace_back();
+			fileManager->pageRequest(reqs.back(), items[i].fileID, items[i].pageID, &iov[i], j - i, false);
+			starts.push_back(i);
+		}
+		vector<IORequest*> ptrs;
+		for (IORequest& req : reqs) {
+			if (req.fd != -1) {
+				ptrs.push_back(&req);
+			}
+		}
+		readAio->submit(ptrs.data(), ptrs.size());
+		// 压缩的文件在预读线程中同步读出并解压
+		for (size_t k = 0; k < reqs.size(); ++ k) {
+			if (reqs[k].fd == -1) {
+				vector<BufType> bufs;
+				for (int j = 0; j < reqs[k].iovcnt; ++ j) {
+					bufs.push_back((BufType)reqs[k].iov[j].iov_base);
+				}
+				const FlushItem& first = items[starts[k]];
+				bool ok = fileManager->readPages(first.fileID, first.pageID, bufs.data(), bufs.size()) == 0;
+				reqs[k].result = ok ? reqs[k].iovcnt << pageIdx : -EIO;
+			}
+		}
+		readAio->wait();
+		for (size_t k = 0; k < reqs.size(); ++ k) {
+			int got = reqs[k].result < 0 ? 0 : reqs[k].result >> pageIdx;
+			for (int j = 0; j < reqs[k].iovcnt; ++ j) {
+				int index = items[starts[k] + j].index;
+				Shard& s = shardOfIndex(index);
+				lock_guard<mutex> guard(s.latch);
+				int local = toLocal(index);
+				if (j >= got) {
+					s.replace->free(local);
+					_unbind(s, local);
+				} else {
+					++s.prefetched;
+				}
+				s.loading[local] = false;
+				--s.pin[local];
+				s.loaded.notify_all();
+			}
+		}
+	}
+	void _prefetchLoop() {
+		unique_lock<mutex> lock(prefetchLatch);
+		while (true) {
+			prefetchCond.wait(lock, [this]() { return prefetchStop || !prefetchQueue.empty(); });
+			if (prefetchQueue.empty()) {
+				return;
+			}
+			vector<FlushItem> items = move(prefetchQueue.front());
+			prefetchQueue.pop_front();
+			prefetchBusy = true;
+			lock.unlock();
+			_readBatch(items);
+			lock.lock();
+			prefetchBusy = false;
+			prefetchIdle.notify_all();
+		}
+	}
+	/*
+	 * 等待所有预读完成
+	 */
+	void _drainPrefetch() {
+		unique_lock<mutex> lock(prefetchLatch);
+		prefetchIdle.wait(lock, [this]() { return prefetchQueue.empty() && !prefetchBusy; });
+	}
+	/*
+	 * 按从热到冷的顺序返回缓存中的页面：按stamp从大到小，stamp相同时按替换算法中的顺序
+	 * 替换算法peek给出的顺序是从冷到热，没有给出的页面(例如CLOCK中引用标记为1的)最热
+	 */
+	vector<pair<int, int>> _hotPages() {
+		struct HotPage {
+			unsigned stamp;
+			int rank, fileID, pageID;
+		};
+		vector<HotPage> hot;
+		for (int i = 0; i < shardNum; ++ i) {
+			Shard& s = shards[i];
+			lock_guard<mutex> guard(s.latch);
+			int sc = shardCapacity(i);
+			vector<int> order;
+			s.replace->peek(sc, order);
+			vector<int> rank(sc, 0);
+			for (int k = 0; k < (int)order.size(); ++ k) {
+				if (order[k] < sc) {
+					rank[order[k]] = max(rank[order[k]], (int)order.size() - k);
+				}
+			}
+			for (int local = 0; local < sc; ++ local) {
+				int f, p;
+				s.hash->getKeys(local, f, p);
+				if (f != -1 && !s.loading[local]) {
+					hot.push_back(HotPage{stamp[toIndex(i, local)], rank[local], f, p});
+				}
+			}
+		}
+		sort(hot.begin(), hot.end(), [](const HotPage& a, const HotPage& b) {
+			return a.stamp != b.stamp ? a.stamp > b.stamp : a.rank < b.rank;
+		});
+		vector<pair<int, int>> pages;
+		for (const HotPage& h : hot) {
+			pages.push_back(make_pair(h.fileID, h.pageID));
+		}
+		return pages;
+	}
+	/*
+	 * 读入预热的一批页面，有预读线程时交给它读并等待读完，否则同步读
+	 * 已经在缓存中的页面不重新读
+	 */
+	void _warmBatch(int fileID, const vector<int>& pages) {
+		if (readAio != NULL) {
+			_prefetch(fileID, pages, NULL);
+			_drainPrefetch();
+		} else {
+			for (int pageID : pages) {
+				int index;
+				try {
+					allocPage(fileID, pageID, index, true);
+				} catch (const BufferFullError&) {
+					// 页面都被语句pin住时不再预热这一批，语句照常进行
+					break;
+				}
+			}
+		}
+		warmLoaded += pages.size();
+	}
+	/*
+	 * 预热线程：读出dumpFile中最热的capacity个页面，按(文件名,页号)排序后每次读入同一个文件中的至多BUF_READAHEAD_MAX个页面
+	 * 每一批都按文件名重新打开文件，已经不存在的文件和页面跳过
+	 */
+	void _warmLoop() {
+		FILE* f = fopen(dumpFile.c_str(), "r");
+		if (f == NULL) {
+			return;
+		}
+		vector<pair<string, int>> pages;
+		char line[4096], name[4096];
+		int pageID;
+		while ((int)pages.size() < capacity && fgets(line, sizeof(line), f) != NULL) {
+			if (sscanf(line, "%d %4095[^\n]", &pageID, name) == 2 && pageID >= 0) {
+				pages.push_back(make_pair(string(name), pageID));
+			}
+		}
+		fclose(f);
+		sort(pages.begin(), pages.end());
+		pages.erase(unique(pages.begin(), pages.end()), pages.end());
+		warmTotal = pages.size();
+		for (size_t i = 0, j; i < pages.size() && !warmStop; i = j) {
+			for (j = i; j < pages.size() && j - i < BUF_READAHEAD_MAX && pages[j].first == pages[i].first; ++ j);
+			lock_guard<mutex> guard(warmLatch);
+			int fileID;
+			// 页面大小不同的文件由别的缓存读回
+			if (!fileManager->openFile(pages[i].first.c_str(), fileID) || fileManager->getPageSizeIdx(fileID) != pageIdx) {
+				continue;
+			}
+			int n = fileManager->getPageNum(fileID);
+			vector<int> batch;
+			for (size_t k = i; k < j; ++ k) {
+				if (pages[k].second < n) {
+					batch.push_back(pages[k].second);
+				}
+			}
+			_warmBatch(fileID, batch);
+		}
+	}
+	void _dumpLoop() {
+		unique_lock<mutex> lock(dumpLatch);
+		while (!dumpCond.wait_for(lock, chrono::seconds(dumpInterval), [this]() { return dumpStop; })) {
+			lock.unlock();
+			dump();
+			lock.lock();
+		}
+	}
+	/*
+	 * 停止预热线程和定期dump的线程
+	 */
+	void _stopWarmup() {
+		warmStop = true;
+		if (warmer.joinable()) {
+			warmer.join();
+		}
+		if (dumper.joinable()) {
+			{
+				lock_guard<mutex> lock(dumpLatch);
+				dumpStop = true;
+			}
+			dumpCond.notify_one();
+			dumper.join();
+		}
+	}
+	/*
+	 * 把分片i的页面个数从oldSc改为sc，调用者持有所有分片的锁，并且第sc个之后的页面都已经空出
+	 * hash表和替换算法按新的大小重建，原有页面按替换算法原来的顺序放回
+	 */
+	void _resizeShard(int i, int oldSc, int sc) {
+		Shard& s = shards[i];
+		int keep = min(oldSc, sc);
+		int* pin = new int[sc]();
+		bool* ring = new bool[sc]();
+		bool* loading = new bool[sc]();
+		copy(s.pin, s.pin + keep, pin);
+		copy(s.ring, s.ring + keep, ring);
+		copy(s.loading, s.loading + keep, loading);
+		PageTable* hash = new PageTable(sc);
+		MyLinkList* files = new MyLinkList(sc, MAX_FILE_NUM);
+		FindReplace* replace = newReplace(sc, pin);
+		// peek按最先被替换的顺序给出页面，没有给出的页面(例如CLOCK中引用标记为1的)更晚被替换
+		vector<int> order;
+		s.replace->peek(oldSc, order);
+		vector<bool> listed(keep, false);
+		vector<int> restoreOrder;
+		for (int local : order) {
+			if (local < keep && !listed[local]) {
+				listed[local] = true;
+				restoreOrder.push_back(local);
+			}
+		}
+		for (int local = 0; local < keep; ++ local) {
+			if (!listed[local]) {
+				restoreOrder.push_back(local);
+			}
+		}
+		vector<bool> used(sc, false);
+		for (int local : restoreOrder) {
+			int f, p;
+			s.hash->getKeys(local, f, p);
+			if (f == -1) {
+				continue;
+			}
+			hash->replace(local, f, p);
+			files->insert(f, local);
+			replace->restore(local, ((long long)f << 32) | (uint)p);
+			used[local] = true;
+		}
+		for (int local = 0; local < sc; ++ local) {
+			if (!used[local]) {
+				replace->free(local);
+			}
+		}
+		delete[] s.pin;
+		delete[] s.ring;
+		delete[] s.loading;
+		delete s.hash;
+		delete s.files;
+		delete s.replace;
+		s.pin = pin;
+		s.ring = ring;
+		s.loading = loading;
+		s.hash = hash;
+		s.files = files;
+		s.replace = replace;
+		s.last = -1;
+	}
 public:
+	/*
+	 * 映射页面的下标：-2 - (fileID << MAP_PAGE_BITS | pageID)，-1仍然表示没有页面
+	 */
+	static bool isMapped(int index) {
+		return index < -1;
+	}
+	static int mapIndex(int fileID, int pageID) {
+		return -2 - ((fileID << MAP_PAGE_BITS) | pageID);
+	}
+	static void mapKey(int index, int& fileID, int& pageID) {
+		int v = -2 - index;
+		fileID = v >> MAP_PAGE_BITS;
+		pageID = v & ((1 << MAP_PAGE_BITS) - 1);
+	}
 	/*
 	 * @函数名allocPage
 	 * @参数fileID:文件id，数据库程序在运行时，用文件id来区分正在打开的不同的文件
@@ -52,15 +1027,15 @@ public:
 	 * 功能:为文件中的某一个页面获取一个缓存中的页面
 	 *           缓存中的页面在缓存页面数组中的下标记录在index中
 	 *           并根据ifRead是否为true决定是否将文件中的内容写到获取的缓存页面中
-	 * 注意:在调用函数allocPage之前，调用者必须确信(fileID,pageID)指定的文件页面不存在缓存中
-	 *           如果确信指定的文件页面不在缓存中，那么就不用在hash表中进行查找，直接调用替换算法，节省时间
+	 * 注意:如果(fileID,pageID)指定的文件页面已经在缓存中，直接返回该缓存页面，不会重复分配
 	 */
 	BufType allocPage(int fileID, int pageID, int& index, bool ifRead = false) {
-		BufType b = fetchPage(fileID, pageID, index);
-		if (ifRead) {
-			fileManager->readPage(fileID, pageID, b, 0);
+		if (BufType b = _mapped(fileID, pageID, index)) {
+			return b;
 		}
-		return b;
+		int shardID = shardOf(fileID, pageID);
+		unique_lock<mutex> lock(shards[shardID].latch);
+		return _allocPage(shardID, lock, fileID, pageID, index, ifRead);
 	}
 	/*
 	 * @函数名getPage
@@ -76,15 +1051,118 @@ public:
 	 *           如果没有找到，那么就利用替换算法获取一个页面
 	 */
 	BufType getPage(int fileID, int pageID, int& index) {
-		index = hash->findIndex(fileID, pageID);
-		if (index != -1) {
-			access(index);
-			return addr[index];
-		} else {
-			BufType b = fetchPage(fileID, pageID, index);
-			fileManager->readPage(fileID, pageID, b, 0);
+		if (BufType b = _mapped(fileID, pageID, index)) {
 			return b;
 		}
+		int shardID = shardOf(fileID, pageID);
+		unique_lock<mutex> lock(shards[shardID].latch);
+		return _getPage(shardID, lock, fileID, pageID, index);
+	}
+	/*
+	 * @函数名getPageGuard
+	 * @参数fileID:文件id
+	 * @参数pageID:文件页号
+	 * 返回:pin住(fileID,pageID)对应缓存页面的guard
+	 * 功能:同getPage，但页面在guard析构之前不会被替换，调用者可以一直使用guard中的首地址
+	 *           而不需要每次访问都重新在hash表中查找
+	 */
+	PageGuard getPageGuard(int fileID, int pageID) {
+		int index;
+		BufType b = _mapped(fileID, pageID, index);
+		if (b != NULL) {
+			return PageGuard(this, index, b, fileID, pageID);
+		}
+		int shardID = shardOf(fileID, pageID);
+		Shard& s = shards[shardID];
+		{
+			unique_lock<mutex> lock(s.latch);
+			b = _getPage(shardID, lock, fileID, pageID, index);
+			++s.pin[toLocal(index)];
+		}
+		_readAhead(fileID, pageID, NULL);
+		return PageGuard(this, index, b, fileID, pageID);
+	}
+	/*
+	 * @函数名getPageGuard
+	 * @参数ring:顺序扫描使用的环形缓存
+	 * 功能:同getPage，但没有命中的页面读入ring中的页面，命中的页面也不会被提升
+	 */
+	PageGuard getPageGuard(int fileID, int pageID, BufRing* ring) {
+		int index;
+		BufType b = _mapped(fileID, pageID, index);
+		if (b != NULL) {
+			return PageGuard(this, index, b, fileID, pageID);
+		}
+		int shardID = shardOf(fileID, pageID);
+		Shard& s = shards[shardID];
+		{
+			unique_lock<mutex> lock(s.latch);
+			b = _getRingPage(shardID, lock, fileID, pageID, index, ring);
+			++s.pin[toLocal(index)];
+		}
+		_readAhead(fileID, pageID, ring);
+		return PageGuard(this, index, b, fileID, pageID);
+	}
+	/*
+	 * @函数名prefetch
+	 * @参数fileID:文件id
+	 * @参数pages:接下来要访问的文件页号
+	 * 功能:提示缓存管理器异步读入这些页面，例如B+树按范围扫描时后面的叶结点
+	 */
+	void prefetch(int fileID, const vector<int>& pages) {
+		if (readAhead) {
+			_prefetch(fileID, pages, NULL);
+		}
+	}
+	/*
+	 * @函数名newRing
+	 * @参数size:环形缓存的页面个数
+	 * 返回:新的环形缓存，由调用者delete
+	 */
+	BufRing* newRing(int size = BUF_RING_SIZE) {
+		return new BufRing(size, shardNum);
+	}
+	/*
+	 * @函数名allocPageGuard
+	 * 功能:同allocPage，返回pin住该缓存页面的guard
+	 */
+	PageGuard allocPageGuard(int fileID, int pageID, bool ifRead = false) {
+		int index;
+		if (BufType b = _mapped(fileID, pageID, index)) {
+			return PageGuard(this, index, b, fileID, pageID);
+		}
+		int shardID = shardOf(fileID, pageID);
+		Shard& s = shards[shardID];
+		unique_lock<mutex> lock(s.latch);
+		BufType b = _allocPage(shardID, lock, fileID, pageID, index, ifRead);
+		++s.pin[toLocal(index)];
+		return PageGuard(this, index, b, fileID, pageID);
+	}
+	/*
+	 * @函数名pin
+	 * @参数index:缓存页面数组中的下标
+	 * 功能:增加页面的pin计数，pin计数大于0的页面不会被替换算法选中
+	 */
+	void pin(int index) {
+		if (isMapped(index)) {
+			return;
+		}
+		Shard& s = shardOfIndex(index);
+		lock_guard<mutex> guard(s.latch);
+		++s.pin[toLocal(index)];
+	}
+	/*
+	 * @函数名unpin
+	 * @参数index:缓存页面数组中的下标
+	 * 功能:减少页面的pin计数
+	 */
+	void unpin(int index) {
+		if (isMapped(index)) {
+			return;
+		}
+		Shard& s = shardOfIndex(index);
+		lock_guard<mutex> guard(s.latch);
+		--s.pin[toLocal(index)];
 	}
 	/*
 	 * @函数名access
@@ -92,56 +1170,246 @@ public:
 	 * 功能:标记index代表的缓存页面被访问过，为替换算法提供信息
 	 */
 	void access(int index) {
-		if (index == last) {
+		if (isMapped(index)) {
 			return;
 		}
-		replace->access(index);
-		last = index;
+		Shard& s = shardOfIndex(index);
+		lock_guard<mutex> guard(s.latch);
+		_access(s, index);
 	}
 	/*
 	 * @函数名markDirty
 	 * @参数index:缓存页面数组中的下标，用来表示一个缓存页面
 	 * 功能:标记index代表的缓存页面被写过，保证替换算法在执行时能进行必要的写回操作，
 	 *           保证数据的正确性
+	 *           环形缓存中的页面只标记，不提升
 	 */
 	void markDirty(int index) {
+		if (isMapped(index)) {
+			int fileID, pageID;
+			mapKey(index, fileID, pageID);
+			lock_guard<mutex> guard(mapLatch);
+			mapDirty.insert(make_pair(fileID, pageID));
+			return;
+		}
+		Shard& s = shardOfIndex(index);
+		lock_guard<mutex> guard(s.latch);
+		int f, p;
+		s.hash->getKeys(toLocal(index), f, p);
+		// 页面所属的文件已经被invalidateFile丢弃
+		if (f == -1) {
+			return;
+		}
 		dirty[index] = true;
-		access(index);
+		if (!s.ring[toLocal(index)]) {
+			_access(s, index);
+		}
 	}
 	/*
 	 * @函数名release
 	 * @参数index:缓存页面数组中的下标，用来表示一个缓存页面
 	 * 功能:将index代表的缓存页面归还给缓存管理器，在归还前，缓存页面中的数据不标记写回
+	 *           映射页面上的修改已经在操作系统的页缓存中，只是不再主动msync
 	 */
 	void release(int index) {
+		if (isMapped(index)) {
+			int fileID, pageID;
+			mapKey(index, fileID, pageID);
+			lock_guard<mutex> guard(mapLatch);
+			mapDirty.erase(make_pair(fileID, pageID));
+			return;
+		}
+		Shard& s = shardOfIndex(index);
+		lock_guard<mutex> guard(s.latch);
 		dirty[index] = false;
-		replace->free(index);
-		hash->remove(index);
+		s.replace->free(toLocal(index));
+		_unbind(s, toLocal(index));
 	}
 	/*
 	 * @函数名writeBack
 	 * @参数index:缓存页面数组中的下标，用来表示一个缓存页面
 	 * 功能:将index代表的缓存页面归还给缓存管理器，在归还前，缓存页面中的数据需要根据脏页标记决定是否写到对应的文件页面中
+	 *           被pin住的页面只写回，不归还
 	 */
 	void writeBack(int index) {
-		if (dirty[index]) {
-			int f, p;
-			hash->getKeys(index, f, p);
-			fileManager->writePage(f, p, addr[index], 0);
-			dirty[index] = false;
+		if (isMapped(index)) {
+			int fileID, pageID;
+			mapKey(index, fileID, pageID);
+			{
+				lock_guard<mutex> guard(mapLatch);
+				if (mapDirty.erase(make_pair(fileID, pageID)) == 0) {
+					return;
+				}
+			}
+			fileManager->syncPages(fileID, pageID, 1);
+			++mapSyncs;
+			return;
 		}
-		replace->free(index);
-		hash->remove(index);
+		Shard& s = shardOfIndex(index);
+		lock_guard<mutex> guard(s.latch);
+		_writeBack(s, index);
+	}
+	/*
+	 * @函数名flush
+	 * 功能:将所有脏页按(fileID,pageID)的顺序写回，相邻的页面合并写，页面仍保留在缓存中
+	 */
+	void flush() {
+		lock_guard<mutex> pass(flushPass);
+		_flush();
+	}
+	/*
+	 * @函数名flushFile
+	 * @参数fileID:文件id
+	 * 功能:同flush，但只写回文件fileID的脏页，其他文件的页面不受影响
+	 */
+	void flushFile(int fileID) {
+		lock_guard<mutex> pass(flushPass);
+		_flushFile(fileID);
+	}
+	/*
+	 * @函数名invalidateFile
+	 * @参数fileID:文件id
+	 * @参数writeBack:是否先写回该文件的脏页
+	 * @参数fromPage:只去掉页号不小于fromPage的页面
+	 * 功能:把文件fileID的所有页面从缓存中去掉，其他文件的页面不受影响
+	 *           writeBack为false时脏页直接丢弃，用于文件即将被删除的情况
+	 *           关闭文件之前必须调用，否则文件id被重新使用后会读到旧文件的页面
+	 *           仍被pin住的页面同样去掉，之后对它的markDirty不再有作用
+	 *           fromPage大于0时用于截断文件之前，文件不能使用内存映射
+	 */
+	void invalidateFile(int fileID, bool writeBack = true, int fromPage = 0) {
+		lock_guard<mutex> warm(warmLatch);
+		_drainPrefetch();
+		lock_guard<mutex> pass(flushPass);
+		if (writeBack) {
+			_flushFile(fileID);
+		} else if (fromPage == 0) {
+			_takeMapped(fileID);
+		}
+		for (int i = 0; i < shardNum; ++ i) {
+			Shard& s = shards[i];
+			lock_guard<mutex> guard(s.latch);
+			for (int local = s.files->getFirst(fileID), next; !s.files->isHead(local); local = next) {
+				next = s.files->next(local);
+				int index = toIndex(i, local);
+				int f, p;
+				s.hash->getKeys(local, f, p);
+				if (p < fromPage) {
+					continue;
+				}
+				// flushFile之后又被修改的页面
+				if (dirty[index] && writeBack) {
+					fileManager->writePage(f, p, arena->frame(index), 0);
+				}
+				dirty[index] = false;
+				s.replace->free(local);
+				_unbind(s, local);
+				if (s.last == index) {
+					s.last = -1;
+				}
+			}
+			if (s.tier != NULL) {
+				s.tier->dropFile(fileID, fromPage);
+			}
+		}
+		lock_guard<mutex> guard(seqStates[fileID].latch);
+		seqStates[fileID].active = false;
 	}
 	/*
 	 * @函数名close
 	 * 功能:将所有缓存页面归还给缓存管理器，归还前需要根据脏页标记决定是否写到对应的文件页面中
+	 *           脏页先按flush的顺序写回
+	 *           被pin住的页面写回后仍保留在缓存中
+	 *           没有完成的预热不再继续
 	 */
 	void close() {
-		for (int i = 0; i < CAP; ++ i) {
-			writeBack(i);
+		_stopWarmup();
+		_drainPrefetch();
+		lock_guard<mutex> pass(flushPass);
+		_flush();
+		for (int i = 0; i < shardNum; ++ i) {
+			lock_guard<mutex> guard(shards[i].latch);
+			for (int j = i; j < capacity; j += shardNum) {
+				_writeBack(shards[i], j);
+			}
 		}
 	}
+	/*
+	 * @函数名dump
+	 * 返回:没有设置dumpFile或者写文件失败时返回false
+	 * 功能:把缓存中的页面按从热到冷的顺序写到dumpFile，每行是"页号 文件名"，下次启动时用于预热
+	 *           先写到临时文件再改名，写到一半退出也不会留下不完整的记录
+	 */
+	bool dump() {
+		if (dumpFile.empty()) {
+			return false;
+		}
+		lock_guard<mutex> pass(dumpPass);
+		vector<pair<int, int>> pages = _hotPages();
+		string tmp = dumpFile + ".tmp";
+		FILE* f = fopen(tmp.c_str(), "w");
+		if (f == NULL) {
+			return false;
+		}
+		map<int, string> names;
+		for (const pair<int, int>& page : pages) {
+			auto it = names.find(page.first);
+			if (it == names.end()) {
+				it = names.insert(make_pair(page.first, fileManager->getFileName(page.first))).first;
+			}
+			fprintf(f, "%d %s\n", page.second, it->second.c_str());
+		}
+		bool ok = fclose(f) == 0;
+		return ok && rename(tmp.c_str(), dumpFile.c_str()) == 0;
+	}
+	int minCapacity() const {
+		return shardNum * BUF_MIN_SHARD_PAGES;
+	}
+	/*
+	 * @函数名resize
+	 * @参数c:新的页面个数，不少于minCapacity()，不超过maxCapacity
+	 * 返回:成功时返回true；c不合法，或者要去掉的页面中有被pin住的页面时返回false，缓存不变
+	 * 功能:在运行时扩大或缩小缓存，缩小时先写回脏页，去掉的页面占用的内存还给系统
+	 *           已有页面的下标不变，环形缓存中被去掉的页面在下次使用时重新分配
+	 */
+	bool resize(int c) {
+		if (c < minCapacity() || c > maxCapacity) {
+			return false;
+		}
+		lock_guard<mutex> warm(warmLatch);
+		_drainPrefetch();
+		lock_guard<mutex> pass(flushPass);
+		_flush();
+		vector<unique_lock<mutex>> locks;
+		for (int i = 0; i < shardNum; ++ i) {
+			locks.emplace_back(shards[i].latch);
+		}
+		for (int index = c; index < capacity; ++ index) {
+			if (shardOfIndex(index).pin[toLocal(index)] > 0) {
+				return false;
+			}
+		}
+		for (int index = c; index < capacity; ++ index) {
+			Shard& s = shardOfIndex(index);
+			if (dirty[index]) {
+				int f, p;
+				s.hash->getKeys(toLocal(index), f, p);
+				fileManager->writePage(f, p, arena->frame(index), 0);
+				dirty[index] = false;
+			}
+		}
+		int old = capacity;
+		vector<int> oldSc(shardNum);
+		for (int i = 0; i < shardNum; ++ i) {
+			oldSc[i] = shardCapacity(i);
+		}
+		capacity = c;
+		for (int i = 0; i < shardNum; ++ i) {
+			_resizeShard(i, oldSc[i], shardCapacity(i));
+		}
+		arena->discard(c, old);
+		return true;
+	}
 	/*
 	 * @函数名getKey
 	 * @参数index:缓存页面数组中的下标，用来指定一个缓存页面
@@ -149,26 +1417,240 @@ public:
 	 * @参数pageID:函数返回时，用于存储指定缓存页面对应的文件页号
 	 */
 	void getKey(int index, int& fileID, int& pageID) {
-		hash->getKeys(index, fileID, pageID);
+		if (isMapped(index)) {
+			mapKey(index, fileID, pageID);
+			return;
+		}
+		Shard& s = shardOfIndex(index);
+		lock_guard<mutex> guard(s.latch);
+		s.hash->getKeys(toLocal(index), fileID, pageID);
+	}
+	/*
+	 * @函数名getStats
+	 * @参数hits:函数返回时，记录getPage命中缓存的次数
+	 * @参数misses:函数返回时，记录getPage需要读文件的次数
+	 */
+	void getStats(long long& hits, long long& misses) {
+		hits = misses = 0;
+		for (int i = 0; i < shardNum; ++ i) {
+			lock_guard<mutex> guard(shards[i].latch);
+			hits += shards[i].hits;
+			misses += shards[i].misses;
+		}
+	}
+	/*
+	 * @函数名getWriteStats
+	 * @参数evictWrites:替换脏页时同步写回的次数
+	 * @参数pages:后台写回线程和flush、close写回的页面数
+	 * @参数calls:上述写回使用的系统调用次数
+	 */
+	void getWriteStats(long long& evictWrites, long long& pages, long long& calls) {
+		evictWrites = 0;
+		for (int i = 0; i < shardNum; ++ i) {
+			lock_guard<mutex> guard(shards[i].latch);
+			evictWrites += shards[i].evictWrites;
+		}
+		pages = flushedPages;
+		calls = flushCalls;
+	}
+	/*
+	 * @函数名getPrefetchStats
+	 * @参数pages:预读读入的页面数
+	 * @参数waits:访问页面时需要等待预读完成的次数
+	 */
+	void getPrefetchStats(long long& pages, long long& waits) {
+		pages = waits = 0;
+		for (int i = 0; i < shardNum; ++ i) {
+			lock_guard<mutex> guard(shards[i].latch);
+			pages += shards[i].prefetched;
+			waits += shards[i].prefetchWaits;
+		}
+	}
+	/*
+	 * @函数名getMapStats
+	 * @参数accesses:直接访问映射页面的次数
+	 * @参数syncs:msync的次数
+	 */
+	void getMapStats(long long& accesses, long long& syncs) {
+		accesses = mapAccesses;
+		syncs = mapSyncs;
+	}
+	/*
+	 * @函数名getWarmStats
+	 * @参数loaded:已经预热的页面数
+	 * @参数total:要预热的页面数
+	 */
+	void getWarmStats(long long& loaded, long long& total) {
+		loaded = warmLoaded;
+		total = warmTotal;
+	}
+	/*
+	 * @函数名getTierStats
+	 * @参数hits:没有命中缓存的页面在压缩缓存中找到的次数
+	 * @参数misses:在压缩缓存中也没有找到的次数
+	 * @参数pages:压缩缓存中的页面个数
+	 * @参数bytes:这些页面压缩后的字节数
+	 */
+	void getTierStats(long long& hits, long long& misses, long long& pages, long long& bytes) {
+		hits = misses = pages = bytes = 0;
+		for (int i = 0; i < shardNum; ++ i) {
+			lock_guard<mutex> guard(shards[i].latch);
+			hits += shards[i].tierHits;
+			misses += shards[i].tierMisses;
+			if (shards[i].tier != NULL) {
+				pages += shards[i].tier->count();
+				bytes += shards[i].tier->bytes();
+			}
+		}
+	}
+	void resetStats() {
+		for (int i = 0; i < shardNum; ++ i) {
+			lock_guard<mutex> guard(shards[i].latch);
+			shards[i].hits = shards[i].misses = shards[i].evictWrites = 0;
+			shards[i].prefetched = shards[i].prefetchWaits = 0;
+			shards[i].tierHits = shards[i].tierMisses = 0;
+		}
+		flushedPages = flushCalls = 0;
+		mapAccesses = mapSyncs = 0;
 	}
 	/*
 	 * 构造函数
 	 * @参数fm:文件管理器，缓存管理器需要利用文件管理器与磁盘进行交互
+	 * @参数config:容量、分片个数、替换算法和后台写回的设置
 	 */
-	BufPageManager(FileManager* fm) {
-		int c = CAP;
-		int m = MOD;
-		last = -1;
+	BufPageManager(FileManager* fm, const BufConfig& config = BufConfig()) {
+		capacity = max(config.capacity, 1);
+		maxCapacity = max(config.maxCapacity, capacity);
+		// 页面太少时减少分片个数，使每个分片至少有BUF_MIN_SHARD_PAGES个页面
+		shardNum = max(min(config.shardNum, capacity / BUF_MIN_SHARD_PAGES), 1);
+		pageIdx = config.pageSizeIdx;
+		policy = config.replace;
+		flushInterval = config.flushInterval;
+		cleanReserve = max(config.cleanReserve, 1);
 		fileManager = fm;
-		//bpl = new MyLinkList(CAP, MAX_FILE_NUM);
-		dirty = new bool[CAP];
-		addr = new BufType[CAP];
-		hash = new MyHashMap(c, m);
-	    replace = new FindReplace(c);
-		for (int i = 0; i < CAP; ++ i) {
-			dirty[i] = false;
-			addr[i] = NULL;
+		dirty = new bool[maxCapacity]();
+		stamp = new unsigned[maxCapacity]();
+		tick = 0;
+		arena = new FrameArena(capacity, maxCapacity, config.hugePages, pageIdx);
+		shards = new Shard[shardNum];
+		for (int i = 0; i < shardNum; ++ i) {
+			// 分片i拥有的页面下标为i, i + n, i + 2n, ...
+			int sc = shardCapacity(i);
+			shards[i].last = -1;
+			shards[i].pin = new int[sc]();
+			shards[i].ring = new bool[sc]();
+			shards[i].loading = new bool[sc]();
+			shards[i].hash = new PageTable(sc);
+			shards[i].files = new MyLinkList(sc, MAX_FILE_NUM);
+			shards[i].replace = newReplace(sc, shards[i].pin);
+			shards[i].hits = shards[i].misses = shards[i].evictWrites = 0;
+			shards[i].prefetched = shards[i].prefetchWaits = 0;
+			shards[i].accesses = 0;
+			// 压缩缓存按分片平分，只用于PAGE_SIZE的页面
+			long long tierBytes = pageIdx == PAGE_SIZE_IDX ? config.tierBytes / shardNum : 0;
+			shards[i].tier = tierBytes >= PAGE_SIZE ? new CompressedTier((int)min(tierBytes, (long long)INT_MAX)) : NULL;
+			shards[i].tierHits = shards[i].tierMisses = 0;
+		}
+		flushStop = false;
+		flushWanted = false;
+		flushedPages = flushCalls = 0;
+		mapAccesses = mapSyncs = 0;
+		aio = AsyncIO::create(config.io, config.ioDepth, config.ioWorkers);
+		if (config.flusher) {
+			flusher = thread(&BufPageManager::_flusherLoop, this);
+		}
+		readAhead = config.readAhead;
+		readAheadMax = max(config.readAheadMax, BUF_READAHEAD_MIN);
+		prefetchBusy = prefetchStop = false;
+		seqStates = new SeqState[MAX_FILE_NUM];
+		for (int i = 0; i < MAX_FILE_NUM; ++ i) {
+			seqStates[i].active = false;
+		}
+		readAio = NULL;
+		if (readAhead) {
+			readAio = AsyncIO::create(config.io, config.ioDepth, config.ioWorkers);
+		}
+		if (readAio != NULL) {
+			prefetcher = thread(&BufPageManager::_prefetchLoop, this);
+		}
+		dumpFile = config.warmup ? config.dumpFile : "";
+		dumpInterval = config.dumpInterval;
+		warmStop = dumpStop = false;
+		warmLoaded = warmTotal = 0;
+		if (!dumpFile.empty()) {
+			warmer = thread(&BufPageManager::_warmLoop, this);
+			if (dumpInterval > 0) {
+				dumper = thread(&BufPageManager::_dumpLoop, this);
+			}
 		}
 	}
+	/*
+	 * @参数c:缓存页面的容量上限
+	 * @参数n:分片个数
+	 * @参数p:替换算法
+	 */
+	BufPageManager(FileManager* fm, int c, int n = BUF_SHARD_NUM, ReplacePolicy p = LRU_REPLACE)
+		: BufPageManager(fm, BufConfig(c, n, p)) {}
+	~BufPageManager() {
+		_stopWarmup();
+		if (prefetcher.joinable()) {
+			{
+				lock_guard<mutex> lock(prefetchLatch);
+				prefetchStop = true;
+			}
+			prefetchCond.notify_one();
+			prefetcher.join();
+		}
+		delete readAio;
+		delete[] seqStates;
+		if (flusher.joinable()) {
+			{
+				lock_guard<mutex> lock(flushLatch);
+				flushStop = true;
+			}
+			flushCond.notify_one();
+			flusher.join();
+		}
+		delete aio;
+		for (int i = 0; i < shardNum; ++ i) {
+			delete[] shards[i].pin;
+			delete[] shards[i].ring;
+			delete[] shards[i].loading;
+			delete shards[i].hash;
+			delete shards[i].files;
+			delete shards[i].replace;
+			delete shards[i].tier;
+		}
+		delete[] shards;
+		delete arena;
+		delete[] dirty;
+		delete[] stamp;
+	}
 };
+inline PageGuard& PageGuard::operator=(PageGuard&& other) noexcept {
+	if (this != &other) {
+		release();
+		bpm = other.bpm;
+		index = other.index;
+		data = other.data;
+		fileID = other.fileID;
+		pageID = other.pageID;
+		other.bpm = NULL;
+		other.index = -1;
+		other.data = NULL;
+	}
+	return *this;
+}
+inline void PageGuard::release() {
+	if (bpm != NULL) {
+		bpm->unpin(index);
+		bpm = NULL;
+		index = -1;
+		data = NULL;
+		fileID = pageID = -1;
+	}
+}
+inline void PageGuard::markDirty() {
+	bpm->markDirty(index);
+}
 #endif
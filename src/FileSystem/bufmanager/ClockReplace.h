@@ -0,0 +1,84 @@
+#ifndef BUF_CLOCK_REPLACE
+#define BUF_CLOCK_REPLACE
+#include <vector>
+#include "FindReplace.h"
+/*
+ * ClockReplace
+ * CLOCK(二次机会)算法，命中时只需要置位引用标记，不用调整链表
+ * 被free的页面放在空闲栈中，find优先返回空闲页面
+ */
+class ClockReplace : public FindReplace {
+private:
+	unsigned char* ref;
+	bool* isFree;
+	std::vector<int> freeStack;
+	int hand;
+public:
+	void free(int index) override {
+		ref[index] = 0;
+		if (!isFree[index]) {
+			isFree[index] = true;
+			freeStack.push_back(index);
+		}
+	}
+	void access(int index) override {
+		ref[index] = 1;
+	}
+	void restore(int index, long long key) override {
+		// 留在空闲栈中的记录会被find跳过
+		isFree[index] = false;
+		ref[index] = 0;
+	}
+	int find() override {
+		while (!freeStack.empty()) {
+			int index = freeStack.back();
+			freeStack.pop_back();
+			// 栈中可能残留已经被指针扫走的页面
+			if (isFree[index] && pin[index] == 0) {
+				isFree[index] = false;
+				ref[index] = 1;
+				return index;
+			}
+		}
+		// 转两圈后还没有找到，说明所有页面都被pin住
+		for (int step = 0; step < 2 * CAP_; ++ step) {
+			int index = hand;
+			hand = (hand + 1 == CAP_) ? 0 : hand + 1;
+			if (pin[index] > 0) {
+				continue;
+			}
+			if (ref[index] && !isFree[index]) {
+				ref[index] = 0;
+				continue;
+			}
+			isFree[index] = false;
+			ref[index] = 1;
+			return index;
+		}
+		return -1;
+	}
+	void peek(int n, std::vector<int>& out) override {
+		// 指针前方引用标记为0的页面会按顺序被选中
+		for (int step = 0, index = hand; step < CAP_ && n > 0; ++ step) {
+			if (!ref[index] && !isFree[index]) {
+				out.push_back(index);
+				-- n;
+			}
+			index = (index + 1 == CAP_) ? 0 : index + 1;
+		}
+	}
+	ClockReplace(int c, const int* p): FindReplace(c, p), hand(0) {
+		ref = new unsigned char[c]();
+		isFree = new bool[c];
+		freeStack.reserve(c);
+		for (int i = c - 1; i >= 0; -- i) {
+			isFree[i] = true;
+			freeStack.push_back(i);
+		}
+	}
+	~ClockReplace() {
+		delete[] ref;
+		delete[] isFree;
+	}
+};
+#endif
@@ -0,0 +1,147 @@
+#ifndef BUF_COMPRESSED_TIER
+#define BUF_COMPRESSED_TIER
+#include <stdlib.h>
+#include <deque>
+#include <unordered_map>
+#include "../utils/pagedef.h"
+#include "../utils/LZCodec.h"
+/*
+ * CompressedTier
+ * 被替换出缓存的干净页面压缩后放在这里，之后没有命中缓存时先在这里查找，找到时解压而不需要读磁盘
+ * 压缩后的页面依次追加到一块固定大小的环形内存中，空间不够时从最早放入的页面开始丢弃
+ * 压缩后超过BUF_TIER_MAX_BYTES的页面不放入
+ * 页面被取回缓存后从这里删掉，因此这里的页面总是与文件中的内容相同
+ * 每个缓存分片有一个，由分片的锁保护
+ */
+class CompressedTier {
+private:
+	struct Entry {
+		int fileID, pageID;
+		int offset, len;
+	};
+	char* arena;
+	int size;
+	/*
+	 * 下一个页面写入的位置
+	 */
+	int tail;
+	/*
+	 * entries按放入的顺序排列，第k个的序号为firstSeq + k；取回或丢弃的页面fileID为-1，等到空间被覆盖时才出队
+	 */
+	std::deque<Entry> entries;
+	long long firstSeq;
+	std::unordered_map<long long, long long> seqs;
+	long long used;
+	char scratch[PAGE_SIZE];
+	static long long key(int fileID, int pageID) {
+		return ((long long)fileID << 32) | (unsigned)pageID;
+	}
+	void popFront() {
+		Entry& e = entries.front();
+		if (e.fileID != -1) {
+			seqs.erase(key(e.fileID, e.pageID));
+			used -= e.len;
+		}
+		entries.pop_front();
+		++ firstSeq;
+	}
+	Entry* find(int fileID, int pageID) {
+		auto it = seqs.find(key(fileID, pageID));
+		if (it == seqs.end()) {
+			return NULL;
+		}
+		return &entries[it->second - firstSeq];
+	}
+	void drop(Entry* e) {
+		seqs.erase(key(e->fileID, e->pageID));
+		used -= e->len;
+		e->fileID = -1;
+	}
+public:
+	/*
+	 * @函数名put
+	 * @参数b:(fileID,pageID)的页面内容，必须与文件中的内容相同
+	 * 返回:放入时返回true，压缩后太大时返回false
+	 */
+	bool put(int fileID, int pageID, const void* b) {
+		if (Entry* e = find(fileID, pageID)) {
+			drop(e);
+		}
+		int len = LZCodec::compress(b, PAGE_SIZE, scratch, BUF_TIER_MAX_BYTES);
+		if (len == 0 || len > size) {
+			return false;
+		}
+		if (tail + len > size) {
+			// 跳过结尾放不下的部分，这部分中的页面是最早放入的
+			while (!entries.empty() && entries.front().offset >= tail) {
+				popFront();
+			}
+			tail = 0;
+		}
+		while (!entries.empty() && entries.front().offset >= tail && entries.front().offset < tail + len) {
+			popFront();
+		}
+		memcpy(arena + tail, scratch, len);
+		entries.push_back(Entry{fileID, pageID, tail, len});
+		seqs[key(fileID, pageID)] = firstSeq + entries.size() - 1;
+		tail += len;
+		used += len;
+		return true;
+	}
+	/*
+	 * @函数名take
+	 * @参数b:函数返回时，如果找到了页面，记录解压后的页面内容
+	 * 返回:找到页面时返回true，页面同时从这里删掉
+	 */
+	bool take(int fileID, int pageID, void* b) {
+		Entry* e = find(fileID, pageID);
+		if (e == NULL) {
+			return false;
+		}
+		bool ok = LZCodec::decompress(arena + e->offset, e->len, b, PAGE_SIZE);
+		drop(e);
+		return ok;
+	}
+	/*
+	 * @函数名erase
+	 * 功能:删掉(fileID,pageID)，页面即将被改写时调用
+	 */
+	void erase(int fileID, int pageID) {
+		if (Entry* e = find(fileID, pageID)) {
+			drop(e);
+		}
+	}
+	bool contains(int fileID, int pageID) {
+		return seqs.find(key(fileID, pageID)) != seqs.end();
+	}
+	/*
+	 * @函数名dropFile
+	 * 功能:删掉文件fileID的页号不小于fromPage的页面，文件被删除、关闭或者截断时调用
+	 */
+	void dropFile(int fileID, int fromPage = 0) {
+		for (Entry& e : entries) {
+			if (e.fileID == fileID && e.pageID >= fromPage) {
+				drop(&e);
+			}
+		}
+	}
+	/*
+	 * 返回:保存的页面个数和它们压缩后的字节数
+	 */
+	int count() const {
+		return (int)seqs.size();
+	}
+	long long bytes() const {
+		return used;
+	}
+	/*
+	 * @参数s:环形内存的字节数
+	 */
+	CompressedTier(int s): size(s), tail(0), firstSeq(0), used(0) {
+		arena = (char*)malloc(size);
+	}
+	~CompressedTier() {
+		free(arena);
+	}
+};
+#endif
@@ -1,17 +1,43 @@
 #ifndef BUF_SEARCH
 #define BUF_SEARCH
-#include "../utils/MyLinkList.h"
-#include "../utils/MyHashMap.h"
+#include <string>
+#include <vector>
 #include "../utils/pagedef.h"
-//template <int CAP_>
+/*
+ * 可选的替换算法
+ */
+enum ReplacePolicy {
+	LRU_REPLACE,
+	CLOCK_REPLACE,
+	LRU2_REPLACE,
+	TWO_Q_REPLACE
+};
+inline const char* replacePolicyName(ReplacePolicy p) {
+	switch (p) {
+		case CLOCK_REPLACE: return "clock";
+		case LRU2_REPLACE: return "lru2";
+		case TWO_Q_REPLACE: return "2q";
+		default: return "lru";
+	}
+}
+inline bool parseReplacePolicy(const std::string& name, ReplacePolicy& p) {
+	for (ReplacePolicy q : {LRU_REPLACE, CLOCK_REPLACE, LRU2_REPLACE, TWO_Q_REPLACE}) {
+		if (name == replacePolicyName(q)) {
+			p = q;
+			return true;
+		}
+	}
+	return false;
+}
 /*
  * FindReplace
- * 提供替换算法接口，这里实现的是栈式LRU算法
+ * 提供替换算法接口，具体算法见LRUReplace、ClockReplace、LRUKReplace、TwoQReplace
+ * 下标均为分片内的下标，pin计数大于0的页面不能被find选中
  */
 class FindReplace {
-private:
-	MyLinkList* list;
+protected:
 	int CAP_;
+	const int* pin;
 public:
 	/*
 	 * @函数名free
@@ -19,37 +45,48 @@ public:
 	 * 功能:将缓存页面数组中第index个页面的缓存空间回收
 	 *           下一次通过find函数寻找替换页面时，直接返回index
 	 */
-	void free(int index) {
-		list->insertFirst(0, index);
-	}
+	virtual void free(int index) = 0;
 	/*
 	 * @函数名access
 	 * @参数index:缓存页面数组中页面的下标
 	 * 功能:将缓存页面数组中第index个页面标记为访问
 	 */
-	void access(int index) {
-		list->insert(0, index);
-	}
+	virtual void access(int index) = 0;
 	/*
 	 * @函数名find
 	 * 功能:根据替换算法返回缓存页面数组中要被替换页面的下标
+	 *           跳过被pin住的页面，如果所有页面都被pin住，返回-1
 	 */
-	int find() {
-		int index = list->getFirst(0);
-		list->del(index);
-		list->insert(0, index);
-		return index;
+	virtual int find() = 0;
+	/*
+	 * @函数名load
+	 * @参数index:find返回的下标
+	 * @参数key:新装入页面的(fileID,pageID)
+	 * 功能:通知替换算法第index个页面装入了哪个文件页，需要记录页面历史的算法(2Q)使用
+	 */
+	virtual void load(int index, long long key) {}
+	/*
+	 * @函数名restore
+	 * @参数index:已经装有页面的下标
+	 * @参数key:该页面的(fileID,pageID)
+	 * 功能:缓存改变大小、重建替换算法时，把原有的页面按从最先到最后被替换的顺序放回
+	 */
+	virtual void restore(int index, long long key) {
+		access(index);
 	}
+	/*
+	 * @函数名peek
+	 * @参数n:最多返回的页面个数
+	 * @参数out:按顺序存放接下来最可能被find选中的页面下标
+	 * 功能:不改变替换算法的状态，供后台写回线程提前写回即将被替换的脏页
+	 */
+	virtual void peek(int n, std::vector<int>& out) = 0;
 	/*
 	 * 构造函数
 	 * @参数c:表示缓存页面的容量上限
+	 * @参数p:每个页面的pin计数
 	 */
-	FindReplace(int c) {
-		CAP_ = c;
-		list = new MyLinkList(c, 1);
-		for (int i = 0; i < CAP_; ++ i) {
-			list->insert(0, i);
-		}
-	}
+	FindReplace(int c, const int* p): CAP_(c), pin(p) {}
+	virtual ~FindReplace() {}
 };
 #endif
@@ -0,0 +1,84 @@
+#ifndef BUF_FRAME_ARENA
+#define BUF_FRAME_ARENA
+#include <sys/mman.h>
+#include "../utils/pagedef.h"
+/*
+ * FrameArena
+ * 缓存页面所在的一整块连续内存，按页面大小对齐，可以直接用于O_DIRECT读写
+ * 地址空间按缓存可以扩大到的页面个数预留，用MAP_NORESERVE的匿名映射并用madvise申请透明大页，
+ * 物理内存在第一次访问时才分配，因此没有用到的页面不占用内存，缓存缩小时用discard把多出来的页面还给系统
+ * MAP_HUGETLB的大页在映射时就从系统预留的大页中扣除，只用于大小不能改变的缓存，没有预留足够的大页时同样退回透明大页
+ */
+enum ArenaKind {NORMAL_ARENA, THP_ARENA, HUGETLB_ARENA};
+inline const char* arenaKindName(ArenaKind k) {
+	switch (k) {
+		case HUGETLB_ARENA: return "hugetlb";
+		case THP_ARENA: return "transparent huge pages";
+		default: return "normal";
+	}
+}
+class FrameArena {
+private:
+	char* base;
+	size_t size;
+	int idx;
+	ArenaKind kind;
+public:
+	/*
+	 * @参数frames:页面个数
+	 * @参数reserve:要预留地址空间的页面个数，即缓存可以扩大到的页面个数，不少于frames
+	 * @参数huge:是否尝试使用大页
+	 * @参数pageIdx:页面字节数以2为底的指数
+	 */
+	FrameArena(int frames, int reserve, bool huge, int pageIdx = PAGE_SIZE_IDX) {
+		idx = pageIdx;
+		size = (size_t)reserve << idx;
+		kind = NORMAL_ARENA;
+		void* p = MAP_FAILED;
+		if (huge && reserve == frames) {
+			// MAP_HUGETLB要求长度是大页大小的整数倍
+			size_t hugeSize = (size + BUF_HUGE_PAGE_SIZE - 1) / BUF_HUGE_PAGE_SIZE * BUF_HUGE_PAGE_SIZE;
+			p = mmap(NULL, hugeSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+			if (p != MAP_FAILED) {
+				size = hugeSize;
+				kind = HUGETLB_ARENA;
+			}
+		}
+		if (p == MAP_FAILED) {
+			p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+			if (p == MAP_FAILED) {
+				perror("frame arena");
+				exit(-1);
+			}
+			if (huge && madvise(p, size, MADV_HUGEPAGE) == 0) {
+				kind = THP_ARENA;
+			}
+		}
+		base = (char*)p;
+	}
+	~FrameArena() {
+		munmap(base, size);
+	}
+	BufType frame(int i) const {
+		return (BufType)(base + ((size_t)i << idx));
+	}
+	/*
+	 * @函数名discard
+	 * 功能:释放第from到第to-1个页面占用的物理内存，之后再访问时内容为0
+	 *           MAP_HUGETLB的大页只能整页释放，范围两端不足一个大页的部分不释放，内容不变
+	 */
+	void discard(int from, int to) {
+		size_t begin = (size_t)from << idx, end = (size_t)to << idx;
+		if (kind == HUGETLB_ARENA) {
+			begin = (begin + BUF_HUGE_PAGE_SIZE - 1) / BUF_HUGE_PAGE_SIZE * BUF_HUGE_PAGE_SIZE;
+			end = end / BUF_HUGE_PAGE_SIZE * BUF_HUGE_PAGE_SIZE;
+		}
+		if (begin < end) {
+			madvise(base + begin, end - begin, MADV_DONTNEED);
+		}
+	}
+	ArenaKind getKind() const {
+		return kind;
+	}
+};
+#endif
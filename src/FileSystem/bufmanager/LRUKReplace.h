@@ -0,0 +1,62 @@
+#ifndef BUF_LRUK_REPLACE
+#define BUF_LRUK_REPLACE
+#include <set>
+#include <tuple>
+#include "FindReplace.h"
+/*
+ * LRUKReplace
+ * LRU-2算法：淘汰倒数第二次访问时间最早的页面
+ * 只被访问过一次的页面倒数第二次访问时间记为0，优先被淘汰，它们之间按最近一次访问时间做LRU
+ * 因此一次性扫描过的页面不会把反复使用的页面挤出缓存
+ */
+class LRUKReplace : public FindReplace {
+private:
+	typedef std::tuple<unsigned long long, unsigned long long, int> Key;
+	unsigned long long tick;
+	/*
+	 * last[i]:最近一次访问时间 prev[i]:倒数第二次访问时间
+	 */
+	unsigned long long* last;
+	unsigned long long* prev;
+	std::set<Key> order;
+	void update(int index, unsigned long long p, unsigned long long l) {
+		order.erase(Key(prev[index], last[index], index));
+		prev[index] = p;
+		last[index] = l;
+		order.insert(Key(p, l, index));
+	}
+public:
+	void free(int index) override {
+		update(index, 0, 0);
+	}
+	void access(int index) override {
+		update(index, last[index], ++tick);
+	}
+	int find() override {
+		for (const Key& k : order) {
+			int index = std::get<2>(k);
+			if (pin[index] == 0) {
+				update(index, 0, ++tick);
+				return index;
+			}
+		}
+		return -1;
+	}
+	void peek(int n, std::vector<int>& out) override {
+		for (auto it = order.begin(); it != order.end() && n > 0; ++ it, -- n) {
+			out.push_back(std::get<2>(*it));
+		}
+	}
+	LRUKReplace(int c, const int* p): FindReplace(c, p), tick(0) {
+		last = new unsigned long long[c]();
+		prev = new unsigned long long[c]();
+		for (int i = 0; i < c; ++ i) {
+			order.insert(Key(0, 0, i));
+		}
+	}
+	~LRUKReplace() {
+		delete[] last;
+		delete[] prev;
+	}
+};
+#endif
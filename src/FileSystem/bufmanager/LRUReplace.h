@@ -0,0 +1,46 @@
+#ifndef BUF_LRU_REPLACE
+#define BUF_LRU_REPLACE
+#include "FindReplace.h"
+#include "../utils/MyLinkList.h"
+/*
+ * LRUReplace
+ * 栈式LRU算法，链表头部是最久未被访问的页面
+ */
+class LRUReplace : public FindReplace {
+private:
+	MyLinkList* list;
+public:
+	void free(int index) override {
+		list->insertFirst(0, index);
+	}
+	void access(int index) override {
+		list->insert(0, index);
+	}
+	int find() override {
+		int index = list->getFirst(0);
+		while (pin[index] > 0) {
+			index = list->next(index);
+			if (list->isHead(index)) {
+				return -1;
+			}
+		}
+		list->del(index);
+		list->insert(0, index);
+		return index;
+	}
+	void peek(int n, std::vector<int>& out) override {
+		for (int index = list->getFirst(0); !list->isHead(index) && n > 0; index = list->next(index), -- n) {
+			out.push_back(index);
+		}
+	}
+	LRUReplace(int c, const int* p): FindReplace(c, p) {
+		list = new MyLinkList(c, 1);
+		for (int i = 0; i < CAP_; ++ i) {
+			list->insert(0, i);
+		}
+	}
+	~LRUReplace() {
+		delete list;
+	}
+};
+#endif
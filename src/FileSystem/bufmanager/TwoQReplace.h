@@ -0,0 +1,136 @@
+#ifndef BUF_TWO_Q_REPLACE
+#define BUF_TWO_Q_REPLACE
+#include <algorithm>
+#include <deque>
+#include <unordered_map>
+#include <utility>
+#include "FindReplace.h"
+#include "../utils/MyLinkList.h"
+/*
+ * TwoQReplace
+ * 2Q算法(Johnson & Shasha)：
+ *     第一次进入缓存的页面放在FIFO队列A1in中
+ *     从A1in淘汰的页面只在A1out中记录(fileID,pageID)，不占用缓存
+ *     A1out中记录过的页面再次被读入时放进LRU队列Am
+ * 只访问一次的页面在A1in里排队离开，不会污染Am
+ */
+class TwoQReplace : public FindReplace {
+private:
+	enum {FREE_LIST, A1IN_LIST, AM_LIST, LIST_NUM};
+	MyLinkList* list;
+	int* where;
+	int size[LIST_NUM];
+	long long* key;
+	int kin, kout;
+	/*
+	 * A1out: 页面 -> 进入A1out时的序号，fifo中序号对不上的是过期记录
+	 */
+	std::unordered_map<long long, unsigned long long> ghost;
+	std::deque<std::pair<long long, unsigned long long>> fifo;
+	unsigned long long seq;
+	void move(int index, int listID, bool first = false) {
+		if (where[index] >= 0) {
+			-- size[where[index]];
+		}
+		if (first) {
+			list->insertFirst(listID, index);
+		} else {
+			list->insert(listID, index);
+		}
+		where[index] = listID;
+		++ size[listID];
+	}
+	int findIn(int listID) {
+		for (int index = list->getFirst(listID); !list->isHead(index); index = list->next(index)) {
+			if (pin[index] == 0) {
+				return index;
+			}
+		}
+		return -1;
+	}
+	void remember(long long k) {
+		ghost[k] = ++seq;
+		fifo.push_back(std::make_pair(k, seq));
+		while ((int)fifo.size() > kout) {
+			auto it = ghost.find(fifo.front().first);
+			if (it != ghost.end() && it->second == fifo.front().second) {
+				ghost.erase(it);
+			}
+			fifo.pop_front();
+		}
+	}
+public:
+	void free(int index) override {
+		key[index] = -1;
+		move(index, FREE_LIST, true);
+	}
+	void access(int index) override {
+		if (where[index] == AM_LIST) {
+			list->insert(AM_LIST, index);
+		} else if (where[index] == A1IN_LIST && size[A1IN_LIST] > kin) {
+			// 空闲页面多时A1in会超过kin，其中的页面本该已经进入A1out，命中时直接放进Am
+			move(index, AM_LIST);
+		}
+	}
+	int find() override {
+		int index = findIn(FREE_LIST);
+		if (index == -1) {
+			bool fromA1 = size[A1IN_LIST] > kin || size[AM_LIST] == 0;
+			index = findIn(fromA1 ? A1IN_LIST : AM_LIST);
+			if (index == -1) {
+				fromA1 = !fromA1;
+				index = findIn(fromA1 ? A1IN_LIST : AM_LIST);
+			}
+			if (index == -1) {
+				return -1;
+			}
+			if (fromA1 && key[index] != -1) {
+				remember(key[index]);
+			}
+		}
+		key[index] = -1;
+		move(index, A1IN_LIST);
+		return index;
+	}
+	void load(int index, long long k) override {
+		key[index] = k;
+		auto it = ghost.find(k);
+		if (it != ghost.end()) {
+			ghost.erase(it);
+			move(index, AM_LIST);
+		}
+	}
+	void restore(int index, long long k) override {
+		key[index] = k;
+		move(index, A1IN_LIST);
+	}
+	void peek(int n, std::vector<int>& out) override {
+		int first = size[A1IN_LIST] > kin ? A1IN_LIST : AM_LIST;
+		for (int listID : {first, A1IN_LIST + AM_LIST - first}) {
+			for (int index = list->getFirst(listID); !list->isHead(index) && n > 0; index = list->next(index), -- n) {
+				out.push_back(index);
+			}
+		}
+	}
+	TwoQReplace(int c, const int* p): FindReplace(c, p), seq(0) {
+		list = new MyLinkList(c, LIST_NUM);
+		where = new int[c];
+		key = new long long[c];
+		kin = std::max(c / 4, 1);
+		kout = std::max(c / 2, 1);
+		for (int i = 0; i < LIST_NUM; ++ i) {
+			size[i] = 0;
+		}
+		for (int i = 0; i < c; ++ i) {
+			where[i] = -1;
+			key[i] = -1;
+			move(i, FREE_LIST);
+		}
+	}
+	~TwoQReplace() {
+		delete list;
+		delete[] where;
+		delete[] key;
+	}
+};
+#endif
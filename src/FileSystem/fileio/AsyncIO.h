@@ -0,0 +1,415 @@
+#ifndef ASYNC_IO
+#define ASYNC_IO
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <linux/io_uring.h>
+/*
+ * 可选的异步IO实现
+ * SYNC_IO不使用异步IO，URING_IO在内核不支持时退化为THREAD_IO
+ */
+enum IOBackend {
+	SYNC_IO,
+	THREAD_IO,
+	URING_IO
+};
+inline const char* ioBackendName(IOBackend b) {
+	switch (b) {
+		case THREAD_IO: return "threads";
+		case URING_IO: return "uring";
+		default: return "sync";
+	}
+}
+inline bool parseIOBackend(const std::string& name, IOBackend& b) {
+	for (IOBackend c : {SYNC_IO, THREAD_IO, URING_IO}) {
+		if (name == ioBackendName(c)) {
+			b = c;
+			return true;
+		}
+	}
+	return false;
+}
+/*
+ * IORequest
+ * 一次向量读写，iov在请求完成之前必须有效
+ */
+struct IORequest {
+	int fd;
+	bool write;
+	off_t offset;
+	struct iovec* iov;
+	int iovcnt;
+	/*
+	 * 完成后为读写的字节数，失败时为-errno
+	 */
+	int result;
+	/*
+	 * 调用者的标记
+	 */
+	void* data;
+};
+/*
+ * AsyncIO
+ * 批量提交读写请求，之后再取回完成的请求
+ * 同一个实例只能由一个线程(或者在锁的保护下)使用
+ */
+class AsyncIO {
+public:
+	/*
+	 * @函数名submit
+	 * @参数reqs:要提交的请求
+	 * @参数n:请求个数
+	 * 功能:提交n个请求，正在进行的请求达到队列深度时先等待一部分请求完成
+	 */
+	virtual void submit(IORequest* const* reqs, int n) = 0;
+	/*
+	 * @函数名complete
+	 * @参数done:函数返回时，存放完成的请求
+	 * @参数max:最多取回的请求个数
+	 * @参数minWait:至少等待完成的请求个数，超过正在进行的请求个数时按后者计算
+	 * 返回:取回的请求个数
+	 */
+	virtual int complete(IORequest** done, int max, int minWait) = 0;
+	/*
+	 * 已提交但还没有被complete取回的请求个数
+	 */
+	virtual int pending() = 0;
+	virtual IOBackend backend() = 0;
+	virtual ~AsyncIO() {}
+	/*
+	 * @函数名wait
+	 * 功能:等待所有请求完成，出错的请求个数
+	 */
+	int wait() {
+		int failed = 0;
+		IORequest* done[64];
+		while (pending() > 0) {
+			int n = complete(done, 64, 1);
+			for (int i = 0; i < n; ++i) {
+				if (done[i]->result < 0) {
+					++failed;
+				}
+			}
+		}
+		return failed;
+	}
+	static AsyncIO* create(IOBackend backend, int depth, int workers);
+};
+/*
+ * ThreadIO
+ * 在工作线程中用preadv/pwritev执行请求
+ */
+class ThreadIO : public AsyncIO {
+private:
+	std::mutex latch;
+	std::condition_variable workCond, doneCond;
+	std::deque<IORequest*> queue;
+	std::vector<IORequest*> finished;
+	std::vector<std::thread> workers;
+	int inflight;
+	bool stop;
+	static int run(IORequest* req) {
+		// 写可能只写了一部分，读到文件末尾时直接返回
+		ssize_t total = 0, want = 0;
+		for (int i = 0; i < req->iovcnt; ++i) {
+			want += req->iov[i].iov_len;
+		}
+		std::vector<struct iovec> rest(req->iov, req->iov + req->iovcnt);
+		struct iovec* iov = rest.data();
+		int cnt = req->iovcnt;
+		while (total < want) {
+			ssize_t r = req->write ? pwritev(req->fd, iov, cnt, req->offset + total)
+				: preadv(req->fd, iov, cnt, req->offset + total);
+			if (r < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				return -errno;
+			}
+			if (r == 0) {
+				break;
+			}
+			total += r;
+			while (cnt > 0 && (size_t)r >= iov->iov_len) {
+				r -= iov->iov_len;
+				++iov;
+				--cnt;
+			}
+			if (cnt > 0) {
+				iov->iov_base = (char*)iov->iov_base + r;
+				iov->iov_len -= r;
+			}
+			if (!req->write) {
+				break;
+			}
+		}
+		return (int)total;
+	}
+	void work() {
+		std::unique_lock<std::mutex> lock(latch);
+		while (true) {
+			workCond.wait(lock, [this]() { return stop || !queue.empty(); });
+			if (queue.empty()) {
+				return;
+			}
+			IORequest* req = queue.front();
+			queue.pop_front();
+			lock.unlock();
+			req->result = run(req);
+			lock.lock();
+			finished.push_back(req);
+			doneCond.notify_all();
+		}
+	}
+public:
+	ThreadIO(int workerNum): inflight(0), stop(false) {
+		for (int i = 0; i < workerNum; ++i) {
+			workers.emplace_back(&ThreadIO::work, this);
+		}
+	}
+	~ThreadIO() {
+		{
+			std::lock_guard<std::mutex> lock(latch);
+			stop = true;
+		}
+		workCond.notify_all();
+		for (std::thread& t : workers) {
+			t.join();
+		}
+	}
+	void submit(IORequest* const* reqs, int n) override {
+		std::lock_guard<std::mutex> lock(latch);
+		for (int i = 0; i < n; ++i) {
+			queue.push_back(reqs[i]);
+		}
+		inflight += n;
+		workCond.notify_all();
+	}
+	int complete(IORequest** done, int max, int minWait) override {
+		std::unique_lock<std::mutex> lock(latch);
+		if (minWait > inflight) {
+			minWait = inflight;
+		}
+		if (minWait > max) {
+			minWait = max;
+		}
+		doneCond.wait(lock, [&]() { return (int)finished.size() >= minWait; });
+		int n = std::min((int)finished.size(), max);
+		for (int i = 0; i < n; ++i) {
+			done[i] = finished[i];
+		}
+		finished.erase(finished.begin(), finished.begin() + n);
+		inflight -= n;
+		return n;
+	}
+	int pending() override {
+		std::lock_guard<std::mutex> lock(latch);
+		return inflight;
+	}
+	IOBackend backend() override {
+		return THREAD_IO;
+	}
+};
+/*
+ * UringIO
+ * 直接通过系统调用使用io_uring，不依赖liburing
+ */
+class UringIO : public AsyncIO {
+private:
+	int ringFd;
+	unsigned depth;
+	void* sqPtr;
+	void* cqPtr;
+	size_t sqSize, cqSize, sqeSize;
+	unsigned *sqHead, *sqTail, *sqMask, *sqArray;
+	unsigned *cqHead, *cqTail, *cqMask;
+	struct io_uring_sqe* sqes;
+	struct io_uring_cqe* cqes;
+	/*
+	 * toSubmit:放进提交队列但还没有通知内核的请求个数
+	 * inflight:已经交给内核还没有完成的请求个数
+	 * ready:已经完成但还没有被complete取回的请求
+	 */
+	unsigned toSubmit;
+	int inflight;
+	std::vector<IORequest*> ready;
+	static int enter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+		return (int)syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, NULL, 0);
+	}
+	void reap() {
+		unsigned head = *cqHead;
+		unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+		while (head != tail) {
+			struct io_uring_cqe* cqe = &cqes[head & *cqMask];
+			IORequest* req = (IORequest*)(uintptr_t)cqe->user_data;
+			req->result = cqe->res;
+			ready.push_back(req);
+			--inflight;
+			++head;
+		}
+		__atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+	}
+	void flushSubmit(unsigned minComplete) {
+		while (true) {
+			int r = enter(ringFd, toSubmit, minComplete, minComplete > 0 ? IORING_ENTER_GETEVENTS : 0);
+			if (r < 0) {
+				if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+					// 内核暂时不能接受新请求，先收割已经完成的请求
+					reap();
+					continue;
+				}
+				return;
+			}
+			toSubmit -= r;
+			if (toSubmit == 0) {
+				return;
+			}
+			reap();
+		}
+	}
+public:
+	UringIO(): ringFd(-1), sqPtr(MAP_FAILED), cqPtr(MAP_FAILED), sqes((struct io_uring_sqe*)MAP_FAILED),
+		toSubmit(0), inflight(0) {}
+	/*
+	 * @函数名init
+	 * 返回:内核支持io_uring并且初始化成功时返回true
+	 */
+	bool init(unsigned entries) {
+		struct io_uring_params p;
+		memset(&p, 0, sizeof(p));
+		ringFd = (int)syscall(__NR_io_uring_setup, entries, &p);
+		if (ringFd < 0) {
+			return false;
+		}
+		depth = p.sq_entries;
+		sqSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+		cqSize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+		if (p.features & IORING_FEAT_SINGLE_MMAP) {
+			sqSize = cqSize = std::max(sqSize, cqSize);
+		}
+		sqPtr = mmap(NULL, sqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+		if (sqPtr == MAP_FAILED) {
+			return false;
+		}
+		if (p.features & IORING_FEAT_SINGLE_MMAP) {
+			cqPtr = sqPtr;
+		} else {
+			cqPtr = mmap(NULL, cqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+			if (cqPtr == MAP_FAILED) {
+				return false;
+			}
+		}
+		sqeSize = p.sq_entries * sizeof(struct io_uring_sqe);
+		sqes = (struct io_uring_sqe*)mmap(NULL, sqeSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+			ringFd, IORING_OFF_SQES);
+		if (sqes == MAP_FAILED) {
+			return false;
+		}
+		char* sq = (char*)sqPtr;
+		char* cq = (char*)cqPtr;
+		sqHead = (unsigned*)(sq + p.sq_off.head);
+		sqTail = (unsigned*)(sq + p.sq_off.tail);
+		sqMask = (unsigned*)(sq + p.sq_off.ring_mask);
+		sqArray = (unsigned*)(sq + p.sq_off.array);
+		cqHead = (unsigned*)(cq + p.cq_off.head);
+		cqTail = (unsigned*)(cq + p.cq_off.tail);
+		cqMask = (unsigned*)(cq + p.cq_off.ring_mask);
+		cqes = (struct io_uring_cqe*)(cq + p.cq_off.cqes);
+		return true;
+	}
+	~UringIO() {
+		if (inflight > 0) {
+			wait();
+		}
+		if (sqes != MAP_FAILED) {
+			munmap(sqes, sqeSize);
+		}
+		if (cqPtr != MAP_FAILED && cqPtr != sqPtr) {
+			munmap(cqPtr, cqSize);
+		}
+		if (sqPtr != MAP_FAILED) {
+			munmap(sqPtr, sqSize);
+		}
+		if (ringFd >= 0) {
+			close(ringFd);
+		}
+	}
+	void submit(IORequest* const* reqs, int n) override {
+		for (int i = 0; i < n; ++i) {
+			// 正在进行的请求不能超过队列深度，否则完成队列可能溢出
+			while ((unsigned)inflight >= depth) {
+				flushSubmit(1);
+				reap();
+			}
+			IORequest* req = reqs[i];
+			unsigned tail = *sqTail;
+			unsigned index = tail & *sqMask;
+			struct io_uring_sqe* sqe = &sqes[index];
+			memset(sqe, 0, sizeof(*sqe));
+			sqe->opcode = req->write ? IORING_OP_WRITEV : IORING_OP_READV;
+			sqe->fd = req->fd;
+			sqe->off = req->offset;
+			sqe->addr = (unsigned long long)(uintptr_t)req->iov;
+			sqe->len = req->iovcnt;
+			sqe->user_data = (unsigned long long)(uintptr_t)req;
+			sqArray[index] = index;
+			__atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+			++toSubmit;
+			++inflight;
+		}
+		flushSubmit(0);
+	}
+	int complete(IORequest** done, int max, int minWait) override {
+		reap();
+		int total = inflight + (int)ready.size();
+		if (minWait > total) {
+			minWait = total;
+		}
+		if (minWait > max) {
+			minWait = max;
+		}
+		while ((int)ready.size() < minWait) {
+			flushSubmit(minWait - ready.size());
+			reap();
+		}
+		int n = std::min((int)ready.size(), max);
+		for (int i = 0; i < n; ++i) {
+			done[i] = ready[i];
+		}
+		ready.erase(ready.begin(), ready.begin() + n);
+		return n;
+	}
+	int pending() override {
+		return inflight + (int)ready.size();
+	}
+	IOBackend backend() override {
+		return URING_IO;
+	}
+};
+inline AsyncIO* AsyncIO::create(IOBackend backend, int depth, int workers) {
+	if (backend == URING_IO) {
+		UringIO* io = new UringIO();
+		if (io->init(depth)) {
+			return io;
+		}
+		delete io;
+		backend = THREAD_IO;
+	}
+	if (backend == THREAD_IO) {
+		return new ThreadIO(workers);
+	}
+	return NULL;
+}
+#endif
@@ -0,0 +1,368 @@
+#ifndef COMPRESSED_FILE
+#define COMPRESSED_FILE
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <shared_mutex>
+#include <utility>
+#include <vector>
+#include "../utils/pagedef.h"
+#include "../utils/LZCodec.h"
+using namespace std;
+/*
+ * ZipStats
+ * 所有压缩的文件一起的统计：压缩写入的页面个数、压缩前后的字节数、解压读出的页面个数，以及压缩、解压用的时间(纳秒)
+ */
+struct ZipStats {
+	atomic<long long> written{0};
+	atomic<long long> rawBytes{0};
+	atomic<long long> storedBytes{0};
+	atomic<long long> compressNs{0};
+	atomic<long long> read{0};
+	atomic<long long> decompressNs{0};
+};
+/*
+ * CompressedFile
+ * 压缩的文件：每个页面用LZCodec压缩后放在若干个连续的扇区(ZIP_SECTOR字节)中，称为页面的区段
+ * 第0个扇区是文件头，记录页面表的位置；页面表按页号记录每个页面的区段，也放在文件中的连续扇区里
+ * 页面表的一项：低40位是区段的第一个扇区，之后8位是区段的扇区个数，高16位是压缩后的字节数，为0时页面没有压缩、占满区段
+ *     整项为0的页面没有写过，读出来是0
+ * 页面改写后放得下时写回原来的区段，多出的扇区放回空闲链表，否则换一个区段；区段优先从空闲链表中分配，没有时追加在文件末尾
+ * 空闲链表不写进文件，打开文件时由页面表中区段之间的空隙得到
+ * 读页面加共享锁，写页面和截断加独占锁，压缩、解压在锁外进行
+ */
+class CompressedFile {
+private:
+	static const uint64_t MAGIC = 0x3150495a4352454dULL; // "MERCZIP1"
+	static const int VERSION = 1;
+	static const int OFFSET_BITS = 40;
+	/*
+	 * 页面表的项数按一个扇区的项数取整，新文件的页面表先容纳ZIP_MAP_MIN项，不够时加倍并移到文件末尾
+	 */
+	static const int MAP_PER_SECTOR = ZIP_SECTOR / sizeof(uint64_t);
+	static const int ZIP_MAP_MIN = MAP_PER_SECTOR * 8;
+	struct Header {
+		uint64_t magic;
+		int version;
+		int pageIdx;
+		long long mapOffset;
+		long long mapCapacity;
+	};
+	int fd;
+	int pageSize;
+	/*
+	 * 一个区段最多的扇区个数，即没有压缩的页面占的扇区个数
+	 */
+	int maxSectors;
+	Header header;
+	vector<uint64_t> map;
+	/*
+	 * pages:页数，最后一个写过的页面的页号加一
+	 * end:文件中用到的扇区个数，新的区段从这里开始追加
+	 * used:页面的区段一共的扇区个数
+	 * freeList[n]:n个扇区的空闲区段的第一个扇区
+	 */
+	long long pages;
+	long long end;
+	long long used;
+	vector<vector<long long>> freeList;
+	shared_mutex latch;
+	ZipStats* stats;
+
+	static long long offsetOf(uint64_t e) {
+		return (long long)(e & ((1ULL << OFFSET_BITS) - 1));
+	}
+	static int sectorsOf(uint64_t e) {
+		return (int)((e >> OFFSET_BITS) & 0xff);
+	}
+	static int lengthOf(uint64_t e) {
+		return (int)(e >> 48);
+	}
+	static uint64_t makeEntry(long long offset, int sectors, int len) {
+		return (uint64_t)offset | ((uint64_t)sectors << OFFSET_BITS) | ((uint64_t)len << 48);
+	}
+	static long long nanos(chrono::steady_clock::time_point from) {
+		return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - from).count();
+	}
+	long long mapSectors() {
+		return header.mapCapacity / MAP_PER_SECTOR;
+	}
+
+	CompressedFile(int fd, int pageIdx, ZipStats* stats) : fd(fd), stats(stats) {
+		pageSize = 1 << pageIdx;
+		maxSectors = pageSize >> ZIP_SECTOR_IDX;
+		header.magic = MAGIC;
+		header.version = VERSION;
+		header.pageIdx = pageIdx;
+		header.mapOffset = 1;
+		header.mapCapacity = ZIP_MAP_MIN;
+	}
+	bool _writeHeader() {
+		char sector[ZIP_SECTOR];
+		memset(sector, 0, sizeof(sector));
+		memcpy(sector, &header, sizeof(header));
+		return pwrite(fd, sector, ZIP_SECTOR, 0) == ZIP_SECTOR;
+	}
+	bool _writeMap(long long from, long long n) {
+		ssize_t size = n * sizeof(uint64_t);
+		off_t offset = (header.mapOffset << ZIP_SECTOR_IDX) + from * sizeof(uint64_t);
+		return pwrite(fd, map.data() + from, size, offset) == size;
+	}
+	/*
+	 * 把从offset开始的n个扇区放进空闲链表，超过maxSectors时分成几段
+	 */
+	void _free(long long offset, long long n) {
+		while (n > 0) {
+			int k = (int)min(n, (long long)maxSectors);
+			freeList[k].push_back(offset);
+			offset += k;
+			n -= k;
+		}
+	}
+	/*
+	 * 分配n个扇区的区段：先找正好n个扇区的空闲区段，再拆开更大的，都没有时追加在末尾
+	 */
+	long long _alloc(int n) {
+		for (int k = n; k <= maxSectors; ++k) {
+			if (freeList[k].empty()) {
+				continue;
+			}
+			long long offset = freeList[k].back();
+			freeList[k].pop_back();
+			_free(offset + n, k - n);
+			return offset;
+		}
+		long long offset = end;
+		end += n;
+		return offset;
+	}
+	/*
+	 * 由页面表重新得到pages、end、used和空闲链表
+	 */
+	void _rebuild() {
+		vector<pair<long long, long long>> extents;
+		extents.push_back(make_pair(0LL, 1LL));
+		extents.push_back(make_pair(header.mapOffset, mapSectors()));
+		pages = 0;
+		used = 0;
+		for (long long p = 0; p < (long long)map.size(); ++p) {
+			if (map[p] != 0) {
+				extents.push_back(make_pair(offsetOf(map[p]), (long long)sectorsOf(map[p])));
+				used += sectorsOf(map[p]);
+				pages = p + 1;
+			}
+		}
+		sort(extents.begin(), extents.end());
+		freeList.assign(maxSectors + 1, vector<long long>());
+		end = 0;
+		for (const auto& e : extents) {
+			if (e.first > end) {
+				_free(end, e.first - end);
+			}
+			end = max(end, e.first + e.second);
+		}
+	}
+	/*
+	 * 页面表放不下页号pageID时加倍，追加在文件末尾，原来的扇区放进空闲链表
+	 */
+	bool _growMap(long long pageID) {
+		long long oldOffset = header.mapOffset, oldSectors = mapSectors();
+		long long capacity = max(header.mapCapacity * 2, pageID + 1);
+		capacity = (capacity + MAP_PER_SECTOR - 1) / MAP_PER_SECTOR * MAP_PER_SECTOR;
+		map.resize(capacity, 0);
+		header.mapOffset = end;
+		header.mapCapacity = capacity;
+		end += mapSectors();
+		if (!_writeMap(0, capacity) || !_writeHeader()) {
+			return false;
+		}
+		_free(oldOffset, oldSectors);
+		return true;
+	}
+public:
+	/*
+	 * @函数名open
+	 * @参数fd:已经打开的文件
+	 * @参数pageIdx:页面字节数以2为底的指数
+	 * @参数create:文件为空时是否写入文件头，作为压缩的文件使用
+	 * @参数stats:累计压缩、解压的统计
+	 * 返回:文件是压缩的文件(或者为空且create)时返回打开的CompressedFile，否则返回NULL，按普通文件读写
+	 */
+	static CompressedFile* open(int fd, int pageIdx, bool create, ZipStats* stats) {
+		struct stat st;
+		if (fstat(fd, &st) != 0) {
+			return NULL;
+		}
+		CompressedFile* file = new CompressedFile(fd, pageIdx, stats);
+		if (st.st_size == 0) {
+			file->map.assign(ZIP_MAP_MIN, 0);
+			if (!create || !file->_writeHeader() || !file->_writeMap(0, ZIP_MAP_MIN)) {
+				delete file;
+				return NULL;
+			}
+		} else {
+			Header h;
+			if (st.st_size < ZIP_SECTOR || pread(fd, &h, sizeof(h), 0) != sizeof(h) || h.magic != MAGIC
+					|| h.version != VERSION || h.pageIdx != pageIdx || h.mapCapacity % MAP_PER_SECTOR != 0) {
+				delete file;
+				return NULL;
+			}
+			file->header = h;
+			file->map.assign(h.mapCapacity, 0);
+			ssize_t size = h.mapCapacity * sizeof(uint64_t);
+			if (pread(fd, file->map.data(), size, h.mapOffset << ZIP_SECTOR_IDX) != size) {
+				delete file;
+				return NULL;
+			}
+		}
+		file->_rebuild();
+		return file;
+	}
+	/*
+	 * @函数名readPages
+	 * @参数pageID:第一个页号
+	 * @参数bufs:n个页面缓存
+	 * 功能:读出从pageID开始的n个页面，文件中相邻的区段合并成一次读
+	 * 返回:成功操作返回0
+	 */
+	int readPages(int pageID, const BufType* bufs, int n) {
+		vector<uint64_t> entries(n, 0);
+		vector<char> data;
+		{
+			shared_lock<shared_mutex> guard(latch);
+			for (int i = 0; i < n; ++i) {
+				if (pageID + i < pages) {
+					entries[i] = map[pageID + i];
+				}
+			}
+			long long total = 0;
+			for (int i = 0; i < n; ++i) {
+				total += sectorsOf(entries[i]);
+			}
+			data.resize(total << ZIP_SECTOR_IDX);
+			char* p = data.data();
+			for (int i = 0, j; i < n; i = j) {
+				if (entries[i] == 0) {
+					j = i + 1;
+					continue;
+				}
+				long long sectors = sectorsOf(entries[i]);
+				for (j = i + 1; j < n && entries[j] != 0 && offsetOf(entries[j]) == offsetOf(entries[i]) + sectors; ++j) {
+					sectors += sectorsOf(entries[j]);
+				}
+				// 文件末尾的区段可能没有写满
+				ssize_t r = pread(fd, p, sectors << ZIP_SECTOR_IDX, offsetOf(entries[i]) << ZIP_SECTOR_IDX);
+				if (r < 0) {
+					return -1;
+				}
+				memset(p + r, 0, (sectors << ZIP_SECTOR_IDX) - r);
+				p += sectors << ZIP_SECTOR_IDX;
+			}
+		}
+		const char* p = data.data();
+		for (int i = 0; i < n; ++i) {
+			uint64_t e = entries[i];
+			if (e == 0) {
+				memset(bufs[i], 0, pageSize);
+			} else if (lengthOf(e) == 0) {
+				memcpy(bufs[i], p, pageSize);
+			} else {
+				auto start = chrono::steady_clock::now();
+				bool ok = LZCodec::decompress(p, lengthOf(e), bufs[i], pageSize);
+				stats->decompressNs += nanos(start);
+				++stats->read;
+				if (!ok) {
+					return -1;
+				}
+			}
+			p += (long long)sectorsOf(e) << ZIP_SECTOR_IDX;
+		}
+		return 0;
+	}
+	int readPage(int pageID, BufType buf) {
+		return readPages(pageID, &buf, 1);
+	}
+	/*
+	 * @函数名writePage
+	 * @参数pageID:页号
+	 * @参数buf:页面缓存
+	 * 功能:压缩后写入页面，压缩后省不下一个扇区时不压缩
+	 * 返回:成功操作返回0
+	 */
+	int writePage(int pageID, BufType buf) {
+		static thread_local char scratch[MAX_PAGE_SIZE];
+		auto start = chrono::steady_clock::now();
+		int len = LZCodec::compress(buf, pageSize, scratch, pageSize - ZIP_SECTOR);
+		stats->compressNs += nanos(start);
+		++stats->written;
+		stats->rawBytes += pageSize;
+		stats->storedBytes += len != 0 ? len : pageSize;
+		int sectors = len != 0 ? (len + ZIP_SECTOR - 1) >> ZIP_SECTOR_IDX : maxSectors;
+		const void* data = len != 0 ? (const void*)scratch : (const void*)buf;
+		ssize_t size = len != 0 ? len : pageSize;
+
+		unique_lock<shared_mutex> guard(latch);
+		if (pageID >= (long long)map.size() && !_growMap(pageID)) {
+			return -1;
+		}
+		uint64_t e = map[pageID];
+		// 原来的区段在写成功之后才放回空闲链表，写失败时页面表仍然指向它，不会被分给别的页面
+		bool inPlace = e != 0 && sectorsOf(e) >= sectors;
+		long long offset = inPlace ? offsetOf(e) : _alloc(sectors);
+		if (pwrite(fd, data, size, offset << ZIP_SECTOR_IDX) != size) {
+			if (!inPlace) {
+				_free(offset, sectors);
+			}
+			return -1;
+		}
+		if (inPlace) {
+			_free(offset + sectors, sectorsOf(e) - sectors);
+		} else if (e != 0) {
+			_free(offsetOf(e), sectorsOf(e));
+		}
+		used += sectors - sectorsOf(e);
+		map[pageID] = makeEntry(offset, sectors, len);
+		pages = max(pages, (long long)pageID + 1);
+		return _writeMap(pageID, 1) ? 0 : -1;
+	}
+	/*
+	 * @函数名truncate
+	 * @参数n:保留的页数
+	 * 功能:去掉第n页及之后的页面，文件末尾不再使用的扇区一起截掉
+	 * 返回:成功操作返回true
+	 */
+	bool truncate(int n) {
+		unique_lock<shared_mutex> guard(latch);
+		if (n >= pages) {
+			return true;
+		}
+		fill(map.begin() + n, map.begin() + pages, 0);
+		if (!_writeMap(n, pages - n)) {
+			return false;
+		}
+		_rebuild();
+		return ftruncate(fd, (off_t)end << ZIP_SECTOR_IDX) == 0;
+	}
+	int pageNum() {
+		shared_lock<shared_mutex> guard(latch);
+		return (int)pages;
+	}
+	/*
+	 * @函数名getSize
+	 * @参数pageCount:页数
+	 * @参数storedBytes:页面的区段一共的字节数
+	 * @参数fileBytes:文件用到的字节数，包括文件头、页面表和空闲的区段
+	 */
+	void getSize(long long& pageCount, long long& storedBytes, long long& fileBytes) {
+		shared_lock<shared_mutex> guard(latch);
+		pageCount = pages;
+		storedBytes = used << ZIP_SECTOR_IDX;
+		fileBytes = end << ZIP_SECTOR_IDX;
+	}
+};
+#endif
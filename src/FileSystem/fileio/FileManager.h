@@ -2,16 +2,26 @@
 #define FILE_MANAGER
 #include <string>
 #include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
 #include <iostream>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <limits.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include "../utils/pagedef.h"
 #include "../utils/MyBitMap.h"
+#include "AsyncIO.h"
+#include "CompressedFile.h"
 
 #include <vector>
 #include <map>
+#include <set>
+#include <mutex>
 
 //#include "../MyLinkList.h"
 using namespace std;
@@ -23,9 +33,111 @@ private:
 	MyBitMap* fm;
 	MyBitMap* tm;
 	*/
-	vector<int> files;
+	/*
+	 * fd按fileID定长存放，读写页面时不需要加锁
+	 * fileNames和fmap只在打开、关闭文件时修改，由latch保护
+	 * 关闭的文件的id放进freeIDs，之后打开文件时重新使用
+	 */
+	int files[MAX_FILE_NUM];
+	int fileNum;
 	vector<string> fileNames;
 	map<string, int> fmap;
+	vector<int> freeIDs;
+	mutex latch;
+	/*
+	 * 内存映射：mapDirs中的目录下的文件在打开时把已有的页面用MAP_SHARED映射到maps[fileID]
+	 * 映射的范围在文件关闭之前不变，之后追加的页面仍然通过readPage、writePage读写
+	 */
+	struct Mapping {
+		char* base;
+		int pages;
+	};
+	Mapping maps[MAX_FILE_NUM];
+	set<string> mapDirs;
+	/*
+	 * direct:之后打开的文件是否使用O_DIRECT，绕过操作系统的页缓存
+	 * isDirect[fileID]:文件实际是否以O_DIRECT打开(有的文件系统不支持O_DIRECT)
+	 */
+	bool direct;
+	bool isDirect[MAX_FILE_NUM];
+	/*
+	 * 页面大小：pageDirs中的目录下的文件在打开时使用该目录的页面字节数的指数，其他文件使用PAGE_SIZE_IDX
+	 * pageIdx[fileID]:文件打开时确定的页面字节数的指数
+	 */
+	map<string, int> pageDirs;
+	int pageIdx[MAX_FILE_NUM];
+	/*
+	 * 页面压缩：zipDirs中的目录下打开的空文件写入文件头，作为压缩的文件；已有的文件按文件头判断是否压缩
+	 * zip[fileID]:压缩的文件按页号读写页面的对象，普通文件为NULL
+	 * 压缩的文件不使用内存映射和O_DIRECT，异步IO的请求也改为同步读写，见pageRequest
+	 */
+	set<string> zipDirs;
+	CompressedFile* zip[MAX_FILE_NUM];
+	ZipStats zipStats;
+
+	int _dirPageIdx(const string& name) {
+		for (const auto& it : pageDirs) {
+			if (name.compare(0, it.first.size(), it.first) == 0) {
+				return it.second;
+			}
+		}
+		return PAGE_SIZE_IDX;
+	}
+
+	bool _inZipDir(const string& name) {
+		for (const string& dir : zipDirs) {
+			if (name.compare(0, dir.size(), dir) == 0) {
+				return true;
+			}
+		}
+		return false;
+	}
+	bool _inMapDir(const string& name) {
+		for (const string& dir : mapDirs) {
+			if (name.compare(0, dir.size(), dir) == 0) {
+				return true;
+			}
+		}
+		return false;
+	}
+	void _map(int fileID) {
+		maps[fileID].base = NULL;
+		maps[fileID].pages = 0;
+		if (zip[fileID] != NULL || !_inMapDir(fileNames[fileID])) {
+			return;
+		}
+		int pages = getPageNum(fileID);
+		if (pages > (1 << MAP_PAGE_BITS)) {
+			pages = 1 << MAP_PAGE_BITS;
+		}
+		if (pages == 0) {
+			return;
+		}
+		void* p = mmap(NULL, (size_t)pages << pageIdx[fileID], PROT_READ | PROT_WRITE, MAP_SHARED, files[fileID], 0);
+		if (p == MAP_FAILED) {
+			return;
+		}
+		maps[fileID].base = (char*)p;
+		maps[fileID].pages = pages;
+	}
+	bool _unaligned(int fileID, const void* b) {
+		return isDirect[fileID] && ((uintptr_t)b & (DIRECT_IO_ALIGN - 1)) != 0;
+	}
+	void* _bounce() {
+		void* p = NULL;
+		if (posix_memalign(&p, DIRECT_IO_ALIGN, MAX_PAGE_SIZE) != 0) {
+			cerr << "out of memory" << endl;
+			exit(-1);
+		}
+		return p;
+	}
+	void _unmap(int fileID) {
+		if (maps[fileID].base != NULL) {
+			munmap(maps[fileID].base, (size_t)maps[fileID].pages << pageIdx[fileID]);
+			maps[fileID].base = NULL;
+			maps[fileID].pages = 0;
+		}
+	}
 
 	int _createFile(const char* name) {
 		FILE* f = fopen(name, "a+");
@@ -36,14 +148,35 @@ private:
 		fclose(f);
 		return 0;
 	}
-	int _openFile(const char* name) {//, int fileID) {
+	int _openFile(const char* name, int& fileID) {
+		fileID = freeIDs.empty() ? fileNum : freeIDs.back();
+		if (fileID >= MAX_FILE_NUM) {
+			return -1;
+		}
 		int f = open(name, O_RDWR);
 		if (f == -1) {
 			return -1;
 		}
-		files.push_back(f);
-		fileNames.push_back(name);
-		//fd[fileID] = f;
+		pageIdx[fileID] = _dirPageIdx(name);
+		zip[fileID] = CompressedFile::open(f, pageIdx[fileID], _inZipDir(name), &zipStats);
+		isDirect[fileID] = false;
+		if (zip[fileID] == NULL && direct) {
+			// 文件系统不支持O_DIRECT时仍然使用普通的读写
+			int g = open(name, O_RDWR | O_DIRECT);
+			if (g != -1) {
+				close(f);
+				f = g;
+				isDirect[fileID] = true;
+			}
+		}
+		files[fileID] = f;
+		if (fileID == fileNum) {
+			++fileNum;
+			fileNames.push_back(name);
+		} else {
+			freeIDs.pop_back();
+			fileNames[fileID] = name;
+		}
 		return 0;
 	}
 public:
@@ -51,6 +184,11 @@ public:
 	 * FilManager构造函数
 	 */
 	FileManager() {
+		fileNum = 0;
+		direct = false;
+		for (int i = 0; i < MAX_FILE_NUM; ++i) {
+			zip[i] = NULL;
+		}
 		/*
 		fm = new MyBitMap(MAX_FILE_NUM, 1);
 		tm = new MyBitMap(MAX_TYPE_NUM, 1);
@@ -62,49 +200,310 @@ public:
 	 * @参数pageID:文件的页号
 	 * @参数buf:存储信息的缓存(4字节无符号整数数组)
 	 * @参数off:偏移量
-	 * 功能:将buf+off开始的2048个四字节整数(8kb信息)写入fileID和pageID指定的文件页中
+	 * 功能:将buf+off开始的一个页面(默认2048个四字节整数，8kb信息)写入fileID和pageID指定的文件页中
+	 *           使用pwrite，不修改文件的读写位置，多个线程可以同时写同一个文件
 	 * 返回:成功操作返回0
 	 */
 	int writePage(int fileID, int pageID, BufType buf, int off) {
+		if (zip[fileID] != NULL) {
+			return zip[fileID]->writePage(pageID, buf + off);
+		}
 		//int f = fd[fileID];
 		int f = files[fileID];
+		ssize_t size = (ssize_t)1 << pageIdx[fileID];
 		off_t offset = pageID;
-		offset = (offset << PAGE_SIZE_IDX);
-		off_t error = lseek(f, offset, SEEK_SET);
-		if (error != offset) {
+		offset = (offset << pageIdx[fileID]);
+		BufType b = buf + off;
+		if (_unaligned(fileID, b)) {
+			void* bounce = _bounce();
+			memcpy(bounce, b, size);
+			ssize_t w = pwrite(f, bounce, size, offset);
+			free(bounce);
+			return w == size ? 0 : -1;
+		}
+		if (pwrite(f, (void*) b, size, offset) != size) {
 			return -1;
 		}
-		BufType b = buf + off;
-		error = write(f, (void*) b, PAGE_SIZE);
 		return 0;
 	}
+	/*
+	 * @函数名writePages
+	 * @参数fileID:文件id
+	 * @参数pageID:第一个文件页号
+	 * @参数bufs:n个缓存页面的首地址
+	 * @参数n:页面个数
+	 * 功能:将n个缓存页面写入从pageID开始的连续n个文件页中
+	 *           使用pwritev，每次系统调用最多写IOV_MAX个页面
+	 * 返回:成功操作返回0
+	 */
+	int writePages(int fileID, int pageID, const BufType* bufs, int n) {
+		if (zip[fileID] != NULL) {
+			for (int i = 0; i < n; ++i) {
+				if (zip[fileID]->writePage(pageID + i, bufs[i]) != 0) {
+					return -1;
+				}
+			}
+			return 0;
+		}
+		int f = files[fileID];
+		struct iovec iov[IOV_MAX];
+		while (n > 0) {
+			int m = n < IOV_MAX ? n : IOV_MAX;
+			for (int i = 0; i < m; ++i) {
+				iov[i].iov_base = (void*) bufs[i];
+				iov[i].iov_len = (size_t)1 << pageIdx[fileID];
+			}
+			off_t offset = pageID;
+			offset = (offset << pageIdx[fileID]);
+			ssize_t w = pwritev(f, iov, m, offset);
+			if (w < 0) {
+				return -1;
+			}
+			// 写了一部分时，从没有写完整的页面继续
+			int done = w >> pageIdx[fileID];
+			if (done == 0) {
+				if (writePage(fileID, pageID, bufs[0], 0) != 0) {
+					return -1;
+				}
+				done = 1;
+			}
+			pageID += done;
+			bufs += done;
+			n -= done;
+		}
+		return 0;
+	}
+	/*
+	 * @函数名pageRequest
+	 * @参数req:要填写的请求
+	 * @参数fileID:文件id
+	 * @参数pageID:第一个文件页号
+	 * @参数iov:iovcnt个页面缓存，每个长度为文件的页面字节数
+	 * @参数write:是否为写请求
+	 * 功能:填写读写从pageID开始的连续iovcnt个文件页的异步IO请求
+	 *           压缩的文件的页面不在按页号计算的偏移处，fd填为-1，调用者不提交这样的请求，改用readPages、writePages
+	 */
+	void pageRequest(IORequest& req, int fileID, int pageID, struct iovec* iov, int iovcnt, bool write) {
+		req.fd = zip[fileID] != NULL ? -1 : files[fileID];
+		req.write = write;
+		req.offset = (off_t)pageID << pageIdx[fileID];
+		req.iov = iov;
+		req.iovcnt = iovcnt;
+		req.result = 0;
+		req.data = NULL;
+	}
+	/*
+	 * @函数名advise
+	 * @参数fileID:文件id
+	 * @参数pageID:第一个文件页号
+	 * @参数n:页面个数，为0时表示到文件末尾
+	 * @参数advice:POSIX_FADV_SEQUENTIAL、POSIX_FADV_WILLNEED等
+	 * 功能:向内核提示接下来如何访问这些文件页
+	 */
+	void advise(int fileID, int pageID, int n, int advice) {
+		if (zip[fileID] != NULL) {
+			return;
+		}
+		posix_fadvise(files[fileID], (off_t)pageID << pageIdx[fileID], (off_t)n << pageIdx[fileID], advice);
+	}
 	/*
 	 * @函数名readPage
 	 * @参数fileID:文件id，用于区别已经打开的文件
 	 * @参数pageID:文件页号
 	 * @参数buf:存储信息的缓存(4字节无符号整数数组)
 	 * @参数off:偏移量
-	 * 功能:将fileID和pageID指定的文件页中2048个四字节整数(8kb)读入到buf+off开始的内存中
+	 * 功能:将fileID和pageID指定的文件页(默认2048个四字节整数，8kb)读入到buf+off开始的内存中
+	 *           使用pread，不修改文件的读写位置，多个线程可以同时读同一个文件
+	 *           文件结尾之后的部分读出来是0
 	 * 返回:成功操作返回0
 	 */
 	int readPage(int fileID, int pageID, BufType buf, int off) {
+		if (zip[fileID] != NULL) {
+			return zip[fileID]->readPage(pageID, buf + off);
+		}
 		//int f = fd[fID[type]];
 		//int f = fd[fileID];
 		int f = files[fileID];
+		ssize_t size = (ssize_t)1 << pageIdx[fileID];
 		off_t offset = pageID;
-		offset = (offset << PAGE_SIZE_IDX);
-		off_t error = lseek(f, offset, SEEK_SET);
-		if (error != offset) {
+		offset = (offset << pageIdx[fileID]);
+		BufType b = buf + off;
+		if (_unaligned(fileID, b)) {
+			void* bounce = _bounce();
+			ssize_t r = pread(f, bounce, size, offset);
+			if (r >= 0) {
+				memcpy(b, bounce, r);
+				memset((char*)b + r, 0, size - r);
+			}
+			free(bounce);
+			return r < 0 ? -1 : 0;
+		}
+		ssize_t r = pread(f, (void*) b, size, offset);
+		if (r < 0) {
 			return -1;
 		}
-		BufType b = buf + off;
-		error = read(f, (void*) b, PAGE_SIZE);
+		memset((char*)b + r, 0, size - r);
 		return 0;
 	}
+	/*
+	 * @函数名readPages
+	 * @参数fileID:文件id
+	 * @参数pageID:第一个文件页号
+	 * @参数bufs:n个缓存页面的首地址
+	 * @参数n:页面个数
+	 * 功能:读出从pageID开始的连续n个文件页，压缩的文件中相邻的区段合并成一次读
+	 * 返回:成功操作返回0
+	 */
+	int readPages(int fileID, int pageID, const BufType* bufs, int n) {
+		if (zip[fileID] != NULL) {
+			return zip[fileID]->readPages(pageID, bufs, n);
+		}
+		for (int i = 0; i < n; ++i) {
+			if (readPage(fileID, pageID + i, bufs[i], 0) != 0) {
+				return -1;
+			}
+		}
+		return 0;
+	}
+	/*
+	 * @函数名truncateFile
+	 * @参数pages:保留的页面个数
+	 * 功能:去掉文件第pages页及之后的页面，这些页面必须已经从缓存中去掉(BufPageManager::invalidateFile)
+	 * 返回:成功时返回true；使用内存映射的文件不截断，返回false
+	 */
+	bool truncateFile(int fileID, int pages) {
+		lock_guard<mutex> guard(latch);
+		if (maps[fileID].base != NULL) {
+			return false;
+		}
+		if (zip[fileID] != NULL) {
+			return zip[fileID]->truncate(pages);
+		}
+		return ftruncate(files[fileID], (off_t)pages << pageIdx[fileID]) == 0;
+	}
+	/*
+	 * @函数名setDirect
+	 * @参数on:之后打开的文件是否使用O_DIRECT
+	 * 功能:O_DIRECT要求缓冲区按DIRECT_IO_ALIGN对齐，缓存页面区满足这一要求，
+	 *           readPage、writePage遇到不对齐的缓冲区时经过一个对齐的临时页面
+	 */
+	void setDirect(bool on) {
+		lock_guard<mutex> guard(latch);
+		direct = on;
+	}
+	bool getDirect(int fileID) {
+		return isDirect[fileID];
+	}
+	/*
+	 * @函数名setMapped
+	 * @参数dir:目录，以'/'结尾
+	 * @参数mapped:之后打开的该目录下的文件是否使用内存映射
+	 * 功能:已经打开的文件不受影响
+	 */
+	void setMapped(const string& dir, bool mapped) {
+		lock_guard<mutex> guard(latch);
+		if (mapped) {
+			mapDirs.insert(dir);
+		} else {
+			mapDirs.erase(dir);
+		}
+	}
+	/*
+	 * @函数名setPageSize
+	 * @参数dir:目录，以'/'结尾
+	 * @参数idx:之后打开的该目录下的文件的页面字节数的指数，PAGE_SIZE_IDX到MAX_PAGE_SIZE_IDX
+	 * 功能:已经打开的文件不受影响
+	 */
+	void setPageSize(const string& dir, int idx) {
+		lock_guard<mutex> guard(latch);
+		if (idx == PAGE_SIZE_IDX) {
+			pageDirs.erase(dir);
+		} else {
+			pageDirs[dir] = idx;
+		}
+	}
+	/*
+	 * @函数名getPageSizeIdx
+	 * @参数fileID:文件id
+	 * 返回:文件的页面字节数以2为底的指数
+	 */
+	int getPageSizeIdx(int fileID) {
+		return pageIdx[fileID];
+	}
+	/*
+	 * @函数名setCompressed
+	 * @参数dir:目录，以'/'结尾
+	 * @参数compressed:之后在该目录下新建的文件是否压缩
+	 * 功能:已有的文件不受影响，是否压缩由文件头决定
+	 */
+	void setCompressed(const string& dir, bool compressed) {
+		lock_guard<mutex> guard(latch);
+		if (compressed) {
+			zipDirs.insert(dir);
+		} else {
+			zipDirs.erase(dir);
+		}
+	}
+	bool isCompressed(int fileID) {
+		return zip[fileID] != NULL;
+	}
+	/*
+	 * @函数名getZipSize
+	 * @参数fileID:文件id，必须是压缩的文件
+	 * @参数pages:页数
+	 * @参数storedBytes:页面压缩后占的字节数
+	 * @参数fileBytes:文件用到的字节数
+	 */
+	void getZipSize(int fileID, long long& pages, long long& storedBytes, long long& fileBytes) {
+		zip[fileID]->getSize(pages, storedBytes, fileBytes);
+	}
+	const ZipStats& getZipStats() {
+		return zipStats;
+	}
+	/*
+	 * @函数名mapPage
+	 * @参数fileID:文件id
+	 * @参数pageID:文件页号
+	 * 返回:文件页在映射中的首地址，文件没有被映射或者页面在映射的范围之外时返回NULL
+	 */
+	BufType mapPage(int fileID, int pageID) {
+		const Mapping& m = maps[fileID];
+		if (m.base == NULL || pageID >= m.pages) {
+			return NULL;
+		}
+		return (BufType)(m.base + ((size_t)pageID << pageIdx[fileID]));
+	}
+	/*
+	 * @函数名syncPages
+	 * @参数fileID:文件id
+	 * @参数pageID:第一个文件页号
+	 * @参数n:页面个数，必须都在映射的范围之内
+	 * 功能:用msync把映射中被修改的页面同步写回文件
+	 * 返回:成功操作返回0
+	 */
+	int syncPages(int fileID, int pageID, int n) {
+		return msync(maps[fileID].base + ((size_t)pageID << pageIdx[fileID]), (size_t)n << pageIdx[fileID], MS_SYNC);
+	}
+	/*
+	 * @函数名getPageNum
+	 * @参数fileID:文件id
+	 * 返回:文件当前的页数，只在缓存中新分配、还没有写回的页面不计算在内
+	 */
+	int getPageNum(int fileID) {
+		if (zip[fileID] != NULL) {
+			return zip[fileID]->pageNum();
+		}
+		struct stat st;
+		if (fstat(files[fileID], &st) != 0) {
+			return 0;
+		}
+		return (int)((st.st_size + ((off_t)1 << pageIdx[fileID]) - 1) >> pageIdx[fileID]);
+	}
 	/*
 	 * @函数名closeFile
 	 * @参数fileID:用于区别已经打开的文件
-	 * 功能:关闭文件
+	 * 功能:关闭文件，之后fileID可能分配给别的文件
+	 *           文件的页面必须已经从缓存中去掉(BufPageManager::invalidateFile)
 	 * 返回:操作成功，返回0
 	 */
 	int closeFile(int fileID) {
@@ -112,11 +511,42 @@ public:
 		fm->setBit(fileID, 1);
 		int f = fd[fileID];
 		*/
+		lock_guard<mutex> guard(latch);
 		fmap.erase(fmap.find(fileNames[fileID]));
+		_unmap(fileID);
+		delete zip[fileID];
+		zip[fileID] = NULL;
 		int f = files[fileID];
 		close(f);
+		freeIDs.push_back(fileID);
 		return 0;
 	}
+	/*
+	 * @函数名getFileName
+	 * @参数fileID:文件id
+	 * 返回:打开文件时使用的文件名
+	 */
+	string getFileName(int fileID) {
+		lock_guard<mutex> guard(latch);
+		return fileNames[fileID];
+	}
+	/*
+	 * @函数名openFilesUnder
+	 * @参数path:文件名或者目录名
+	 * 返回:已经打开的文件中，文件名为path或者在目录path下的文件的id
+	 */
+	vector<int> openFilesUnder(const string& path) {
+		lock_guard<mutex> guard(latch);
+		vector<int> ids;
+		for (const auto& it : fmap) {
+			const string& name = it.first;
+			if (name.compare(0, path.size(), path) == 0
+					&& (name.size() == path.size() || name[path.size()] == '/' || path.back() == '/')) {
+				ids.push_back(it.second);
+			}
+		}
+		return ids;
+	}
 	/*
 	 * @函数名createFile
 	 * @参数name:文件名
@@ -140,10 +570,12 @@ public:
 		fm->setBit(fileID, 0);
 		_openFile(name, fileID);
 		*/
+		lock_guard<mutex> guard(latch);
 		if (fmap.find(name) != fmap.end()) fileID = fmap[name];
 		else {
-			fmap[name] = fileID = files.size();
-			_openFile(name);
+			if (_openFile(name, fileID)) return false;
+			fmap[name] = fileID;
+			_map(fileID);
 		}
 		return true;
 	}
@@ -0,0 +1,194 @@
+#ifndef LZ_CODEC
+#define LZ_CODEC
+#include <stdint.h>
+#include <string.h>
+/*
+ * LZCodec
+ * 压缩缓存页面用的LZ77压缩，格式与LZ4的块格式相同：
+ * 每个序列是一个控制字节(高4位字面量长度，低4位匹配长度-4，取15时后面跟着若干个表示剩余长度的字节)、
+ * 字面量、2字节小端的匹配距离；最后一个序列只有字面量
+ * 只用于不超过64KB的输入，匹配距离和hash表中的位置都可以用16位表示
+ */
+class LZCodec {
+private:
+	static const int MIN_MATCH = 4;
+	static const int HASH_BITS = 12;
+	/*
+	 * 最后LAST_LITERALS个字节总是作为字面量，匹配只在结尾MATCH_LIMIT个字节之前开始，
+	 * 查找匹配时按4字节读不会越过输入的结尾
+	 */
+	static const int LAST_LITERALS = 5;
+	static const int MATCH_LIMIT = 12;
+	static uint32_t read32(const uint8_t* p) {
+		uint32_t v;
+		memcpy(&v, p, 4);
+		return v;
+	}
+	static int hash(uint32_t v) {
+		return (int)((v * 2654435761u) >> (32 - HASH_BITS));
+	}
+	/*
+	 * 写长度超过15的部分，空间不够时返回NULL
+	 */
+	static uint8_t* writeLength(uint8_t* op, const uint8_t* end, int len) {
+		for (; len >= 255; len -= 255) {
+			if (op >= end) {
+				return NULL;
+			}
+			*op++ = 255;
+		}
+		if (op >= end) {
+			return NULL;
+		}
+		*op++ = (uint8_t)len;
+		return op;
+	}
+	static uint8_t* writeSequence(uint8_t* op, const uint8_t* end, const uint8_t* lit, int litLen, int offset, int matchLen) {
+		if (op >= end) {
+			return NULL;
+		}
+		uint8_t* token = op++;
+		*token = (uint8_t)((litLen >= 15 ? 15 : litLen) << 4);
+		if (litLen >= 15 && (op = writeLength(op, end, litLen - 15)) == NULL) {
+			return NULL;
+		}
+		if (end - op < litLen) {
+			return NULL;
+		}
+		memcpy(op, lit, litLen);
+		op += litLen;
+		if (matchLen == 0) {
+			return op;
+		}
+		if (end - op < 2) {
+			return NULL;
+		}
+		*op++ = (uint8_t)offset;
+		*op++ = (uint8_t)(offset >> 8);
+		int m = matchLen - MIN_MATCH;
+		*token |= (uint8_t)(m >= 15 ? 15 : m);
+		if (m >= 15 && (op = writeLength(op, end, m - 15)) == NULL) {
+			return NULL;
+		}
+		return op;
+	}
+public:
+	/*
+	 * @函数名compress
+	 * @参数src:输入，n不超过65536
+	 * @参数dst:输出缓冲区，cap为它的大小
+	 * 返回:压缩后的字节数；压缩后不小于cap时返回0，调用者应当保存原始数据
+	 */
+	static int compress(const void* src, int n, void* dst, int cap) {
+		const uint8_t* in = (const uint8_t*)src;
+		uint8_t* op = (uint8_t*)dst;
+		const uint8_t* end = op + cap;
+		uint16_t table[1 << HASH_BITS];
+		memset(table, 0, sizeof(table));
+		const uint8_t* anchor = in;
+		const uint8_t* ip = in + 1;
+		const uint8_t* limit = n > MATCH_LIMIT ? in + n - MATCH_LIMIT : in;
+		while (ip < limit) {
+			uint32_t v = read32(ip);
+			int h = hash(v);
+			const uint8_t* ref = in + table[h];
+			table[h] = (uint16_t)(ip - in);
+			if (ref >= ip || read32(ref) != v) {
+				++ ip;
+				continue;
+			}
+			// 向前扩展匹配
+			while (ip > anchor && ref > in && ip[-1] == ref[-1]) {
+				-- ip;
+				-- ref;
+			}
+			const uint8_t* mp = ip + MIN_MATCH;
+			const uint8_t* mref = ref + MIN_MATCH;
+			const uint8_t* matchEnd = in + n - LAST_LITERALS;
+			while (mp < matchEnd && *mp == *mref) {
+				++ mp;
+				++ mref;
+			}
+			op = writeSequence(op, end, anchor, (int)(ip - anchor), (int)(ip - ref), (int)(mp - ip));
+			if (op == NULL) {
+				return 0;
+			}
+			ip = anchor = mp;
+			if (ip - 2 >= in && ip < limit) {
+				table[hash(read32(ip - 2))] = (uint16_t)(ip - 2 - in);
+			}
+		}
+		op = writeSequence(op, end, anchor, (int)(in + n - anchor), 0, 0);
+		if (op == NULL || op >= end) {
+			return 0;
+		}
+		return (int)(op - (uint8_t*)dst);
+	}
+	/*
+	 * @函数名decompress
+	 * @参数src:compress的输出，n为它的字节数
+	 * @参数dst:输出缓冲区，解压后必须正好是outSize个字节
+	 * 返回:数据完整时返回true
+	 */
+	static bool decompress(const void* src, int n, void* dst, int outSize) {
+		const uint8_t* ip = (const uint8_t*)src;
+		const uint8_t* iend = ip + n;
+		uint8_t* out = (uint8_t*)dst;
+		uint8_t* op = out;
+		uint8_t* oend = out + outSize;
+		while (ip < iend) {
+			int token = *ip++;
+			int litLen = token >> 4;
+			if (litLen == 15) {
+				int b;
+				do {
+					if (ip >= iend) {
+						return false;
+					}
+					b = *ip++;
+					litLen += b;
+				} while (b == 255);
+			}
+			if (iend - ip < litLen || oend - op < litLen) {
+				return false;
+			}
+			memcpy(op, ip, litLen);
+			op += litLen;
+			ip += litLen;
+			if (ip == iend) {
+				break;
+			}
+			if (iend - ip < 2) {
+				return false;
+			}
+			int offset = ip[0] | (ip[1] << 8);
+			ip += 2;
+			int matchLen = (token & 15) + MIN_MATCH;
+			if ((token & 15) == 15) {
+				int b;
+				do {
+					if (ip >= iend) {
+						return false;
+					}
+					b = *ip++;
+					matchLen += b;
+				} while (b == 255);
+			}
+			if (offset == 0 || offset > op - out || oend - op < matchLen) {
+				return false;
+			}
+			const uint8_t* ref = op - offset;
+			if (offset >= matchLen) {
+				memcpy(op, ref, matchLen);
+			} else {
+				// 匹配与输出重叠，逐字节复制
+				for (int i = 0; i < matchLen; ++ i) {
+					op[i] = ref[i];
+				}
+			}
+			op += matchLen;
+		}
+		return op == oend;
+	}
+};
+#endif
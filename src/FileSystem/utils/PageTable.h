@@ -0,0 +1,197 @@
+#ifndef PAGE_TABLE
+#define PAGE_TABLE
+#include <stdint.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "MyHashMap.h"
+/*
+ * PageTable
+ * 缓存管理器的页表：(fileID,pageID) -> 缓存页面下标，接口与MyHashMap相同
+ * 开放定址，槽位按16个一组，每个槽位有一个控制字节：空、已删除，或者键的hash值的低7位(tag)
+ * 查找时用SSE2一次比较一组的16个tag，只有tag相同的槽位才去比较键
+ * 一组中还有空槽位时查找就可以结束，因此删除时只有所在组已经没有空槽位才需要留下"已删除"标记
+ * 空槽位少于1/8时原地重建，清除"已删除"标记
+ * 槽位数是2的幂，至少为容量的2倍，页表中的键不会超过容量，因此不需要扩容
+ */
+class PageTable {
+private:
+	static const int GROUP = 16;
+	static const uint8_t EMPTY = 0x80;
+	static const uint8_t DELETED = 0xFE;
+	int CAP_;
+	int groups, mask;
+	int emptyLeft;
+	uint8_t* ctrl;
+	int* slot;
+	/*
+	 * where[value]:value所在的槽位，不在页表中时为-1
+	 */
+	int* where;
+	DataNode* a;
+	static uint64_t hash(int k1, int k2) {
+		uint64_t h = ((uint64_t)(uint32_t)k1 << 32) | (uint32_t)k2;
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdULL;
+		h ^= h >> 33;
+		h *= 0xc4ceb9fe1a85ec53ULL;
+		h ^= h >> 33;
+		return h;
+	}
+	/*
+	 * 返回一组控制字节中等于c的槽位的位图
+	 */
+	static unsigned match(const uint8_t* g, uint8_t c) {
+#ifdef __SSE2__
+		__m128i v = _mm_loadu_si128((const __m128i*)g);
+		return (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8((char)c)));
+#else
+		unsigned m = 0;
+		for (int i = 0; i < GROUP; ++ i) {
+			m |= (unsigned)(g[i] == c) << i;
+		}
+		return m;
+#endif
+	}
+	/*
+	 * 返回一组控制字节中空或已删除的槽位的位图(这两种控制字节的最高位为1)
+	 */
+	static unsigned matchFree(const uint8_t* g) {
+#ifdef __SSE2__
+		return (unsigned)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)g));
+#else
+		unsigned m = 0;
+		for (int i = 0; i < GROUP; ++ i) {
+			m |= (unsigned)(g[i] >> 7) << i;
+		}
+		return m;
+#endif
+	}
+	/*
+	 * 把value放进(k1,k2)的探查序列上第一个空或已删除的槽位
+	 */
+	void insert(int value, uint64_t h) {
+		int g = (int)(h >> 7) & mask;
+		for (int step = 1; ; g = (g + step ++) & mask) {
+			unsigned m = matchFree(ctrl + g * GROUP);
+			if (m != 0) {
+				int pos = g * GROUP + __builtin_ctz(m);
+				if (ctrl[pos] == EMPTY) {
+					-- emptyLeft;
+				}
+				ctrl[pos] = (uint8_t)(h & 0x7f);
+				slot[pos] = value;
+				where[value] = pos;
+				return;
+			}
+		}
+	}
+	void erase(int pos) {
+		int g = pos / GROUP;
+		if (match(ctrl + g * GROUP, EMPTY) != 0) {
+			ctrl[pos] = EMPTY;
+			++ emptyLeft;
+		} else {
+			ctrl[pos] = DELETED;
+		}
+	}
+	void rebuild() {
+		memset(ctrl, EMPTY, groups * GROUP);
+		emptyLeft = groups * GROUP;
+		for (int i = 0; i < CAP_; ++ i) {
+			if (where[i] != -1) {
+				insert(i, hash(a[i].key1, a[i].key2));
+			}
+		}
+	}
+public:
+	/*
+	 * @函数名findIndex
+	 * 返回:(k1,k2)对应的value，没有找到时返回-1
+	 */
+	int findIndex(int k1, int k2) {
+		uint64_t h = hash(k1, k2);
+		uint8_t tag = (uint8_t)(h & 0x7f);
+		int g = (int)(h >> 7) & mask;
+		for (int step = 1; ; g = (g + step ++) & mask) {
+			const uint8_t* c = ctrl + g * GROUP;
+			for (unsigned m = match(c, tag); m != 0; m &= m - 1) {
+				int value = slot[g * GROUP + __builtin_ctz(m)];
+				if (a[value].key1 == k1 && a[value].key2 == k2) {
+					return value;
+				}
+			}
+			if (match(c, EMPTY) != 0) {
+				return -1;
+			}
+		}
+	}
+	/*
+	 * @函数名replace
+	 * 功能:将value对应的键设置为(k1,k2)，value原来的键被删掉
+	 *           调用者保证(k1,k2)不在页表中
+	 */
+	void replace(int value, int k1, int k2) {
+		if (where[value] != -1) {
+			erase(where[value]);
+		}
+		if (emptyLeft <= groups * GROUP / 8) {
+			where[value] = -1;
+			rebuild();
+		}
+		a[value].key1 = k1;
+		a[value].key2 = k2;
+		insert(value, hash(k1, k2));
+	}
+	/*
+	 * @函数名remove
+	 * 功能:在页表中删掉value
+	 */
+	void remove(int value) {
+		if (where[value] != -1) {
+			erase(where[value]);
+			where[value] = -1;
+		}
+		a[value].key1 = -1;
+		a[value].key2 = -1;
+	}
+	/*
+	 * @函数名getKeys
+	 * 功能:取出value对应的键，value不在页表中时为(-1,-1)
+	 */
+	void getKeys(int value, int& k1, int& k2) {
+		k1 = a[value].key1;
+		k2 = a[value].key2;
+	}
+	/*
+	 * 构造函数
+	 * @参数c:value的个数上限，value取值为[0, c)
+	 */
+	PageTable(int c) {
+		CAP_ = c;
+		groups = 1;
+		while (groups * GROUP < 2 * c) {
+			groups <<= 1;
+		}
+		mask = groups - 1;
+		ctrl = new uint8_t[groups * GROUP];
+		slot = new int[groups * GROUP];
+		where = new int[c];
+		a = new DataNode[c];
+		for (int i = 0; i < c; ++ i) {
+			where[i] = -1;
+			a[i].key1 = -1;
+			a[i].key2 = -1;
+		}
+		memset(ctrl, EMPTY, groups * GROUP);
+		emptyLeft = groups * GROUP;
+	}
+	~PageTable() {
+		delete[] ctrl;
+		delete[] slot;
+		delete[] where;
+		delete[] a;
+	}
+};
+#endif
@@ -18,18 +18,84 @@
  * 页面字节数以2为底的指数
  */
 #define PAGE_SIZE_IDX 13
+/*
+ * 创建数据库时可以选择的页面字节数的指数上限，页面为PAGE_SIZE到MAX_PAGE_SIZE(8KB到64KB)
+ * 页面不是PAGE_SIZE的数据库使用自己的缓存，见FileSystem::openPool
+ */
+#define MAX_PAGE_SIZE_IDX 16
+#define MAX_PAGE_SIZE (1 << MAX_PAGE_SIZE_IDX)
 #define MAX_FMT_INT_NUM 128
 //#define BUF_PAGE_NUM 65536
-#define MAX_FILE_NUM 128
+/*
+ * 同时打开的文件个数上限
+ */
+#define MAX_FILE_NUM 4096
 #define MAX_TYPE_NUM 256
 /*
- * 缓存中页面个数上限
+ * 缓存中页面个数的默认值，可以用启动参数--buffer_pool_size或SET buffer_pool_size修改
+ * 每个分片的页表(PageTable)按分片的页面个数建立，随缓存大小一起重建
  */
 #define CAP 60000
 /*
- * hash算法的模
+ * 运行时缓存可以扩大到的页面个数，缓存页面区按它预留地址空间(8GB)
+ */
+#define BUF_MAX_CAPACITY (1 << 20)
+/*
+ * 每个分片至少的页面个数，避免后台写回、预读暂时pin住分片中所有的页面
+ */
+#define BUF_MIN_SHARD_PAGES 8
+/*
+ * 缓存分片个数，每个分片有独立的hash表、替换算法和锁
+ */
+#define BUF_SHARD_NUM 16
+/*
+ * 大表顺序扫描使用的私有环形缓存的页面个数
+ * 页数超过缓存容量1/BUF_RING_SCAN_DIV的表扫描时使用环形缓存
+ */
+#define BUF_RING_SIZE 32
+#define BUF_RING_SCAN_DIV 4
+/*
+ * 后台写回线程的唤醒间隔(毫秒)，以及每个分片保持干净的页面比例(1/BUF_CLEAN_RESERVE)
+ */
+#define BUF_FLUSH_INTERVAL 100
+#define BUF_CLEAN_RESERVE 16
+/*
+ * 异步IO的队列深度和线程池实现的工作线程个数
+ */
+#define AIO_DEPTH 64
+#define AIO_WORKERS 4
+/*
+ * 顺序预读窗口的初始值和上限(页)
+ */
+#define BUF_READAHEAD_MIN 8
+#define BUF_READAHEAD_MAX 64
+/*
+ * 缓存页面的访问时间(tick)在每次读入页面，以及每个分片每BUF_TICK_ACCESSES次访问时加一
+ * 预热dump时按它比较不同分片中页面的冷热
+ */
+#define BUF_TICK_ACCESSES 64
+/*
+ * 压缩缓存中一个页面压缩后的字节数上限，压缩不到这个大小的页面不放入
+ */
+#define BUF_TIER_MAX_BYTES (PAGE_SIZE * 3 / 4)
+/*
+ * 映射文件中页号所占的位数，与fileID一起编码成负的缓存页面下标，见BufPageManager::mapIndex
+ * 每个文件最多映射前(1 << MAP_PAGE_BITS)页，之后的页面仍然使用缓存
+ */
+#define MAP_PAGE_BITS 18
+/*
+ * 大页的大小，大小固定的缓存页面区按它取整后尝试MAP_HUGETLB，discard也按它取整
+ */
+#define BUF_HUGE_PAGE_SIZE (2 << 20)
+/*
+ * O_DIRECT要求的缓冲区、偏移和长度的对齐
+ */
+#define DIRECT_IO_ALIGN 4096
+/*
+ * 压缩的文件中分配空间的单位(扇区)的字节数以2为底的指数，页面压缩后占若干个连续的扇区
  */
-#define MOD 60000
+#define ZIP_SECTOR_IDX 9
+#define ZIP_SECTOR (1 << ZIP_SECTOR_IDX)
 #define IN_DEBUG 0
 #define DEBUG_DELETE 0
 #define DEBUG_ERASE 1
@@ -1,3 +1,4 @@
+#include <cstdio>
 #include <vector>
 #include <cstring>
 
@@ -7,7 +8,12 @@ using namespace std;
 
 const int C_DATA = 0;
 const int F_DATA = 1;
-const int EXLEN = 2;
+// page 0 of the current format: magic and format after the page header
+const int M_DATA = 2;
+const int V_DATA = 3;
+const int EXLEN = 4;
+
+const int INDEX_MAGIC = 0x4d494458;
 
 const int INDEX_LEAF_BIT = 1<<15;
 
@@ -18,6 +24,7 @@ IndexHandler::IndexHandler() {
 }
 
 IndexHandler::~IndexHandler() {
+    _guard.release();
     FileSystem::release();
 }
 
@@ -25,24 +32,28 @@ int IndexHandler::createIndex(const char* fileName, int numKey) {
     int flag = 0;
     flag |= !_fm->createFile(fileName);
     flag |= !_fm->openFile(fileName, _fileID);
-    _init(numKey);
-    _data = (int*)_bpm->allocPage(_fileID, 0, _pageIndex, false);
-    _bpm->markDirty(_pageIndex);
+    _init(numKey, INDEX_FORMAT);
+    _guard = _bpm->allocPageGuard(_fileID, 0);
+    _data = (int*)_guard.get();
+    _guard.markDirty();
     _data[C_DATA] = INDEX_LEAF_BIT;
     _data[F_DATA] = _endPage = 0;
+    _data[M_DATA] = INDEX_MAGIC;
+    _data[V_DATA] = INDEX_FORMAT;
     return flag;
 }
 
-int IndexHandler::openIndex(const char* fileName, int numKey) {
+int IndexHandler::openIndex(const char* fileName, int numKey, int format) {
     int flag = 0;
     flag |= !_fm->openFile(fileName, _fileID);
-    _init(numKey);
+    if (format < INDEX_FORMAT) flag |= _upgrade(fileName, numKey);
     _openPage(0);
+    _init(numKey, INDEX_FORMAT);
     _endPage = _data[F_DATA];
     return flag;
 }
 
-void IndexHandler::ins(const int* keys, int val) {
+void IndexHandler::ins(const int* keys, long long val) {
     vector<pair<int,int>> nodes;
     nodes.push_back(make_pair(0,0));
     while (true) {
@@ -50,10 +61,10 @@ void IndexHandler::ins(const int* keys, int val) {
         if (_data[C_DATA] & INDEX_LEAF_BIT) break;
         int pos = _upperBound(1, _data[C_DATA], keys) - 1;
         if (_less(keys, _dataKeys(pos))) {
-            _bpm->markDirty(_pageIndex);
+            _guard.markDirty();
             _moveKeys(_dataKeys(pos), keys);
         }
-        nodes.push_back(make_pair(_dataVal(pos), pos));
+        nodes.push_back(make_pair((int)_dataVal(pos), pos));
     }
     int size = _data[C_DATA] & ~INDEX_LEAF_BIT;
     int pos = _upperBound(0, size, keys);
@@ -63,24 +74,24 @@ void IndexHandler::ins(const int* keys, int val) {
 
     while (true) {
         // insert
-        _bpm->markDirty(_pageIndex);
+        _guard.markDirty();
         for (int i = size; i > pos; --i) {
             _moveKeys(_dataKeys(i), _dataKeys(i-1));
-            _dataVal(i) = _dataVal(i-1);
+            _setDataVal(i, _dataVal(i-1));
         }
         _moveKeys(_dataKeys(pos), keysBuf);
-        _dataVal(pos) = val;
+        _setDataVal(pos, val);
         ++_data[C_DATA];
 
         if (size < _nodeSize) break;
         // split
         newPage = true;
-        int _page2Index;
-        int* _data2 = (int*)_bpm->allocPage(_fileID, ++_endPage, _page2Index, false);
-        _bpm->markDirty(_page2Index);
+        PageGuard guard2 = _bpm->allocPageGuard(_fileID, ++_endPage);
+        int* _data2 = (int*)guard2.get();
+        guard2.markDirty();
         int size1 = (size>>1) + 1, size2 = size+1 >> 1;
         _data2[C_DATA] = (_data[C_DATA] & INDEX_LEAF_BIT) | size2;
-        memcpy(_data2+EXLEN, _dataKeys(size1), (_numKey+1)*size2*sizeof(int));
+        memcpy(_data2+_exLen, _dataKeys(size1), (_numKey+_valInts)*size2*sizeof(int));
         _data[C_DATA] -= size2;
 
         // pushup
@@ -90,15 +101,15 @@ void IndexHandler::ins(const int* keys, int val) {
         nodes.pop_back();
         // is root
         if (nodes.empty()) {
-            int _page1Index;
-            int* _data1 = (int*)_bpm->allocPage(_fileID, ++_endPage, _page1Index, false);
-            _bpm->markDirty(_page1Index);
-            memcpy(_data1, _data, (EXLEN + (_numKey+1)*size1) * sizeof(int));
+            PageGuard guard1 = _bpm->allocPageGuard(_fileID, ++_endPage);
+            int* _data1 = (int*)guard1.get();
+            guard1.markDirty();
+            memcpy(_data1, _data, (_exLen + (_numKey+_valInts)*size1) * sizeof(int));
 
             _data[C_DATA] = 2;
-            _dataVal(0) = _endPage;
+            _setDataVal(0, _endPage);
             _moveKeys(_dataKeys(1), keysBuf);
-            _dataVal(1) = val;
+            _setDataVal(1, val);
             break;
         }
         
@@ -109,13 +120,13 @@ void IndexHandler::ins(const int* keys, int val) {
 
     if (newPage) {
         _openPage(0);
-        _bpm->markDirty(_pageIndex);
+        _guard.markDirty();
         _data[F_DATA] = _endPage;
     }
     delete[] keysBuf;
 }
 
-void IndexHandler::del(const int* keys, int val) {
+void IndexHandler::del(const int* keys, long long val) {
     Iterator it = lowerBound(keys);
     for(; !it.isEnd(); ++it) if (*it == val) break;
     if (it.isEnd()) {
@@ -125,20 +136,21 @@ void IndexHandler::del(const int* keys, int val) {
     while (true) {
         int page = it._stack.back().first, slot = it._stack.back().second;
         _openPage(page);
-        _bpm->markDirty(_pageIndex);
+        _guard.markDirty();
         int size = _data[C_DATA] & ~INDEX_LEAF_BIT;
         for (int i = slot; i < size - 1; ++i) {
             _moveKeys(_dataKeys(i), _dataKeys(i+1));
-            _dataVal(i) = _dataVal(i+1);
+            _setDataVal(i, _dataVal(i+1));
         }
         --_data[C_DATA];
         // to be easier, delete node only when empty
         if (page == 0 || size > 1) break;
         it._stack.pop_back();
+        if (it._ahead.size() > it._stack.size()) it._ahead.resize(it._stack.size());
     }
 }
 
-void IndexHandler::upd(const int* oldKeys, int oldVal, const int* newKeys, int newVal) {
+void IndexHandler::upd(const int* oldKeys, long long oldVal, const int* newKeys, long long newVal) {
     bool updKey = false;
     for (int i = 0; i < _numKey; ++i) if (newKeys[i] != oldKeys[i]) updKey = true;
     if (updKey) {
@@ -154,8 +166,17 @@ void IndexHandler::upd(const int* oldKeys, int oldVal, const int* newKeys, int n
     }
     int page = it._stack.back().first, slot = it._stack.back().second;
     _openPage(page);
-    _bpm->markDirty(_pageIndex);
-    _dataVal(slot) = newVal;
+    _guard.markDirty();
+    _setDataVal(slot, newVal);
+}
+
+void IndexHandler::releasePage() {
+    _guard.release();
+}
+
+void IndexHandler::setPool(BufPageManager* bpm) {
+    _guard.release();
+    _bpm = bpm;
 }
 
 IndexHandler::Iterator IndexHandler::begin() {
@@ -163,6 +184,7 @@ IndexHandler::Iterator IndexHandler::begin() {
     _openPage(0);
     if ((_data[C_DATA] & ~INDEX_LEAF_BIT) == 0) return it;
     it._stack.push_back(make_pair(0, 0));
+    if (!(_data[C_DATA] & INDEX_LEAF_BIT)) _prefetchChildren(it, 1);
     _toLLeaf(it);
     return it;
 }
@@ -215,9 +237,36 @@ IndexHandler::Iterator IndexHandler::find(const int* keys) {
     return it;
 }
 
-void IndexHandler::_init(int numKey) {
+void IndexHandler::_init(int numKey, int format) {
     _numKey = numKey;
-    _nodeSize = (PAGE_INT_NUM - EXLEN)/ (numKey + 1) - 1;
+    _exLen = format == INDEX_FORMAT_V1 ? 2 : EXLEN;
+    _valInts = format == INDEX_FORMAT_V1 ? 1 : 2;
+    int pageInts = 1 << _fm->getPageSizeIdx(_fileID) - 2;
+    _nodeSize = (pageInts - _exLen)/ (numKey + _valInts) - 1;
+}
+
+// rewrite the open file, of the first format, as <fileName>.upgrade in the current format and move it over
+int IndexHandler::_upgrade(const char* fileName, int numKey) {
+    _init(numKey, INDEX_FORMAT_V1);
+    vector<int> keys;
+    vector<long long> vals;
+    for (Iterator it = begin(); !it.isEnd(); ++it) {
+        vals.push_back(*it);
+        int* dataKeys = _dataKeys(it._stack.back().second);
+        keys.insert(keys.end(), dataKeys, dataKeys + numKey);
+    }
+    _guard.release();
+    FileSystem::closeFiles(fileName, false);
+
+    string upgraded = string(fileName) + ".upgrade";
+    remove(upgraded.c_str());
+    int flag = createIndex(upgraded.c_str(), numKey);
+    for (size_t i = 0; i < vals.size(); ++i) ins(keys.data() + i*numKey, vals[i]);
+    _guard.release();
+    FileSystem::closeFiles(upgraded, false);
+    flag |= rename(upgraded.c_str(), fileName) != 0;
+    flag |= !_fm->openFile(fileName, _fileID);
+    return flag;
 }
 
 void IndexHandler::_moveKeys(int* dest, const int* source) {
@@ -225,15 +274,26 @@ void IndexHandler::_moveKeys(int* dest, const int* source) {
 }
 
 void IndexHandler::_openPage(int page) {
-    _data = (int*)_bpm->getPage(_fileID, page, _pageIndex);
+    if (_guard.holds(_fileID, page)) return;
+    _guard = _bpm->getPageGuard(_fileID, page);
+    _data = (int*)_guard.get();
 }
 
 int* IndexHandler::_dataKeys(int slot) {
-    return _data + EXLEN + (_numKey+1)*slot;
+    return _data + _exLen + (_numKey+_valInts)*slot;
+}
+
+// values of the current format are not 8-byte aligned when the entries have an odd number of keys
+long long IndexHandler::_dataVal(int slot) {
+    int* p = _dataKeys(slot) + _numKey;
+    if (_valInts == 1) return *p;
+    long long val;
+    memcpy(&val, p, sizeof(val));
+    return val;
 }
 
-int& IndexHandler::_dataVal(int slot) {
-    return _data[EXLEN + (_numKey+1)*slot + _numKey];
+void IndexHandler::_setDataVal(int slot, long long val) {
+    memcpy(_dataKeys(slot) + _numKey, &val, sizeof(val));
 }
 
 bool IndexHandler::_less(const int* keys1, const int* keys2) {
@@ -262,7 +322,7 @@ int IndexHandler::_upperBound(int begin, int end, const int* keys) {
     return res;
 }
 
-int IndexHandler::_getVal(const Iterator& it) {
+long long IndexHandler::_getVal(const Iterator& it) {
     _openPage(it._stack.back().first);
     return _dataVal(it._stack.back().second);
 }
@@ -274,14 +334,34 @@ void IndexHandler::_toLLeaf(Iterator& it) {
         page = _dataVal(slot); slot = 0;
         it._stack.push_back(make_pair(page, slot));
         _openPage(page);
+        if (!(_data[C_DATA] & INDEX_LEAF_BIT)) _prefetchChildren(it, 1);
     }
 }
 
+// leaves are not contiguous in the file, so the children of an inner node a scan goes through are prefetched
+// explicitly: a window when the scan enters the node, and the next one, starting where the last ended,
+// once the scan is half way through the last; next is the first child the scan has not read yet
+void IndexHandler::_prefetchChildren(Iterator& it, int next) {
+    int level = it._stack.size() - 1;
+    if (it._ahead.size() <= level) it._ahead.resize(level + 1, 0);
+    int& ahead = it._ahead[level];
+    if (next + BUF_READAHEAD_MIN / 2 < ahead) return;
+    int size = _data[C_DATA] & ~INDEX_LEAF_BIT;
+    int from = max(ahead, next);
+    ahead = min(from + BUF_READAHEAD_MIN, size);
+    vector<int> pages;
+    for (int i = from; i < ahead; ++i)
+        pages.push_back(_dataVal(i));
+    if (!pages.empty()) _bpm->prefetch(_fileID, pages);
+}
+
 void IndexHandler::_toNext(Iterator& it) {
     while(!it._stack.empty()) {
         int page = it._stack.back().first, slot = it._stack.back().second;
         _openPage(page);
-        if (slot + 1 < (_data[C_DATA] & ~INDEX_LEAF_BIT)) {
+        int size = _data[C_DATA] & ~INDEX_LEAF_BIT;
+        if (slot + 1 < size) {
+            if (!(_data[C_DATA] & INDEX_LEAF_BIT)) _prefetchChildren(it, slot + 2);
             it._stack.back() = make_pair(page, slot+1);
             _toLLeaf(it);
             return;
@@ -290,7 +370,7 @@ void IndexHandler::_toNext(Iterator& it) {
     }
 }
 
-int IndexHandler::Iterator::operator*() {
+long long IndexHandler::Iterator::operator*() {
     return _handler->_getVal(*this);
 }
 
@@ -7,20 +7,33 @@
 
 using namespace std;
 
+// Index file layouts, the schema of the index's table records which one its files use.
+// v1: an int value per entry, two ints in front of the entries of a page
+const int INDEX_FORMAT_V1 = 1;
+// v2: a long long value per entry, four ints in front of the entries; page 0 also holds a magic and the format
+const int INDEX_FORMAT_V2 = 2;
+const int INDEX_FORMAT = INDEX_FORMAT_V2;
+
 class IndexHandler {
 public:
 	IndexHandler();
 	~IndexHandler();
 	int createIndex(const char* fileName, int numKey);
-	int openIndex(const char* fileName, int numKey);
+	// a file of an older format, as recorded by its table's schema, is rewritten in the current format
+	int openIndex(const char* fileName, int numKey, int format = INDEX_FORMAT);
+	// unpin the page kept between calls, e.g. before the buffer pool is resized
+	void releasePage();
+	// cache pages in bpm from now on, e.g. the pool of the database being used
+	void setPool(BufPageManager* bpm);
 
-	void ins(const int* keys, int val);
-	void del(const int* keys, int val);
-	void upd(const int* oldKeys, int oldVal, const int* newKeys, int newVal);
+	// values are record ids, RecordHandler::Iterator::toInt()
+	void ins(const int* keys, long long val);
+	void del(const int* keys, long long val);
+	void upd(const int* oldKeys, long long oldVal, const int* newKeys, long long newVal);
 
 	class Iterator {
 	public:
-		int operator*();
+		long long operator*();
         Iterator& operator++();
         Iterator operator++(int);
         bool isEnd() const;
@@ -30,6 +43,8 @@ public:
 		friend class IndexHandler;
 		IndexHandler* _handler;
 		vector<pair<int,int>> _stack;
+		// for the inner nodes on _stack, the slot after the last child prefetched, missing or 0 before the first window
+		vector<int> _ahead;
 		Iterator(IndexHandler* handler):_handler(handler){}
 	};
 	
@@ -43,17 +58,23 @@ private:
 	FileManager* _fm;
 	BufPageManager* _bpm;
 	int _numKey, _nodeSize, _endPage;
-    int _fileID, _pageIndex;
+	// ints in front of the entries of a page, and ints of the value of an entry
+	int _exLen, _valInts;
+    int _fileID;
+    PageGuard _guard;
     int* _data;
-	void _init(int numKey);
+	void _init(int numKey, int format);
+	int _upgrade(const char* fileName, int numKey);
 	inline void _moveKeys(int* dest, const int* source);
     void _openPage(int page);
 	inline int* _dataKeys(int slot);
-	inline int& _dataVal(int slot);
+	inline long long _dataVal(int slot);
+	inline void _setDataVal(int slot, long long val);
 	bool _less(const int* keys1, const int* keys2);
 	int _lowerBound(int begin, int end, const int* keys);
 	int _upperBound(int begin, int end, const int* keys);
-	int _getVal(const Iterator& it);
+	long long _getVal(const Iterator& it);
 	void _toLLeaf(Iterator& it);
 	void _toNext(Iterator& it);
+	void _prefetchChildren(Iterator& it, int next);
 };
\ No newline at end of file
@@ -11,7 +11,7 @@ const char *string_to_char(std::string s) {
     return strdup(s.c_str());
 }
 
-MyVisitor::MyVisitor(DBManager *db_manager) : db_manager(db_manager) {}
+MyVisitor::MyVisitor(DBManager *db_manager, bool compress_tables) : db_manager(db_manager), compress_tables(compress_tables) {}
 
 antlrcpp::Any MyVisitor::visitProgram(SQLParser::ProgramContext *context) {
     for (auto statement : context->statement()) {
@@ -21,6 +21,10 @@ antlrcpp::Any MyVisitor::visitProgram(SQLParser::ProgramContext *context) {
         catch(DBException e) {
             results.push_back(string_to_char(e.what()));
         }
+        // the statement stops where it could not get a page, later statements go on
+        catch(const BufferFullError &e) {
+            results.push_back(string_to_char(e.what()));
+        }
     }
     return antlrcpp::Any(results);
 }
@@ -79,6 +83,7 @@ antlrcpp::Any MyVisitor::visitDump_data(SQLParser::Dump_dataContext *context) {
 antlrcpp::Any MyVisitor::visitCreate_table(SQLParser::Create_tableContext *context) {
     Schema schema;
     schema.table_name = context->Identifier()->getText();
+    schema.compressed = compress_tables;
     for (auto field : context->field_list()->field()) {
         auto r = field->accept(this);
         try {
@@ -305,20 +310,12 @@ antlrcpp::Any MyVisitor::visitValue(SQLParser::ValueContext *context) {
     if(context->Null()) {
         v.type = NULL_TYPE;
     }else if(auto i = context->Integer()){
-        v.type = INT;
-        int value = std::stoi(i->getText());
-        uint8_t *bytes = static_cast<uint8_t *>(static_cast<void *>(&value));
-        v.bytes = vector<uint8_t>(bytes, bytes + 4);
+        v = std::stoi(i->getText());
     }else if(auto f = context->Float()){
-        v.type = FLOAT;
-        float value = std::stof(f->getText());
-        uint8_t *bytes = static_cast<uint8_t *>(static_cast<void *>(&value));
-        v.bytes = vector<uint8_t>(bytes, bytes + 4);
+        v = std::stof(f->getText());
     }else if(auto s = context->String()) {
-        v.type = VARCHAR;
         string value = s->getText();
-        value.erase(0, 1); value.pop_back();
-        v.bytes = vector<uint8_t>(value.begin(), value.end());
+        v = Value(VARCHAR, value.data() + 1, value.size() - 2);
     }
     return antlrcpp::Any(v);
 }
@@ -375,9 +372,8 @@ antlrcpp::Any MyVisitor::visitWhere_like_string(SQLParser::Where_like_stringCont
     Condition cond;
     cond.a = context->column()->accept(this).as<QueryCol>();
     cond.op = LIKE;
-    cond.b_val.type = VARCHAR;
     string s = context->String()->getText();
-    cond.b_val.bytes = vector<uint8_t>(s.begin()+1, s.end()-1);
+    cond.b_val = Value(VARCHAR, s.data() + 1, s.size() - 2);
     return antlrcpp::Any(cond);
 }
 
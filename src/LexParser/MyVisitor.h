@@ -8,9 +8,11 @@
 class MyVisitor : public SQLVisitor {
     std::vector<antlrcpp::Any> results;
     DBManager *db_manager;
+    // tables created by the statements are page-compressed, for CREATE TABLE ... WITH COMPRESSION
+    bool compress_tables;
 
    public:
-    MyVisitor(DBManager *db_manager);
+    MyVisitor(DBManager *db_manager, bool compress_tables = false);
 
     antlrcpp::Any visitProgram(SQLParser::ProgramContext *context);
 
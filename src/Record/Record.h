@@ -1,15 +1,42 @@
 #pragma once
 
+#include <cstdint>
+#include <cstring>
 #include <iostream>
+#include <string_view>
 #include <vector>
 
 using namespace std;
 
+// Record layouts. A file keeps the one it was created with, its table's schema records which.
+// Both start with the NULL bits of the ints then the varchars, followed by the ints.
+// v1: each non-NULL varchar as its uint16 length and bytes, one after another
+const int RECORD_FORMAT_V1 = 1;
+// v2: a uint16 end offset per varchar (NULLs end where the previous one does), then their bytes,
+// so that any field is found without walking the others
+const int RECORD_FORMAT_V2 = 2;
+// v3: v2 with an overflow bit per varchar after the NULL bits; the bytes of an overflowed varchar
+// are an OverflowPointer to the overflow pages holding the value, see RecordHandler
+const int RECORD_FORMAT_V3 = 3;
+const int RECORD_FORMAT = RECORD_FORMAT_V3;
+
+class RecordHandler;
+
+// what an overflowed varchar keeps in its record: the first of its overflow pages and its length
+struct OverflowPointer{
+    int page, len;
+};
+
 struct RecordType{
     int num_int, num_varchar;
-    RecordType(int num_int, int num_varchar)
-        :num_int(num_int), num_varchar(num_varchar){}
+    int format;
+    RecordType(int num_int, int num_varchar, int format = RECORD_FORMAT)
+        :num_int(num_int), num_varchar(num_varchar), format(format){}
     RecordType():RecordType(0,0){}
+    // bytes of the bits in front of the ints
+    int bitmap_bytes() const {
+        return num_int + num_varchar * (format >= RECORD_FORMAT_V3 ? 2 : 1) + 7 >> 3;
+    }
 };
 
 struct Record{
@@ -29,4 +56,94 @@ struct Record{
             varchar_null[i] ? (os << "NULL ") : (os << "\"" << varchar_data[i] << "\" ");
         os << std::endl;
     }
-};
\ No newline at end of file
+};
+
+// A record read in place from a page pinned by RecordHandler, in the layout of type.format.
+// Fields are decoded when asked for and nothing is copied, so the view is only valid until
+// the handler moves to another page. Overflowed varchars are read from their overflow pages
+// by the handler when asked for, into a buffer it keeps per varchar field.
+struct RecordView{
+    const uint8_t* data;
+    RecordType type;
+    RecordHandler* handler;
+    RecordView(const uint8_t* data, const RecordType& type, RecordHandler* handler = NULL)
+        :data(data), type(type), handler(handler){}
+    bool int_null(int i) const {
+        return data[i >> 3] >> (i & 7) & 1;
+    }
+    bool varchar_null(int i) const {
+        return int_null(type.num_int + i);
+    }
+    bool varchar_overflow(int i) const {
+        return type.format >= RECORD_FORMAT_V3 && int_null(type.num_int + type.num_varchar + i);
+    }
+    // the 4 bytes of int i, which need not be aligned
+    const uint8_t* int_bytes(int i) const {
+        return data + type.bitmap_bytes() + sizeof(int) * i;
+    }
+    int int_data(int i) const {
+        int x;
+        memcpy(&x, int_bytes(i), sizeof(int));
+        return x;
+    }
+    string_view varchar_data(int i) const {
+        if (varchar_overflow(i)) return overflow_data(i);
+        return varchar_stored(i);
+    }
+    // the bytes of varchar i in the record, an OverflowPointer if it overflowed;
+    // v1 walks the lengths of the varchars before i
+    string_view varchar_stored(int i) const {
+        const uint8_t* p = int_bytes(type.num_int);
+        if (type.format >= RECORD_FORMAT_V2) {
+            uint16_t begin = 0, end;
+            if (i) memcpy(&begin, p + sizeof(uint16_t) * (i - 1), sizeof(uint16_t));
+            memcpy(&end, p + sizeof(uint16_t) * i, sizeof(uint16_t));
+            return string_view((const char*)p + sizeof(uint16_t) * type.num_varchar + begin, end - begin);
+        }
+        uint16_t len = 0;
+        for (int j = 0; j <= i; ++j) if (!varchar_null(j)) {
+            p += len;
+            memcpy(&len, p, sizeof(uint16_t));
+            p += sizeof(uint16_t);
+        }
+        return string_view((const char*)p, len);
+    }
+    // reads the overflow pages through handler, defined with RecordHandler
+    string_view overflow_data(int i) const;
+    // bytes of the record
+    int size() const {
+        const uint8_t* p = int_bytes(type.num_int);
+        if (type.format >= RECORD_FORMAT_V2) {
+            uint16_t end = 0;
+            if (type.num_varchar) memcpy(&end, p + sizeof(uint16_t) * (type.num_varchar - 1), sizeof(uint16_t));
+            return p - data + sizeof(uint16_t) * type.num_varchar + end;
+        }
+        for (int i = 0; i < type.num_varchar; ++i) if (!varchar_null(i)) {
+            uint16_t len;
+            memcpy(&len, p, sizeof(uint16_t));
+            p += sizeof(uint16_t) + len;
+        }
+        return p - data;
+    }
+    Record record() const {
+        Record record(type);
+        for (int i = 0; i < type.num_int; ++i) {
+            record.int_null[i] = int_null(i);
+            record.int_data[i] = int_data(i);
+        }
+        const uint8_t* p = int_bytes(type.num_int);
+        for (int i = 0; i < type.num_varchar; ++i) {
+            record.varchar_null[i] = varchar_null(i);
+            if (record.varchar_null[i]) continue;
+            if (type.format >= RECORD_FORMAT_V2) {
+                record.varchar_data[i] = string(varchar_data(i));
+                continue;
+            }
+            uint16_t len;
+            memcpy(&len, p, sizeof(uint16_t));
+            record.varchar_data[i] = string((const char*)p + sizeof(uint16_t), len);
+            p += sizeof(uint16_t) + len;
+        }
+        return record;
+    }
+};
@@ -1,22 +1,60 @@
 #include <iostream>
 #include <cstring>
+#include <string>
+#include <climits>
 
 #include "Record.h"
 #include "RecordHandler.h"
 
-const uint16_t FLAG_BITS = (1<<15) | (1<<14);
-const uint16_t FILE_END = (1<<15) | (1<<14);
-const uint16_t PAGE_END = (1<<15);
-const uint16_t EMPTY_SLOT = (1<<14);
+// slot entries are read as 32 bits with the flags on top; pages up to 16 KB store them in two bytes
+const uint32_t FLAG_BITS = (1u<<31) | (1u<<30);
+const uint32_t FILE_END = (1u<<31) | (1u<<30);
+const uint32_t PAGE_END = (1u<<31);
+const uint32_t EMPTY_SLOT = (1u<<30);
+const int SHORT_SLOT_MAX_PAGE = 1<<14;
+
+const uint32_t HEAP_MAGIC = 0x50414548;  // "HEAP"
+const uint32_t HEAP_VERSION = 2;
+// the free space map keeps free bytes in units of 1/256 of a page, one byte per data page
+const int FSM_MAX = 255;
+
+const uint32_t OVERFLOW_MAGIC = 0x4c46564f;  // "OVFL"
+const uint32_t OVERFLOW_VERSION = 1;
+// v3 records keep varchars longer than this fraction of a page in overflow pages
+const int OVERFLOW_DIV = 8;
+
+struct RecordHandler::HeapHeader {
+    uint32_t magic, version;
+    // the page ending with FILE_END
+    int lastPage;
+    // map page m (1-based) holds the entries of data pages (m-1)*page size ...
+    int mapPages;
+    long long rows;
+    // rows deleted since the last vacuum
+    long long dead;
+    // per map page, no less than its largest entry; lowered when a search finds it too high
+    uint8_t mapMax[PAGE_SIZE - 32];
+    // larger pages leave the rest of page 0 unused
+};
+
+struct RecordHandler::OverflowHeader {
+    uint32_t magic, version;
+    // pages of the file, and the first of the freed pages, which are chained like a value
+    int pages, free;
+};
 
 RecordHandler::RecordHandler() {
     FileSystem::init();
     _fm = FileSystem::fm;
     _bpm = FileSystem::bpm;
-    _fileID = -1;
+    _fileID = _fsmID = _overflowID = -1;
+    _ring = _bpm->newRing();
 }
 
 RecordHandler::~RecordHandler() {
+    _guard.release();
+    _head.release();
+    delete _ring;
     FileSystem::release();
 }
 
@@ -25,10 +63,17 @@ int RecordHandler::createFile(const char* fileName, const RecordType& type) {
     flag |= !_fm->createFile(fileName);
     flag |= !_fm->openFile(fileName, _fileID);
     _type = type;
-    _data = (uint8_t*)_bpm->allocPage(_fileID, 0, _pageIndex, false);
-    _bpm->markDirty(_pageIndex);
+    _fileName = fileName;
+    _overflowID = -1;
+    _overflowValues.assign(_type.num_varchar, "");
+    _overflowPages.assign(_type.num_varchar, -1);
+    _initPage();
+    _guard = _bpm->allocPageGuard(_fileID, 0);
+    _data = (uint8_t*)_guard.get();
+    _guard.markDirty();
     _setOffset(0, FILE_END);
-    _end = Iterator(this, 0, 0);
+    _target = -1;
+    flag |= _openHeap(fileName, true);
     return flag;
 }
 
@@ -38,178 +83,639 @@ int RecordHandler::openFile(const char* fileName, const RecordType& type) {
     flag |= !_fm->openFile(fileName, fileID);
     _type = type;
     if (fileID != _fileID) {
+        _guard.release();
+        _head.release();
         _fileID = fileID;
-        _end = Iterator(this, -1, 0);
+        _target = -1;
+        _fileName = fileName;
+        _overflowID = -1;
+        _overflowValues.assign(_type.num_varchar, "");
+        _overflowPages.assign(_type.num_varchar, -1);
+        if (!flag) {
+            _initPage();
+            flag |= _openHeap(fileName, false);
+        }
     }
     return flag;
 }
 
-RecordHandler::Iterator RecordHandler::begin() {
-    int page = 0, slot = 0;
-    _nextSlot(page, slot);
-    return RecordHandler::Iterator(this, page, slot);
+void RecordHandler::releasePage() {
+    _guard.release();
+    _head.release();
+}
+
+void RecordHandler::closeFile() {
+    releasePage();
+    _fileID = _fsmID = _overflowID = -1;
+}
+
+void RecordHandler::setPool(BufPageManager* bpm) {
+    if (bpm == _bpm) return;
+    closeFile();
+    // the ring holds frames of the old pool
+    delete _ring;
+    _bpm = bpm;
+    _ring = _bpm->newRing();
+}
+
+long long RecordHandler::rows() {
+    return _header()->rows;
+}
+
+long long RecordHandler::deadRows() {
+    return _header()->dead;
+}
+
+bool RecordHandler::fits(const Record& record) {
+    // the record's slot and the slot ending the page
+    std::vector<bool> overflow;
+    return _getLen(record, overflow) <= _pageSize - 2 * _slotBytes;
+}
+
+void RecordHandler::_initPage() {
+    int idx = _fm->getPageSizeIdx(_fileID);
+    _pageSize = 1 << idx;
+    _slotBytes = _pageSize <= SHORT_SLOT_MAX_PAGE ? 2 : 4;
+    _fsmShift = idx - 8;
+}
+
+RecordHandler::HeapHeader* RecordHandler::_header() {
+    static_assert(sizeof(HeapHeader) == PAGE_SIZE);
+    if (!_head.holds(_fsmID, 0)) _head = _bpm->getPageGuard(_fsmID, 0);
+    return (HeapHeader*)_head.get();
+}
+
+int RecordHandler::_openHeap(const char* fileName, bool rebuild) {
+    std::string name = std::string(fileName) + ".fsm";
+    if (!_fm->openFile(name.c_str(), _fsmID)) {
+        // tables created before the map existed get one on first use
+        rebuild = true;
+        if (!_fm->createFile(name.c_str()) || !_fm->openFile(name.c_str(), _fsmID)) return 1;
+    }
+    if (!rebuild) {
+        HeapHeader* head = _header();
+        rebuild = head->magic != HEAP_MAGIC || head->version != HEAP_VERSION || head->lastPage < 0;
+        if (!rebuild) {
+            // a header older than the data, e.g. after a crash, no longer names the last page
+            int fit, term;
+            _openPage(head->lastPage);
+            _pageSpace(0, fit, term);
+            rebuild = term < 0 || (_getOffset(term) & FLAG_BITS) != FILE_END;
+        }
+    }
+    if (rebuild) _rebuildHeap();
+    return 0;
 }
 
-void RecordHandler::_openPage(int page) {
-    _data = (uint8_t*)_bpm->getPage(_fileID, page, _pageIndex);
+void RecordHandler::_rebuildHeap() {
+    _head = _bpm->allocPageGuard(_fsmID, 0);
+    HeapHeader* head = (HeapHeader*)_head.get();
+    memset(head, 0, _pageSize);
+    head->magic = HEAP_MAGIC;
+    head->version = HEAP_VERSION;
+    _head.markDirty();
+    int pages = _fm->getPageNum(_fileID);
+    bool seq = pages > _bpm->capacity / BUF_RING_SCAN_DIV;
+    for (int page = 0; ; ++page) {
+        _openPage(page, seq);
+        int fit, term;
+        int free = _pageSpace(0, fit, term);
+        if (term < 0) {
+            // not a data page, what was lost in a crash is not recovered
+            _guard.markDirty();
+            _setOffset(term = 0, FILE_END);
+            free = _pageSpace(0, fit, term);
+        }
+        _setFree(page, free);
+        for (int slot = 0; slot < term; ++slot)
+            ++((_getOffset(slot) & FLAG_BITS) == EMPTY_SLOT ? head->dead : head->rows);
+        if ((_getOffset(term) & FLAG_BITS) == FILE_END || page + 1 >= pages) {
+            _guard.markDirty();
+            _setOffset(term, FILE_END | (_getOffset(term) & ~FLAG_BITS));
+            head->lastPage = page;
+            break;
+        }
+    }
+    // the last page was read through the ring, appends should keep it in the pool
+    if (seq) _bpm->access(_guard.getIndex());
 }
 
-uint16_t RecordHandler::_getOffset(int slot) {
-    return *(uint16_t*)(&_data[PAGE_SIZE-(slot+1<<1)]);
+int RecordHandler::_pageSpace(int len, int& fit, int& term) {
+    // walk the slots of the open page: fit is the first deleted slot with room for len bytes, -1 if none,
+    // term the slot ending the page; returns the free bytes of the page, all usable after _compactPage
+    int free = 0;
+    fit = term = -1;
+    for (int slot = 0; slot < _pageSize / _slotBytes; ++slot) {
+        uint32_t offset = _getOffset(slot);
+        if (offset & PAGE_END) {
+            term = slot;
+            // appending also takes a new slot to end the page
+            return free + std::max(_pageSize - (slot + 2) * _slotBytes - (int)(offset & ~FLAG_BITS), 0);
+        }
+        if ((offset & FLAG_BITS) == EMPTY_SLOT) {
+            int room = (_getOffset(slot + 1) & ~FLAG_BITS) - (offset & ~FLAG_BITS);
+            if (fit < 0 && room >= len) fit = slot;
+            free += room;
+        }
+    }
+    return 0;
 }
 
-void RecordHandler::_setOffset(int slot, uint16_t offset) {
-    *(uint16_t*)(&_data[PAGE_SIZE-(slot+1<<1)]) = offset;
+void RecordHandler::_compactPage(int term) {
+    // move the records of the open page together at its start, each keeping its slot
+    int to = 0;
+    for (int slot = 0; slot < term; ++slot) {
+        uint32_t offset = _getOffset(slot);
+        int from = offset & ~FLAG_BITS, len = (_getOffset(slot + 1) & ~FLAG_BITS) - from;
+        if ((offset & FLAG_BITS) == EMPTY_SLOT) {
+            _setOffset(slot, EMPTY_SLOT | to);
+            continue;
+        }
+        memmove(_data + to, _data + from, len);
+        _setOffset(slot, to);
+        to += len;
+    }
+    _setOffset(term, (_getOffset(term) & FLAG_BITS) | to);
 }
 
-Record RecordHandler::_getRecord(int page, int slot) {
+int RecordHandler::_insertInto(int page, const uint8_t* row, int len, int& free) {
     _openPage(page);
-    int offset = _getOffset(slot);
-    if (offset >= PAGE_SIZE) {
-        std::cerr << "bad slot";
-        exit(-1);
+    int fit, term;
+    free = _pageSpace(len, fit, term);
+    if (fit >= 0) {
+        int offset = _getOffset(fit) & ~FLAG_BITS;
+        _guard.markDirty();
+        _setOffset(fit, offset);
+        memcpy(_data + offset, row, len);
+        // what the record leaves over goes to the next slot if it is deleted too
+        if ((_getOffset(fit + 1) & FLAG_BITS) == EMPTY_SLOT) _setOffset(fit + 1, EMPTY_SLOT | (offset + len));
+        HeapHeader* head = _header();
+        if (head->dead > 0) {
+            _head.markDirty();
+            --head->dead;
+        }
+        return fit;
     }
+    if (free < len) return -1;
+    _guard.markDirty();
+    if ((int)(_getOffset(term) & ~FLAG_BITS) + len > _pageSize - (term + 2) * _slotBytes) _compactPage(term);
+    uint32_t end = _getOffset(term);
+    int offset = end & ~FLAG_BITS;
+    _setOffset(term, offset);
+    memcpy(_data + offset, row, len);
+    _setOffset(term + 1, (end & FLAG_BITS) | (offset + len));
+    return term;
+}
 
-    Record record(_type);
-    
-    int bitOffset = 0;
-    for (int i = 0; i < _type.num_int; ++i) {
-        record.int_null[i] = _data[offset] & (1<<bitOffset);
-        if (bitOffset < 7) ++bitOffset;
-        else ++offset, bitOffset = 0;
+int RecordHandler::_appendPage() {
+    HeapHeader* head = _header();
+    int page = head->lastPage;
+    _openPage(page);
+    int fit, term;
+    _pageSpace(0, fit, term);
+    _guard.markDirty();
+    _setOffset(term, PAGE_END | (_getOffset(term) & ~FLAG_BITS));
+    _guard = _bpm->allocPageGuard(_fileID, ++page);
+    _data = (uint8_t*)_guard.get();
+    _guard.markDirty();
+    _setOffset(0, FILE_END);
+    _head.markDirty();
+    head->lastPage = page;
+    _setFree(page, _pageSize - 2 * _slotBytes);
+    return page;
+}
+
+void RecordHandler::_setFree(int page, int free) {
+    uint8_t entry = std::min(free >> _fsmShift, FSM_MAX);
+    HeapHeader* head = _header();
+    int m = page / _pageSize;
+    PageGuard map;
+    if (m >= head->mapPages) {
+        // pages are added one at a time, so is the map
+        map = _bpm->allocPageGuard(_fsmID, m + 1);
+        memset(map.get(), 0, _pageSize);
+        map.markDirty();
+        _head.markDirty();
+        head->mapPages = m + 1;
+        head->mapMax[m] = 0;
+    } else {
+        map = _bpm->getPageGuard(_fsmID, m + 1);
     }
-    for (int i = 0; i < _type.num_varchar; ++i) {
-        record.varchar_null[i] = _data[offset] & (1<<bitOffset);
-        if (bitOffset < 7) ++bitOffset;
-        else ++offset, bitOffset = 0;
+    uint8_t* entries = (uint8_t*)map.get();
+    if (entries[page % _pageSize] != entry) {
+        entries[page % _pageSize] = entry;
+        map.markDirty();
     }
-    if (bitOffset) ++offset;
+    if (entry > head->mapMax[m]) {
+        head->mapMax[m] = entry;
+        _head.markDirty();
+    }
+}
 
-    for (int i = 0; i < _type.num_int; ++i) {
-        record.int_data[i] = *(int*)(&_data[offset]);
-        offset += sizeof(int);
+int RecordHandler::_findPage(int len, int limit) {
+    int need = len + (1 << _fsmShift) - 1 >> _fsmShift;
+    HeapHeader* head = _header();
+    int end = std::min(head->lastPage + 1, limit);
+    for (int m = 0; m < head->mapPages && (long long)m * _pageSize < end; ++m) {
+        if (head->mapMax[m] < need) continue;
+        PageGuard map = _bpm->getPageGuard(_fsmID, m + 1);
+        uint8_t* entries = (uint8_t*)map.get();
+        int n = std::min(_pageSize, end - m * _pageSize), most = 0;
+        for (int i = 0; i < n; ++i) {
+            if (entries[i] >= need) return m * _pageSize + i;
+            most = std::max(most, (int)entries[i]);
+        }
+        if (n == std::min(_pageSize, head->lastPage + 1 - m * _pageSize)) {
+            head->mapMax[m] = most;
+            _head.markDirty();
+        }
     }
-    for (int i = 0; i < _type.num_varchar; ++i) if (!record.varchar_null[i]) {
-        uint16_t len = *(uint16_t*)(&_data[offset]);
-        offset += sizeof(uint16_t);
-        record.varchar_data[i] = string(_data+offset, _data+offset+len);
-        offset += len;
+    return -1;
+}
+
+int RecordHandler::vacuum(std::vector<std::pair<long long, long long>>& moves) {
+    HeapHeader* head = _header();
+    _head.markDirty();
+    head->rows = head->dead = 0;
+    // each page on its own: its records move together to the start, deleted slots after the last record go
+    std::vector<int> used(head->lastPage + 1);
+    long long room = 0;
+    bool seq = head->lastPage + 1 > _bpm->capacity / BUF_RING_SCAN_DIV;
+    for (int page = 0; page <= head->lastPage; ++page) {
+        _openPage(page, seq);
+        int fit, term;
+        _pageSpace(0, fit, term);
+        int end = term, dead = 0;
+        while (end > 0 && (_getOffset(end - 1) & FLAG_BITS) == EMPTY_SLOT) --end;
+        for (int slot = 0; slot < end; ++slot)
+            if ((_getOffset(slot) & FLAG_BITS) == EMPTY_SLOT) ++dead;
+        if (end < term || dead > 0) {
+            _guard.markDirty();
+            _setOffset(end, (_getOffset(term) & FLAG_BITS) | (_getOffset(end) & ~FLAG_BITS));
+            _compactPage(end);
+        }
+        head->rows += end - dead;
+        used[page] = (end - dead) * _slotBytes + (_getOffset(end) & ~FLAG_BITS);
+        int free = _pageSpace(0, fit, term);
+        _setFree(page, free);
+        room += free;
     }
+    // then the rows of the last page move to earlier pages while they have room, and the emptied page is cut off
+    int freed = 0;
+    for (int page = head->lastPage; page > 0; --page) {
+        _openPage(page);
+        int fit, term;
+        room -= _pageSpace(0, fit, term);
+        if (used[page] > room) break;
+        room -= used[page];
+        int marked = 0;
+        for (int slot = 0; slot < term; ++slot) {
+            _openPage(page);
+            uint32_t offset = _getOffset(slot);
+            if ((offset & FLAG_BITS) == EMPTY_SLOT) continue;
+            // the bytes move as they are, overflowed varchars keep their pages
+            RecordView view = _getView(page, slot);
+            int len = view.size(), to, moved = -1, free;
+            _row.assign(view.data, view.data + len);
+            while ((to = _findPage(len, page)) >= 0 && (moved = _insertInto(to, _row.data(), len, free)) < 0)
+                _setFree(to, free);
+            if (to < 0) break;
+            _openPage(page);
+            _guard.markDirty();
+            _setOffset(slot, EMPTY_SLOT | offset);
+            ++marked;
+            moves.push_back(std::make_pair((long long)page * _pageSize + slot, (long long)to * _pageSize + moved));
+        }
+        _openPage(page);
+        _pageSpace(0, fit, term);
+        for (fit = 0; fit < term && (_getOffset(fit) & FLAG_BITS) == EMPTY_SLOT; ++fit);
+        if (fit < term) {
+            // the space of the rows that did move is left for inserts
+            head->dead += marked;
+            break;
+        }
+        _setFree(page, 0);
+        _openPage(page - 1);
+        _pageSpace(0, fit, term);
+        _guard.markDirty();
+        _setOffset(term, FILE_END | (_getOffset(term) & ~FLAG_BITS));
+        head->lastPage = page - 1;
+        ++freed;
+    }
+    _target = -1;
+    if (freed > 0) {
+        _guard.release();
+        _bpm->invalidateFile(_fileID, false, head->lastPage + 1);
+        _fm->truncateFile(_fileID, head->lastPage + 1);
+    }
+    return freed;
+}
 
-    return record;
+RecordHandler::Iterator RecordHandler::begin() {
+    // scanning a table larger than a fraction of the pool would evict everything else
+    bool seq = _fm->getPageNum(_fileID) > _bpm->capacity / BUF_RING_SCAN_DIV;
+    int page = 0, slot = 0;
+    _nextSlot(page, slot, seq);
+    return RecordHandler::Iterator(this, page, slot, seq);
 }
 
-void RecordHandler::_nextSlot(int& page, int& slot) {
-    _openPage(page);
+void RecordHandler::_openPage(int page, bool seq) {
+    if (_guard.holds(_fileID, page)) return;
+    if (seq) _guard = _bpm->getPageGuard(_fileID, page, _ring);
+    else _guard = _bpm->getPageGuard(_fileID, page);
+    _data = (uint8_t*)_guard.get();
+}
+
+uint32_t RecordHandler::_getOffset(int slot) {
+    if (_slotBytes == 4) return *(uint32_t*)(&_data[_pageSize-(slot+1<<2)]);
+    uint16_t offset = *(uint16_t*)(&_data[_pageSize-(slot+1<<1)]);
+    return (uint32_t)(offset & 0xc000) << 16 | (offset & 0x3fff);
+}
+
+void RecordHandler::_setOffset(int slot, uint32_t offset) {
+    if (_slotBytes == 4) *(uint32_t*)(&_data[_pageSize-(slot+1<<2)]) = offset;
+    else *(uint16_t*)(&_data[_pageSize-(slot+1<<1)]) = (offset & FLAG_BITS) >> 16 | (offset & 0x3fff);
+}
+
+Record RecordHandler::_getRecord(int page, int slot, bool seq) {
+    return _getView(page, slot, seq).record();
+}
+
+RecordView RecordHandler::_getView(int page, int slot, bool seq) {
+    _openPage(page, seq);
+    uint32_t offset = _getOffset(slot);
+    if (offset >= (uint32_t)_pageSize) {
+        std::cerr << "bad slot";
+        exit(-1);
+    }
+    return RecordView(_data + offset, _type, this);
+}
+
+void RecordHandler::_nextSlot(int& page, int& slot, bool seq) {
+    _openPage(page, seq);
     while (true) {
-        uint16_t offset = _getOffset(slot);
-        if ((offset & FLAG_BITS) == PAGE_END) {_openPage(++page); slot = 0;}
+        uint32_t offset = _getOffset(slot);
+        if ((offset & FLAG_BITS) == PAGE_END) {_openPage(++page, seq); slot = 0;}
         else if ((offset & FLAG_BITS) == EMPTY_SLOT) ++slot;
         else return;
     }
 }
 
-int RecordHandler::_getLen(const Record& record) {
-    int len = (_type.num_int + _type.num_varchar + 7 >> 3) + sizeof(int) * _type.num_int;
-    for (int i = 0; i < _type.num_varchar; ++i) if(!record.varchar_null[i])
-        len += sizeof(uint16_t) + record.varchar_data[i].size();
+int RecordHandler::_getLen(const Record& record, std::vector<bool>& overflow) {
+    // v3 moves varchars longer than a fraction of a page to overflow pages, then the longest of the
+    // others while the record does not fit in a page
+    overflow.assign(_type.num_varchar, false);
+    int len = _type.bitmap_bytes() + sizeof(int) * _type.num_int;
+    bool v2 = _type.format >= RECORD_FORMAT_V2, v3 = _type.format >= RECORD_FORMAT_V3;
+    if (v2) len += sizeof(uint16_t) * _type.num_varchar;
+    for (int i = 0; i < _type.num_varchar; ++i) if(!record.varchar_null[i]) {
+        int size = record.varchar_data[i].size();
+        if (v3 && size > _pageSize / OVERFLOW_DIV) {
+            overflow[i] = true;
+            size = sizeof(OverflowPointer);
+        }
+        len += (v2 ? 0 : sizeof(uint16_t)) + size;
+    }
+    while (v3 && len > _pageSize - 2 * _slotBytes) {
+        int longest = -1, size = sizeof(OverflowPointer);
+        for (int i = 0; i < _type.num_varchar; ++i)
+            if (!record.varchar_null[i] && !overflow[i] && (int)record.varchar_data[i].size() > size)
+                longest = i, size = record.varchar_data[i].size();
+        if (longest < 0) break;
+        overflow[longest] = true;
+        len -= size - sizeof(OverflowPointer);
+    }
     return len;
 }
 
-void RecordHandler::_setRecord(int offset, const Record& record) {
-    int bitOffset = 0;
-    for (int i = 0; i < _type.num_int; ++i) {
-        if (bitOffset == 0) _data[offset] = 0;
-        _data[offset] |= record.int_null[i] << bitOffset;
-        if (bitOffset < 7) ++bitOffset;
-        else ++offset, bitOffset = 0;
-    }
-    for (int i = 0; i < _type.num_varchar; ++i) {
-        if (bitOffset == 0) _data[offset] = 0;
-        _data[offset] |= record.varchar_null[i] << bitOffset;
-        if (bitOffset < 7) ++bitOffset;
-        else ++offset, bitOffset = 0;
-    }
-    if (bitOffset) ++offset;
+void RecordHandler::_setRecord(uint8_t* data, const Record& record, const std::vector<bool>& overflow) {
+    int offset = _type.bitmap_bytes();
+    memset(data, 0, offset);
+    for (int i = 0; i < _type.num_int; ++i)
+        data[i >> 3] |= record.int_null[i] << (i & 7);
+    for (int i = 0, bit = _type.num_int; i < _type.num_varchar; ++i, ++bit)
+        data[bit >> 3] |= record.varchar_null[i] << (bit & 7);
+    if (_type.format >= RECORD_FORMAT_V3)
+        for (int i = 0, bit = _type.num_int + _type.num_varchar; i < _type.num_varchar; ++i, ++bit)
+            data[bit >> 3] |= overflow[i] << (bit & 7);
 
     for (int i = 0; i < _type.num_int; ++i) {
-        *(int*)(&_data[offset]) = record.int_data[i];
+        *(int*)(&data[offset]) = record.int_data[i];
         offset += sizeof(int);
     }
+    if (_type.format >= RECORD_FORMAT_V2) {
+        int ends = offset, end = 0;
+        offset += sizeof(uint16_t) * _type.num_varchar;
+        for (int i = 0; i < _type.num_varchar; ++i) {
+            auto& value = record.varchar_data[i];
+            if (overflow[i]) {
+                OverflowPointer pointer = {_writeOverflow(value), (int)value.size()};
+                memcpy(data + offset + end, &pointer, sizeof(pointer));
+                end += sizeof(pointer);
+            } else if (!record.varchar_null[i]) {
+                memcpy(data + offset + end, value.data(), value.size());
+                end += value.size();
+            }
+            *(uint16_t*)(&data[ends + sizeof(uint16_t) * i]) = end;
+        }
+        return;
+    }
     for (int i = 0; i < _type.num_varchar; ++i) if (!record.varchar_null[i]) {
         uint16_t len = record.varchar_data[i].size();
-        *(uint16_t*)(&_data[offset]) = len;
+        *(uint16_t*)(&data[offset]) = len;
         offset += sizeof(uint16_t);
-        memcpy(_data+offset, record.varchar_data[i].data(), len);
+        memcpy(data+offset, record.varchar_data[i].data(), len);
         offset += len;
     }
 }
 
-RecordHandler::Iterator RecordHandler::ins(const Record& record) {
-    if (_end._page < 0) for (_end = begin(); !_end.isEnd(); ++_end);
-    _openPage(_end._page);
-    int offset = _getOffset(_end._slot) & ~FLAG_BITS;
-    int len = _getLen(record);
-    if (offset + len > PAGE_SIZE - (_end._slot + 1 << 1)) {
-        _bpm->markDirty(_pageIndex);
-        _setOffset(_end._slot, PAGE_END | offset);
-        _data = (uint8_t*)_bpm->allocPage(_fileID, ++_end._page, _pageIndex, false);
-        _end._slot = 0;
-        offset = 0;
+int RecordHandler::_encode(const Record& record) {
+    // the record as stored into _row, writing the overflow pages of its long varchars
+    std::vector<bool> overflow;
+    int len = _getLen(record, overflow);
+    _row.resize(len);
+    _setRecord(_row.data(), record, overflow);
+    return len;
+}
+
+int RecordHandler::_openOverflow() {
+    if (_overflowID >= 0) return _overflowID;
+    std::string name = _fileName + ".overflow";
+    if (!_fm->openFile(name.c_str(), _overflowID)
+            && (!_fm->createFile(name.c_str()) || !_fm->openFile(name.c_str(), _overflowID))) {
+        std::cerr << "cannot create " << name;
+        exit(-1);
+    }
+    PageGuard guard = _bpm->getPageGuard(_overflowID, 0);
+    OverflowHeader* head = (OverflowHeader*)guard.get();
+    if (head->magic != OVERFLOW_MAGIC || head->version != OVERFLOW_VERSION) {
+        // a new file, or one whose header was lost in a crash: pages already in the file are not reused
+        memset(head, 0, _pageSize);
+        head->magic = OVERFLOW_MAGIC;
+        head->version = OVERFLOW_VERSION;
+        head->pages = std::max(_fm->getPageNum(_overflowID), 1);
+        head->free = -1;
+        guard.markDirty();
+    }
+    return _overflowID;
+}
+
+int RecordHandler::_writeOverflow(const std::string& value) {
+    // a chain of freed or appended pages, returns its first page
+    int fileID = _openOverflow();
+    PageGuard headGuard = _bpm->getPageGuard(fileID, 0);
+    OverflowHeader* head = (OverflowHeader*)headGuard.get();
+    headGuard.markDirty();
+    int chunk = _pageSize - sizeof(int), first = -1;
+    PageGuard last;
+    for (int done = 0; done < (int)value.size(); done += chunk) {
+        PageGuard guard;
+        int page;
+        if (head->free >= 0) {
+            page = head->free;
+            guard = _bpm->getPageGuard(fileID, page);
+            memcpy(&head->free, guard.get(), sizeof(int));
+        } else {
+            page = head->pages++;
+            guard = _bpm->allocPageGuard(fileID, page);
+        }
+        uint8_t* data = (uint8_t*)guard.get();
+        int end = -1;
+        memcpy(data, &end, sizeof(int));
+        memcpy(data + sizeof(int), value.data() + done, std::min(chunk, (int)value.size() - done));
+        guard.markDirty();
+        if (first < 0) first = page;
+        else memcpy(last.get(), &page, sizeof(int));
+        last = std::move(guard);
     }
+    return first;
+}
 
-    _bpm->markDirty(_pageIndex);
-    _setOffset(_end._slot, offset);
-    _setRecord(offset, record);
-    _setOffset(++_end._slot, FILE_END | (offset + len));
-    return Iterator(this, _end._page, _end._slot-1);
+std::string_view RecordHandler::_readOverflow(int field, const OverflowPointer& pointer) {
+    std::string& value = _overflowValues[field];
+    if (_overflowPages[field] == pointer.page) return value;
+    int fileID = _openOverflow(), chunk = _pageSize - sizeof(int);
+    value.resize(pointer.len);
+    for (int page = pointer.page, done = 0; done < pointer.len; done += chunk) {
+        PageGuard guard = _bpm->getPageGuard(fileID, page);
+        memcpy(value.data() + done, (uint8_t*)guard.get() + sizeof(int), std::min(chunk, pointer.len - done));
+        memcpy(&page, guard.get(), sizeof(int));
+    }
+    _overflowPages[field] = pointer.page;
+    return value;
+}
+
+void RecordHandler::_freeOverflow(const RecordView& view) {
+    // the chains of the record's overflowed varchars go to the front of the free pages
+    for (int i = 0; i < _type.num_varchar; ++i) {
+        if (!view.varchar_overflow(i)) continue;
+        OverflowPointer pointer;
+        memcpy(&pointer, view.varchar_stored(i).data(), sizeof(pointer));
+        int fileID = _openOverflow(), chunk = _pageSize - sizeof(int);
+        PageGuard headGuard = _bpm->getPageGuard(fileID, 0);
+        OverflowHeader* head = (OverflowHeader*)headGuard.get();
+        headGuard.markDirty();
+        for (int page = pointer.page, done = 0; done < pointer.len; done += chunk) {
+            PageGuard guard = _bpm->getPageGuard(fileID, page);
+            int next;
+            memcpy(&next, guard.get(), sizeof(int));
+            memcpy(guard.get(), &head->free, sizeof(int));
+            guard.markDirty();
+            head->free = page;
+            page = next;
+        }
+        _overflowPages.assign(_type.num_varchar, -1);
+    }
+}
+
+RecordHandler::Iterator RecordHandler::ins(const Record& record) {
+    int len = _encode(record);
+    if (_target < 0) _target = _header()->lastPage;
+    int slot, free;
+    while ((slot = _insertInto(_target, _row.data(), len, free)) < 0) {
+        // the map entry of the page was too high, or the page filled up since
+        _setFree(_target, free);
+        _target = _findPage(len, INT_MAX);
+        if (_target < 0) _target = _appendPage();
+    }
+    HeapHeader* head = _header();
+    _head.markDirty();
+    ++head->rows;
+    return Iterator(this, _target, slot);
 }
 
 void RecordHandler::del(const Iterator& it) {
-    _openPage(it._page);
+    _freeOverflow(_getView(it._page, it._slot, it._seq));
     int offset = _getOffset(it._slot);
-    _bpm->markDirty(_pageIndex);
+    _guard.markDirty();
     _setOffset(it._slot, EMPTY_SLOT | offset);
+    int fit, term;
+    _setFree(it._page, _pageSpace(0, fit, term));
+    HeapHeader* head = _header();
+    _head.markDirty();
+    --head->rows;
+    ++head->dead;
 }
 
 RecordHandler::Iterator RecordHandler::upd(const Iterator& it, const Record& record) {
-    _openPage(it._page);
+    _openPage(it._page, it._seq);
     int offset = _getOffset(it._slot);
     int nextOffset = _getOffset(it._slot + 1) & ~FLAG_BITS;
-    _bpm->markDirty(_pageIndex);
-    if (offset + _getLen(record) > nextOffset) {
-        _setOffset(it._slot, EMPTY_SLOT | offset);
+    std::vector<bool> overflow;
+    if (offset + _getLen(record, overflow) > nextOffset) {
+        del(it);
         return ins(record);
     }
-    _setRecord(offset, record);
+    // the old values' overflow pages are freed first, so that the new ones can take them
+    _freeOverflow(_getView(it._page, it._slot, it._seq));
+    int len = _encode(record);
+    _guard.markDirty();
+    memcpy(_data + offset, _row.data(), len);
+    // what a shorter record leaves over goes to the next slot if it is deleted, or to the end of the page
+    uint32_t next = _getOffset(it._slot + 1);
+    if ((next & FLAG_BITS) && offset + len < nextOffset) {
+        _setOffset(it._slot + 1, (next & FLAG_BITS) | (offset + len));
+        int fit, term;
+        _setFree(it._page, _pageSpace(0, fit, term));
+    }
     return it;
 }
 
+std::string_view RecordView::overflow_data(int i) const {
+    OverflowPointer pointer;
+    memcpy(&pointer, varchar_stored(i).data(), sizeof(pointer));
+    return handler->_readOverflow(i, pointer);
+}
+
 Record RecordHandler::Iterator::operator*() {
-    return _handler->_getRecord(_page, _slot);
+    return _handler->_getRecord(_page, _slot, _seq);
+}
+
+RecordView RecordHandler::Iterator::view() {
+    return _handler->_getView(_page, _slot, _seq);
 }
 
 RecordHandler::Iterator& RecordHandler::Iterator::operator++() {
     ++_slot;
-    _handler->_nextSlot(_page, _slot);
+    _handler->_nextSlot(_page, _slot, _seq);
     return *this;
 }
 
 RecordHandler::Iterator RecordHandler::Iterator::operator++(int) {
     RecordHandler::Iterator it = *this;
     ++_slot;
-    _handler->_nextSlot(_page, _slot);
+    _handler->_nextSlot(_page, _slot, _seq);
     return it;
 }
 
 bool RecordHandler::Iterator::isEnd() {
-    _handler->_openPage(_page);
+    _handler->_openPage(_page, _seq);
     return (_handler->_getOffset(_slot) & FLAG_BITS) == FILE_END;
 }
 
-int RecordHandler::Iterator::toInt() {
-    return _page * PAGE_SIZE + _slot;
+long long RecordHandler::Iterator::toInt() {
+    return (long long)_page * _handler->_pageSize + _slot;
 }
 
-RecordHandler::Iterator::Iterator(RecordHandler* handler, int x):
-    RecordHandler::Iterator(handler, x / PAGE_SIZE, x % PAGE_SIZE) {}
\ No newline at end of file
+RecordHandler::Iterator::Iterator(RecordHandler* handler, long long x):
+    RecordHandler::Iterator(handler, x / handler->_pageSize, x % handler->_pageSize) {}
\ No newline at end of file
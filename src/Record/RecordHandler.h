@@ -1,5 +1,10 @@
 #pragma once
 
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
 #include "FileSystem.h"
 #include "Record.h"
 
@@ -9,21 +14,37 @@ public:
     ~RecordHandler();
     int createFile(const char* fileName, const RecordType& type);
     int openFile(const char* fileName, const RecordType& type);
+    // unpin the page kept between calls, e.g. before the buffer pool is resized
+    void releasePage();
+    // forget the open file before it is closed, so that a reused file id starts afresh
+    void closeFile();
+    // cache pages in bpm from now on, e.g. the pool of the database being used
+    void setPool(BufPageManager* bpm);
+    // live records in the open file, and records deleted since it was last vacuumed
+    long long rows();
+    long long deadRows();
+    // whether the record fits in a page, ins() requires it; in v3 long varchars go to overflow pages
+    bool fits(const Record& record);
 
     class Iterator {
     public:
         Record operator*();
+        // the record in place, valid until the handler reads another page
+        RecordView view();
         Iterator& operator++();
         Iterator operator++(int);
         bool isEnd();
-        int toInt();
-        Iterator(RecordHandler* handler, int);
+        // the record id, page * page size + slot
+        long long toInt();
+        Iterator(RecordHandler* handler, long long);
     private:
         friend class RecordHandler;
         RecordHandler* _handler;
         int _page, _slot;
-        Iterator(RecordHandler* handler, int page, int slot)
-            :_handler(handler), _page(page), _slot(slot){}
+        // sequential scan over a large table, pages go through the handler's ring
+        bool _seq;
+        Iterator(RecordHandler* handler, int page, int slot, bool seq = false)
+            :_handler(handler), _page(page), _slot(slot), _seq(seq){}
         Iterator():Iterator(NULL, 0, 0){}
     };
 
@@ -31,19 +52,62 @@ public:
     Iterator ins(const Record& record);
     void del(const Iterator& it);
     Iterator upd(const Iterator& it, const Record& record);
+    // compact the open file: records move together within their pages, then rows of the last pages move
+    // to earlier pages until they are empty and cut off. Moved rows are appended to moves as
+    // (old, new) Iterator::toInt() values; returns the number of pages cut off
+    int vacuum(std::vector<std::pair<long long, long long>>& moves);
 
 private:
+    friend struct RecordView;
+    // page 0 of the file's free space map, <file>.fsm
+    struct HeapHeader;
+    // page 0 of the file's overflow pages, <file>.overflow
+    struct OverflowHeader;
 	FileManager* _fm;
 	BufPageManager* _bpm;
-    int _fileID, _pageIndex;
-    Iterator _end;
+    int _fileID;
+    // the free space map file: the heap header, then one byte per data page
+    int _fsmID;
+    // the overflow file, opened when first needed: the overflow header, then chains of pages each
+    // starting with the next page of its chain, -1 at the end
+    int _overflowID;
+    std::string _fileName;
+    // page tried first by the next insert, -1 for the last page
+    int _target;
     RecordType _type;
+    // bytes of a page of the open file, of a slot entry, and the free space map's unit as a shift
+    int _pageSize, _slotBytes, _fsmShift;
+    PageGuard _guard;
+    // pins the heap header while the file is in use
+    PageGuard _head;
+    BufRing* _ring;
     uint8_t* _data;
-    void _openPage(int page);
-    uint16_t _getOffset(int slot);
-    void _setOffset(int slot, uint16_t offset);
-    Record _getRecord(int page, int slot);
-    void _nextSlot(int& page, int& slot);
-    int _getLen(const Record& record);
-    void _setRecord(int offset, const Record& record);
+    // the record being inserted, as stored
+    std::vector<uint8_t> _row;
+    // per varchar field, the overflowed value read last and its first page, -1 if none
+    std::vector<std::string> _overflowValues;
+    std::vector<int> _overflowPages;
+    void _initPage();
+    void _openPage(int page, bool seq = false);
+    uint32_t _getOffset(int slot);
+    void _setOffset(int slot, uint32_t offset);
+    Record _getRecord(int page, int slot, bool seq = false);
+    RecordView _getView(int page, int slot, bool seq = false);
+    void _nextSlot(int& page, int& slot, bool seq = false);
+    int _getLen(const Record& record, std::vector<bool>& overflow);
+    void _setRecord(uint8_t* data, const Record& record, const std::vector<bool>& overflow);
+    int _encode(const Record& record);
+    int _openOverflow();
+    int _writeOverflow(const std::string& value);
+    std::string_view _readOverflow(int field, const OverflowPointer& pointer);
+    void _freeOverflow(const RecordView& view);
+    HeapHeader* _header();
+    int _openHeap(const char* fileName, bool rebuild);
+    void _rebuildHeap();
+    int _pageSpace(int len, int& fit, int& term);
+    void _compactPage(int term);
+    int _insertInto(int page, const uint8_t* row, int len, int& free);
+    int _appendPage();
+    void _setFree(int page, int free);
+    int _findPage(int len, int limit);
 };
\ No newline at end of file
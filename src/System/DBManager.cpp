@@ -11,6 +11,18 @@ namespace fs = std::filesystem;
 fs::path DBManager::db_dir(DB_DIR);
 
 DBManager::DBManager() {
+    // the hot page list is kept next to the databases, read back by the buffer pool at startup
+    if (FileSystem::config.dumpFile.empty())
+        FileSystem::config.dumpFile = (db_dir / "buffer_pool.dump").string();
+    // files of databases with larger pages are opened with their page size, also by the buffer pool warm-up
+    if (fs::exists(db_dir)) {
+        for (auto e : fs::directory_iterator{db_dir}) {
+            ifstream in(e.path() / PAGE_SIZE_FILE);
+            int bytes;
+            if (e.is_directory() && in >> bytes)
+                FileSystem::setPageSize(e.path().string() + "/", __builtin_ctz(bytes));
+        }
+    }
     record_handler = new RecordHandler();
     index_handler = new IndexHandler();
 }
@@ -37,12 +49,30 @@ string DBManager::create_db(string &name) {
     return code.message();
 }
 
+string DBManager::create_db(string &name, const string &page_size) {
+    if (name == MANAGER_NAME) throw DBException("Invalid database name");
+    int bytes = 0, idx = PAGE_SIZE_IDX;
+    if (parsePoolSize(page_size, bytes, 0))
+        while (idx < MAX_PAGE_SIZE_IDX && bytes != 1 << idx) ++idx;
+    if (bytes != 1 << idx) throw DBException("Page size must be 8K, 16K, 32K or 64K");
+    if (fs::exists(db_dir / name)) return "Database already exists";
+    string result = create_db(name);
+    if (idx != PAGE_SIZE_IDX) {
+        ofstream(db_dir / name / PAGE_SIZE_FILE) << bytes << endl;
+        FileSystem::setPageSize((db_dir / name).string() + "/", idx);
+    }
+    return result;
+}
+
 string DBManager::drop_db(string &name) {
     check_db_empty();
     if (name == MANAGER_NAME) throw DBException("Invalid database name");
     std::error_code code;
-    FileSystem::save();
+    close_files(db_dir / name, true);
+    // the quota is kept for a database created again under the same name
+    FileSystem::closePool(name);
     auto suc = fs::remove_all(db_dir / name, code);
+    FileSystem::setPageSize((db_dir / name).string() + "/", PAGE_SIZE_IDX);
     if (suc) return "Removed";
     if (code.value() == 0) return "Database does not exist";
     return code.message();
@@ -61,6 +91,7 @@ string DBManager::use_db(string &name) {
     if (name == MANAGER_NAME) {
         this->schemas.clear();
         this->current_dbname = "";
+        bind_pool(current_dbname);
         return string("Back to ") + MANAGER_NAME;
     }
 
@@ -68,17 +99,36 @@ string DBManager::use_db(string &name) {
 
     this->schemas.clear();
     this->current_dbname = name;
+    bind_pool(name);
 
     for (auto e : fs::directory_iterator{db_dir / name}) {
         if (e.is_directory()) {
             string tableName = e.path().filename().string();
-            this->schemas[tableName] = Schema(tableName, current_dbname);
+            Schema &schema = this->schemas[tableName] = Schema(tableName, current_dbname);
+            // files the table creates later, e.g. new indexes, are compressed like the others
+            FileSystem::fm->setCompressed(e.path().string() + "/", schema.compressed);
+            if (schema.index_format < INDEX_FORMAT) {
+                // indexes written by older versions are rewritten once, later opens take them as current
+                for (auto &index : schema.get_indexes())
+                    if (index_handler->openIndex((e.path() / index.first).c_str(), index.second.size(), schema.index_format))
+                        throw DBException("Cannot upgrade index " + index.first);
+                schema.index_format = INDEX_FORMAT;
+                if (!schema.write(current_dbname)) throw DBException("Cannot write to schema file");
+            }
         }
     }
     
     return "Using " + name;
 }
 
+string DBManager::use_db(string &name, bool mapped) {
+    if (name == MANAGER_NAME || !fs::exists(db_dir / name)) return use_db(name);
+    FileSystem::fm->setMapped((db_dir / name).string() + "/", mapped);
+    // files already open, e.g. by the buffer pool warm-up, are reopened with the new setting
+    close_files(db_dir / name, false);
+    return use_db(name) + (mapped ? " with mmap" : "");
+}
+
 string DBManager::show_tables() {
     check_db();
     fort::char_table table;
@@ -93,6 +143,154 @@ string DBManager::show_indexes() {
     return "Not supported yet";
 }
 
+void DBManager::bind_pool(const string& name) {
+    BufPageManager *bpm = FileSystem::pool(name);
+    int idx = page_size_idx(name);
+    if (bpm == FileSystem::bpm && (FileSystem::quotas().count(name) || idx != PAGE_SIZE_IDX)) {
+        // pages the shared pool cached before the database got a pool of its own are written back and dropped
+        close_files(db_dir / name, false);
+        bpm = FileSystem::openPool(name, (db_dir / name / "buffer_pool.dump").string(), idx);
+    }
+    record_handler->setPool(bpm);
+    index_handler->setPool(bpm);
+}
+
+int DBManager::page_size_idx(const string& name) {
+    if (name.empty()) return PAGE_SIZE_IDX;
+    auto it = FileSystem::pageSizes().find((db_dir / name).string() + "/");
+    return it == FileSystem::pageSizes().end() ? PAGE_SIZE_IDX : it->second;
+}
+
+static string hit_ratio(long long hits, long long misses) {
+    char ratio[32];
+    snprintf(ratio, sizeof(ratio), "%.2f%%", hits + misses ? 100.0 * hits / (hits + misses) : 0.0);
+    return ratio;
+}
+
+string DBManager::show_buffer_status() {
+    BufPageManager *bpm = FileSystem::pool(current_dbname);
+    long long hits, misses, evict_writes, flushed_pages, flush_calls, prefetched, prefetch_waits;
+    bpm->getStats(hits, misses);
+    bpm->getWriteStats(evict_writes, flushed_pages, flush_calls);
+    bpm->getPrefetchStats(prefetched, prefetch_waits);
+    long long map_accesses, map_syncs;
+    bpm->getMapStats(map_accesses, map_syncs);
+    long long warm_loaded, warm_total;
+    bpm->getWarmStats(warm_loaded, warm_total);
+    long long tier_hits, tier_misses, tier_pages, tier_bytes;
+    bpm->getTierStats(tier_hits, tier_misses, tier_pages, tier_bytes);
+    fort::char_table table;
+    table << fort::header << "Buffer" << "Value" << fort::endr;
+    table << "Pool" << (bpm == FileSystem::bpm ? string("shared") : current_dbname) << fort::endr;
+    table << "Replace policy" << replacePolicyName(bpm->policy) << fort::endr;
+    table << "Capacity (pages)" << bpm->capacity << fort::endr;
+    table << "Shards" << bpm->shardNum << fort::endr;
+    table << "Page size" << to_string(1 << bpm->pageIdx - 10) + " KB" << fort::endr;
+    table << "Hits" << hits << fort::endr;
+    table << "Misses" << misses << fort::endr;
+    table << "Hit ratio" << hit_ratio(hits, misses) << fort::endr;
+    table << "I/O backend" << ioBackendName(bpm->aio ? bpm->aio->backend() : SYNC_IO) << fort::endr;
+    table << "Background flusher" << (bpm->flusher.joinable() ? "on" : "off") << fort::endr;
+    table << "Dirty evictions" << evict_writes << fort::endr;
+    table << "Flushed pages" << flushed_pages << fort::endr;
+    table << "Flush writes" << flush_calls << fort::endr;
+    table << "Read-ahead" << (bpm->readAhead ? "on" : "off") << fort::endr;
+    table << "Read-ahead pages" << prefetched << fort::endr;
+    table << "Read-ahead waits" << prefetch_waits << fort::endr;
+    table << "Mapped page accesses" << map_accesses << fort::endr;
+    table << "Mapped page syncs" << map_syncs << fort::endr;
+    table << "Frame memory" << arenaKindName(bpm->arena->getKind()) << fort::endr;
+    table << "Direct I/O" << (FileSystem::config.directIO ? "on" : "off") << fort::endr;
+    // page compression of tables created WITH COMPRESSION, counted over all databases
+    const ZipStats &zip = FileSystem::fm->getZipStats();
+    char zip_text[96];
+    snprintf(zip_text, sizeof(zip_text), "%lld pages, ratio %.2f", zip.written.load(),
+        zip.storedBytes ? (double)zip.rawBytes / zip.storedBytes : 0.0);
+    table << "Compressed page writes" << zip_text << fort::endr;
+    snprintf(zip_text, sizeof(zip_text), "%.2f us", zip.written ? zip.compressNs / 1000.0 / zip.written : 0.0);
+    table << "Compression per page" << zip_text << fort::endr;
+    table << "Compressed page reads" << zip.read.load() << fort::endr;
+    snprintf(zip_text, sizeof(zip_text), "%.2f us", zip.read ? zip.decompressNs / 1000.0 / zip.read : 0.0);
+    table << "Decompression per page" << zip_text << fort::endr;
+    if (bpm == FileSystem::bpm && FileSystem::config.tierBytes > 0) {
+        table << "Compressed cache" << to_string(tier_pages) + " pages in " + to_string(tier_bytes >> 10) + " KB of "
+            + to_string(FileSystem::config.tierBytes >> 10) + " KB" << fort::endr;
+        table << "Compressed cache hits" << tier_hits << fort::endr;
+        table << "Compressed cache misses" << tier_misses << fort::endr;
+    } else {
+        table << "Compressed cache" << "off" << fort::endr;
+    }
+    table << "Warm-up" << (bpm->dumpFile.empty() ? "off" : to_string(warm_loaded) + "/" + to_string(warm_total) + " pages") << fort::endr;
+    return table.to_string();
+}
+
+string DBManager::show_buffer_pools() {
+    fort::char_table table;
+    table << fort::header << "Pool" << "Capacity (pages)" << "Hits" << "Misses" << "Hit ratio" << "Dirty evictions" << fort::endr;
+    auto row = [&](const string &name, BufPageManager *bpm) {
+        long long hits, misses, evict_writes, flushed_pages, flush_calls;
+        bpm->getStats(hits, misses);
+        bpm->getWriteStats(evict_writes, flushed_pages, flush_calls);
+        table << name << bpm->capacity << hits << misses << hit_ratio(hits, misses) << evict_writes << fort::endr;
+    };
+    row("shared", FileSystem::bpm);
+    for (auto &p : FileSystem::pools()) row(p.first, p.second);
+    // quotas of databases not used yet
+    for (auto &q : FileSystem::quotas())
+        if (!FileSystem::pools().count(q.first)) table << q.first << q.second << "-" << "-" << "-" << "-" << fort::endr;
+    return table.to_string();
+}
+
+void DBManager::resize_pool(BufPageManager *bpm, const string &value) {
+    int pages;
+    if (!parsePoolSize(value, pages, bpm->pageIdx)) throw DBException("Invalid buffer pool size " + value);
+    if (pages < bpm->minCapacity() || pages > bpm->maxCapacity)
+        throw DBException("Buffer pool size must be between " + to_string(bpm->minCapacity()) + " and "
+                + to_string(bpm->maxCapacity) + " pages");
+    record_handler->releasePage();
+    index_handler->releasePage();
+    if (!bpm->resize(pages)) throw DBException("Buffer pool pages are in use");
+}
+
+string DBManager::set_buffer_pool_size(const string &value) {
+    resize_pool(FileSystem::bpm, value);
+    FileSystem::config.capacity = FileSystem::bpm->capacity;
+    return "Buffer pool size set to " + to_string(FileSystem::bpm->capacity) + " pages";
+}
+
+string DBManager::set_buffer_pool_size(const string &name, const string &value) {
+    if (name == MANAGER_NAME) throw DBException("Invalid database name");
+    if (value == "shared" || value == "SHARED") {
+        if (page_size_idx(name) != PAGE_SIZE_IDX) throw DBException(name + " has larger pages than the shared buffer pool");
+        if (!FileSystem::quotas().erase(name)) return name + " already uses the shared buffer pool";
+        // written back and dropped from every pool, the shared one starts with no pages of the database
+        close_files(db_dir / name, false);
+        if (name == current_dbname) {
+            record_handler->setPool(FileSystem::bpm);
+            index_handler->setPool(FileSystem::bpm);
+        }
+        FileSystem::closePool(name);
+        return name + " uses the shared buffer pool";
+    }
+    auto it = FileSystem::pools().find(name);
+    if (it != FileSystem::pools().end()) {
+        resize_pool(it->second, value);
+        FileSystem::quotas()[name] = it->second->capacity << it->second->pageIdx - PAGE_SIZE_IDX;
+    } else {
+        // the same range resize_pool checks, in pages of PAGE_SIZE: the pool gets at least one shard of its own pages
+        int pages, shift = page_size_idx(name) - PAGE_SIZE_IDX;
+        int min_pages = BUF_MIN_SHARD_PAGES << shift, max_pages = FileSystem::config.maxCapacity >> shift << shift;
+        if (!parsePoolSize(value, pages)) throw DBException("Invalid buffer pool size " + value);
+        if (pages < min_pages || pages > max_pages)
+            throw DBException("Buffer pool size must be between " + to_string(min_pages) + " and "
+                    + to_string(max_pages) + " pages");
+        FileSystem::quotas()[name] = pages;
+        // otherwise the pool is created when the database is used
+        if (name == current_dbname) bind_pool(name);
+    }
+    return "Buffer pool size of " + name + " set to " + to_string(FileSystem::quotas()[name]) + " pages";
+}
+
 string DBManager::create_table(Schema &schema) {
     check_db();
     // check schema
@@ -143,6 +341,7 @@ string DBManager::create_table(Schema &schema) {
         if (code.value() == 0) return "Table already exists";
         return code.message();
     }
+    FileSystem::fm->setCompressed((db_dir / current_dbname / schema.table_name).string() + "/", schema.compressed);
     // add index for primary key & foreign key
     if(!schema.pk.pks.empty()){
         auto index_path = db_dir/current_dbname/schema.table_name/(schema.table_name+"_pk.index"); // implicit index
@@ -162,7 +361,7 @@ string DBManager::create_table(Schema &schema) {
 
     if (record_handler->createFile((file_name(schema) + ".data").data(), schema.record_type()))
         throw DBException("Create file failed");
-    FileSystem::save();
+    FileSystem::flushFiles((db_dir / current_dbname / schema.table_name).string());
 
     return "Created";
 }
@@ -172,7 +371,7 @@ string DBManager::drop_table(string name){
 	// check table
 	auto dir = db_dir / current_dbname / name;
 	std::error_code code;
-    FileSystem::save();
+    close_files(dir, true);
 	auto suc = fs::remove_all(dir, code);
 	if(suc) {
         schemas.erase(schemas.find(name));
@@ -185,7 +384,33 @@ string DBManager::drop_table(string name){
 
 string DBManager::describe_table(string name){
     check_db();
-    return get_schema(name).to_str();
+    auto &schema = get_schema(name);
+    string res = schema.to_str();
+    if (!schema.compressed) return res;
+    // sizes of the table's compressed files, with their dirty pages written back first
+    auto dir = db_dir / current_dbname / name;
+    FileSystem::flushFiles(dir.string());
+    auto open_ids = FileSystem::fm->openFilesUnder(dir.string());
+    unordered_set<int> was_open(open_ids.begin(), open_ids.end());
+    long long pages = 0, raw_bytes = 0, stored_bytes = 0, file_bytes = 0;
+    for (auto e : fs::directory_iterator{dir}) {
+        int file_id;
+        if (e.path().extension() == ".schema" || !FileSystem::fm->openFile(e.path().c_str(), file_id)) continue;
+        if (FileSystem::fm->isCompressed(file_id)) {
+            long long n, stored, bytes;
+            FileSystem::fm->getZipSize(file_id, n, stored, bytes);
+            pages += n;
+            raw_bytes += n << FileSystem::fm->getPageSizeIdx(file_id);
+            stored_bytes += stored;
+            file_bytes += bytes;
+        }
+        // files of a table not in use are only opened for their sizes
+        if (!was_open.count(file_id)) FileSystem::closeFiles(e.path().string(), false);
+    }
+    char ratio[32];
+    snprintf(ratio, sizeof(ratio), "%.2f", stored_bytes ? (double)raw_bytes / stored_bytes : 0.0);
+    return res + "COMPRESSED, " + to_string(pages) + " pages (" + to_string(raw_bytes >> 10) + " KB) stored in "
+        + to_string(stored_bytes >> 10) + " KB, ratio " + ratio + ", files " + to_string(file_bytes >> 10) + " KB\n";
 }
 
 string DBManager::load_data(string &filename, string &table_name){
@@ -207,18 +432,11 @@ string DBManager::load_data(string &filename, string &table_name){
             Value v;
             auto type = schema.columns[j].type;
             if(type == INT){
-                v.type = INT;
-                int value = std::stoi(value_str);
-                uint8_t *bytes = static_cast<uint8_t *>(static_cast<void *>(&value));
-                v.bytes = vector<uint8_t>(bytes, bytes + 4);
+                v = std::stoi(value_str);
             }else if(type == FLOAT){
-                v.type = FLOAT;
-                float value = std::stof(value_str);
-                uint8_t *bytes = static_cast<uint8_t *>(static_cast<void *>(&value));
-                v.bytes = vector<uint8_t>(bytes, bytes + 4);
+                v = std::stof(value_str);
             }else if(type == VARCHAR) {
-                v.type = VARCHAR;
-                v.bytes = vector<uint8_t>(value_str.begin(), value_str.end());
+                v = Value(VARCHAR, value_str.data(), value_str.size());
             }
             values.push_back(v);
 
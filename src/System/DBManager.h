@@ -15,6 +15,11 @@ using namespace std;
 
 #define DB_DIR "databases"
 #define MANAGER_NAME "MercuryDB"
+// databases created WITH PAGE_SIZE keep it in bytes in databases/<db>/page_size
+#define PAGE_SIZE_FILE "page_size"
+// --autovacuum vacuums a table once its deleted rows exceed THRESHOLD + rows / SCALE
+#define AUTOVACUUM_THRESHOLD 50
+#define AUTOVACUUM_SCALE 5
 
 typedef map<string,int> NameMap;
 
@@ -38,19 +43,44 @@ class DBManager {
 
     string file_name(const Schema& schema);
     void open_record(const Schema& schema);
+    void close_files(const filesystem::path& path, bool discard);
+    // point the handlers at the buffer pool of database name, creating it if the database has a quota
+    // or pages larger than PAGE_SIZE
+    void bind_pool(const string& name);
+    // page size exponent of database name, PAGE_SIZE_IDX unless it was created WITH PAGE_SIZE
+    static int page_size_idx(const string& name);
+    void resize_pool(BufPageManager *bpm, const string &value);
     Schema& get_schema(const string& table_name);
     Record to_record(const vector<Value>& value_list, const Schema& schema);
+    // stores the codes of record's dictionary-encoded values, adding the new values to their dictionaries,
+    // once the row has passed its checks; true if a value was added and the schema needs writing
+    bool encode(const Schema& schema, const vector<Value>& value_list, Record& record);
+    // mark the conditions on dictionary-encoded columns of schema's table that can compare codes
+    void encode_conditions(const Schema& schema, vector<Condition>& conditions);
     vector<Value> to_value_list(const Record& record, const Schema& schema);
+    vector<Value> to_value_list(const RecordView& view, const Schema& schema);
+    // only the columns marked in used are read, the others are left NULL, e.g. so that overflowed
+    // varchars the statement does not need are not read from their overflow pages
+    vector<Value> to_value_list(const RecordView& view, const Schema& schema, const vector<bool>& used);
     void check_ins_pk(const Schema& schema, const vector<Value>& value_list);
     void check_ins_fk(const Schema& schema, const vector<Value>& value_list);
     vector<pair<string,FK>> get_fks_ref(const Schema& schema);
     vector<int> get_pk_values(const Schema& schema, const vector<Value>& value_list);
     void check_del_pk(const vector<pair<string,FK>>& fks_ref, const vector<int>& pk_values);
-    bool check_conditions(const vector<Value>& value_list, const NameMap& column_map, const vector<Condition>& conditions);
+    // fields: schema.field_indexes(), conditions read the record in place
+    bool check_conditions(const RecordView& view, const Schema& schema, const vector<int>& fields,
+            const NameMap& column_map, const vector<Condition>& conditions);
     void check_column(const string& table_name, const NameMap& column_map, const QueryCol& col);
     void check_column(const NameMap& table_map, const vector<NameMap>& column_maps, const QueryCol& col);
-    Value get_value(const vector<vector<Value>>& value_lists,
-            const NameMap& table_map, const vector<NameMap>& column_maps, const QueryCol& col);
+    // value_lists hold the rows of all but the last table, whose row is read in place from view
+    ValueRef get_value(const vector<vector<Value>>& value_lists, const RecordView& view, const Schema& schema,
+            const vector<int>& fields, const NameMap& table_map, const vector<NameMap>& column_maps, const QueryCol& col);
+    // compact the table and repoint its indexes at the moved rows; returns the pages freed
+    int vacuum_table(const Schema& schema, int& moved);
+    // point the indexes of the table at rows moved from (old, new) Iterator::toInt() values
+    void repoint_indexes(const Schema& schema, const vector<pair<long long, long long>>& moves);
+    // after a delete or update, with --autovacuum=on
+    void autovacuum(const Schema& schema);
     pair<IndexHandler::Iterator,IndexHandler::Iterator> find_index(
             const Schema& schema, const vector<Condition>& conditions, bool& found, string& iname, int& isize);
 
@@ -60,12 +90,22 @@ class DBManager {
 
     string current_dbname;
     string create_db(string &name);
+    // page_size: 8K, 16K, 32K or 64K, or the same in bytes
+    string create_db(string &name, const string &page_size);
     string drop_db(string &name);
     string show_dbs();
     string use_db(string &name);
+    // mapped: files of the database opened from now on are read through mmap instead of the buffer pool
+    string use_db(string &name, bool mapped);
     string show_tables();
     string show_indexes();
+    string show_buffer_status();
+    string set_buffer_pool_size(const string &value);
+    // give database name a pool of its own with value as its quota, or "shared" to go back to the shared pool
+    string set_buffer_pool_size(const string &name, const string &value);
+    string show_buffer_pools();
 
+    // the files of the table are page-compressed if schema.compressed is set
     string create_table(Schema &schema);
 	string drop_table(string name);
 	string describe_table(string name);
@@ -74,6 +114,8 @@ class DBManager {
 	string insert(string table_name, vector<vector<Value>> &value_lists);
     string delete_(string table_name, vector<Condition> conditions);
     string update(string table_name, vector<pair<string,Value>> assignments, vector<Condition> conditions);
+    // table_name empty: every table of the current database
+    string vacuum(const string& table_name);
     Query select(vector<QueryCol> cols, vector<string> tables, vector<Condition> conditions,
             Aggregator aggregator, int limit = -1, int offset = 0);
 
@@ -83,6 +125,8 @@ class DBManager {
     string alter_drop_fk(string &table_name, string &fk_name);
     string alter_add_pk(string &table_name, string &pk_name, vector<string> &pks);
     string alter_add_fk(string &table_name, string &fk_name, string &ref_table_name, vector<string> &fields, vector<string> &ref_fields);
+    // store the codes of field's values in a dictionary instead of the values, or back
+    string alter_dictionary(string &table_name, string &field, bool add);
 
     string load_data(string &filename, string &table_name);
 };
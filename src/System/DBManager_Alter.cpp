@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <iterator>
 #include <unordered_set>
 
@@ -34,8 +35,10 @@ string DBManager::alter_add_index(string &table_name, vector<string> &fields) {
     if (index_handler->createIndex(index_path.c_str(), fields.size()))
         throw DBException("Create file failed");
     open_record(schema);
+    vector<bool> used(schema.columns.size());
+    for (auto column_index : column_indexes) used[column_index] = true;
     for (auto i = record_handler->begin(); !i.isEnd(); ++i) {
-        auto values = to_value_list(*i, schema);
+        auto values = to_value_list(i.view(), schema, used);
         vector<int> ints;
         bool has_null = false;
         for (auto &column_index : column_indexes) {
@@ -43,12 +46,12 @@ string DBManager::alter_add_index(string &table_name, vector<string> &fields) {
                 has_null = true;
                 break;
             }
-            ints.push_back(*((int *)(&values[column_index].bytes[0])));
+            ints.push_back(values[column_index].toInt());
         }
         if (has_null) continue;
         index_handler->ins(ints.data(), i.toInt());
     }
-    FileSystem::save();
+    FileSystem::flushFiles(index_path.string());
     return "Added";
 }
 
@@ -72,11 +75,13 @@ string DBManager::alter_drop_index(string &table_name, vector<string> &fields) {
     // update index filenames
     auto table_path = db_dir / current_dbname / table_name;
     std::error_code err;
-    FileSystem::save();
+    close_files(table_path / (table_name + to_string(pos) + ".index"), true);
     fs::remove(table_path / (table_name + to_string(pos) + ".index"), err);
     if (err.value() != 0) throw DBException(err.message());
     int max_pos = indexes.size();
     for (int i = pos + 1; i <= max_pos; i++) {
+        // the file is reopened under its new name
+        close_files(table_path / (table_name + to_string(i) + ".index"), false);
         fs::rename(
             table_path / (table_name + to_string(i) + ".index"),
             table_path / (table_name + to_string(i - 1) + ".index"),
@@ -104,7 +109,7 @@ string DBManager::alter_drop_pk(string &table_name, string &pk_name) {
 	}
 
     // delete corresponding index
-    FileSystem::save();
+    close_files(db_dir / current_dbname / table_name / (table_name + "_pk.index"), true);
     fs::remove(db_dir / current_dbname / table_name / (table_name + "_pk.index"));
     // delete pk
     schema.pk.pks.clear();
@@ -120,7 +125,7 @@ string DBManager::alter_drop_fk(string &table_name, string &fk_name) {
     int i = schema.find_fk_by_name(fk_name);
     if (i == schema.fks.size()) throw DBException(fmt("No foreign key '%s'", fk_name.c_str()));
 	// delete index
-    FileSystem::save();
+    close_files(db_dir / current_dbname / table_name / (table_name + "_" + schema.fks[i].name + ".index"), true);
 	fs::remove(db_dir / current_dbname / table_name / (table_name + "_" + schema.fks[i].name + ".index"));
 	// delete fk
     schema.fks.erase(schema.fks.begin() + i);
@@ -149,19 +154,21 @@ string DBManager::alter_add_pk(string &table_name, string &pk_name, vector<strin
     if ( index_handler->createIndex(index_path.c_str(), pks.size()))
         throw DBException("Create file failed");
     open_record(schema);
+    vector<bool> used(schema.columns.size());
+    for (auto column_index : column_indexes) used[column_index] = true;
     for (auto i = record_handler->begin(); !i.isEnd(); ++i) {
-        auto values = to_value_list(*i, schema);
+        auto values = to_value_list(i.view(), schema, used);
         vector<int> ints;
         for (auto &column_index : column_indexes) {
             if (values[column_index].type == NULL_TYPE){
-				FileSystem::save();
+				close_files(index_path, true);
 				fs::remove(index_path);
                 throw DBException("ERROR: NULL values found");
 			}
-            ints.push_back(*((int *)(&values[column_index].bytes[0])));
+            ints.push_back(values[column_index].toInt());
         }
         if (pk_values.find(ints) != pk_values.end()) {
-			FileSystem::save();
+			close_files(index_path, true);
 			fs::remove(index_path);
             stringstream ss;
             copy(ints.begin(), ints.end(), ostream_iterator<int>(ss, " "));
@@ -170,7 +177,7 @@ string DBManager::alter_add_pk(string &table_name, string &pk_name, vector<strin
         pk_values.insert(ints);
 		index_handler->ins(ints.data(), i.toInt());
     }
-	FileSystem::save();
+	FileSystem::flushFiles(index_path.string());
 
     schema.pk.name = pk_name;
     schema.pk.pks = pks;
@@ -212,10 +219,12 @@ string DBManager::alter_add_fk(string &table_name, string &fk_name, string &ref_
 	
 	auto ref_index_path = db_dir / current_dbname / ref_table_name / (ref_table_name + "_pk.index");
 
+    vector<bool> used(schema.columns.size());
+    for (auto column_index : column_indexes) used[column_index] = true;
     for (auto i = record_handler->begin(); !i.isEnd(); ++i) {
 		index_handler->openIndex(ref_index_path.c_str(), ref_fields.size());
 
-        auto values = to_value_list(*i, schema);
+        auto values = to_value_list(i.view(), schema, used);
         vector<int> ints;
         bool has_null = false;
         for (auto &column_index : column_indexes) {
@@ -223,12 +232,12 @@ string DBManager::alter_add_fk(string &table_name, string &fk_name, string &ref_
                 has_null = true;
                 break;
             }
-            ints.push_back(*((int *)(&values[column_index].bytes[0])));
+            ints.push_back(values[column_index].toInt());
         }
         if (has_null) continue;
         auto it = index_handler->find(ints.data());
         if (it.isEnd()) {
-			FileSystem::save();
+			close_files(index_path, true);
 			fs::remove(index_path);
             stringstream ss;
             copy(ints.begin(), ints.end(), ostream_iterator<int>(ss, ", "));
@@ -238,7 +247,7 @@ string DBManager::alter_add_fk(string &table_name, string &fk_name, string &ref_
 		index_handler->openIndex(index_path.c_str(), fields.size());
 		index_handler->ins(ints.data(), i.toInt());
     }
-	FileSystem::save();
+	FileSystem::flushFiles(index_path.string());
 
 	FK fk;
 	fk.name = fk_name;
@@ -251,3 +260,51 @@ string DBManager::alter_add_fk(string &table_name, string &fk_name, string &ref_
 
     return "Added";
 }
+
+string DBManager::alter_dictionary(string &table_name, string &field, bool add) {
+    check_db();
+    auto &schema = get_schema(table_name);
+    int column_index = schema.find_column(field);
+    if (column_index == schema.columns.size())
+        throw DBException("There is no field '" + field + "' in the schema");
+    auto &column = schema.columns[column_index];
+    if (column.type != VARCHAR) throw DBException("Field '" + field + "' is not VARCHAR");
+    if ((column.dictionary != nullptr) == add)
+        throw DBException("Field '" + field + (add ? "' already has a dictionary" : "' has no dictionary"));
+    int varchar_index = schema.field_indexes()[column_index];
+    open_record(schema);
+    // check every row first, so that a failure leaves the table as it is
+    auto dictionary = add ? make_shared<Dictionary>() : column.dictionary;
+    vector<long long> rows;
+    for (auto i = record_handler->begin(); !i.isEnd(); ++i) {
+        rows.push_back(i.toInt());
+        if (add) {
+            RecordView view = i.view();
+            if (view.varchar_null(varchar_index)) continue;
+            dictionary->add(string(view.varchar_data(varchar_index)));
+            if (dictionary->values.size() > DICTIONARY_MAX)
+                throw DBException(fmt("Field '%s' has more than %d distinct values", field.c_str(), DICTIONARY_MAX));
+        }
+        else {
+            Record record = *i;
+            auto &value = record.varchar_data[varchar_index];
+            if (!record.varchar_null[varchar_index]) value = dictionary->values[Dictionary::decode(value)];
+            if (!record_handler->fits(record)) throw DBException("Row too long");
+        }
+    }
+    // then each row is rewritten with the code of its value, or the value again; rows that grow may move
+    vector<pair<long long, long long>> moves;
+    for (auto row : rows) {
+        RecordHandler::Iterator i(record_handler, row);
+        Record record = *i;
+        auto &value = record.varchar_data[varchar_index];
+        if (!record.varchar_null[varchar_index])
+            value = add ? Dictionary::encode(dictionary->find(value)) : dictionary->values[Dictionary::decode(value)];
+        long long to = record_handler->upd(i, record).toInt();
+        if (to != row) moves.push_back(make_pair(row, to));
+    }
+    repoint_indexes(schema, moves);
+    column.dictionary = add ? dictionary : nullptr;
+    if (!schema.write(current_dbname)) throw DBException("Write schema failed");
+    return add ? "Dictionary added" : "Dictionary dropped";
+}
@@ -15,6 +15,13 @@ void DBManager::open_record(const Schema& schema) {
     record_handler->openFile((file_name(schema) + ".data").data(), schema.record_type());
 }
 
+void DBManager::close_files(const filesystem::path& path, bool discard) {
+    // the handlers must not keep a page of a file that is about to be closed
+    record_handler->closeFile();
+    index_handler->releasePage();
+    FileSystem::closeFiles(path.string(), discard);
+}
+
 string DBManager::rows_text(int row) {
     return to_string(row) + " row" + (row > 1 ? "s" : "");
 }
@@ -40,19 +47,28 @@ Record DBManager::to_record(const vector<Value>& value_list, const Schema& schem
             throw DBException((string)"Invalid value type of Column \"" + column.name + "\"");
         else if (value.type == VARCHAR) {
             record.varchar_null[varchar_count] = false;
-            if (value.bytes.size() > column.varchar_len)
+            if (value.size() > column.varchar_len)
                 throw DBException((string)"Varchar \"" + column.name + "\" too long");
-            record.varchar_data[varchar_count++] = string(value.bytes.begin(), value.bytes.end());
+            if (column.dictionary) {
+                // a new value gets its code in encode, once the row passes its checks; until then
+                // the field holds code 0, which has the size of any code, so that fits sees the row as stored
+                int code = column.dictionary->find(value.toString());
+                if (code < 0 && column.dictionary->values.size() >= DICTIONARY_MAX)
+                    throw DBException((string)"Too many distinct values in dictionary of \"" + column.name + "\"");
+                record.varchar_data[varchar_count++] = Dictionary::encode(max(code, 0));
+            }
+            else record.varchar_data[varchar_count++] = value.toString();
         }
         else {
             record.int_null[int_count] = false;
             if (column.type == FLOAT && value.type == INT) {
-                float v = *((int*)value.bytes.data());
+                float v = value.toInt();
                 record.int_data[int_count++] = *((int*)&v);
             }
-            else record.int_data[int_count++] = *((int*)value.bytes.data());
+            else record.int_data[int_count++] = value.toInt();
         }
     }
+    if (!record_handler->fits(record)) throw DBException("Row too long");
     return record;
 }
 
@@ -62,21 +78,14 @@ vector<Value> DBManager::to_value_list(const Record& record, const Schema& schem
     for (auto column: schema.columns) {
         Value v;
         if (column.type == VARCHAR) {
-            if (record.varchar_null[varchar_count]) v.type = NULL_TYPE;
-            else {
-                v.type = VARCHAR;
+            if (!record.varchar_null[varchar_count]) {
                 auto& s = record.varchar_data[varchar_count];
-                v.bytes = vector<uint8_t>(s.begin(), s.end());
+                v = Value(VARCHAR, s.data(), s.size());
             }
             ++varchar_count;
         }
         else {
-            if (record.int_null[int_count]) v.type = NULL_TYPE;
-            else {
-                v.type = column.type;
-                uint8_t* data = (uint8_t*)(&record.int_data[int_count]);
-                v.bytes = vector<uint8_t>(data, data+4);
-            }
+            if (!record.int_null[int_count]) v = Value(column.type, &record.int_data[int_count], sizeof(int));
             ++int_count;
         }
         value_list.push_back(v);
@@ -84,13 +93,80 @@ vector<Value> DBManager::to_value_list(const Record& record, const Schema& schem
     return value_list;
 }
 
+bool DBManager::encode(const Schema& schema, const vector<Value>& value_list, Record& record) {
+    bool added = false;
+    int varchar_count = 0;
+    for (int i = 0; i < schema.columns.size(); ++i) {
+        auto& column = schema.columns[i];
+        if (column.type != VARCHAR) continue;
+        int field = varchar_count++;
+        if (!column.dictionary || value_list[i].type == NULL_TYPE) continue;
+        int size = column.dictionary->values.size();
+        record.varchar_data[field] = Dictionary::encode(column.dictionary->add(value_list[i].toString()));
+        added |= column.dictionary->values.size() > size;
+    }
+    return added;
+}
+
+// Writes the schema of a statement's table once if the statement added dictionary values,
+// also when the statement stops early, so that the schema has the codes its records hold
+struct DictionaryWriter {
+    Schema& schema;
+    const string& dbname;
+    bool added = false;
+    DictionaryWriter(Schema& schema, const string& dbname): schema(schema), dbname(dbname) {}
+    void write() {
+        if (!added) return;
+        added = false;
+        if (!schema.write(dbname)) throw DBException("Cannot write to schema file");
+    }
+    ~DictionaryWriter() {
+        if (added) schema.write(dbname);
+    }
+};
+
+// code of the dictionary-encoded field of the record in place, -1 when it is NULL
+static int field_code(const RecordView& view, int field) {
+    return view.varchar_null(field) ? -1 : Dictionary::decode(view.varchar_data(field));
+}
+
+// column's field of the record in place, NULL_TYPE when it is NULL
+static ValueRef field_ref(const RecordView& view, const Column& column, int field) {
+    if (column.type == VARCHAR) {
+        if (view.varchar_null(field)) return ValueRef();
+        if (column.dictionary) {
+            auto& s = column.dictionary->values[field_code(view, field)];
+            return ValueRef(VARCHAR, (const uint8_t*)s.data(), s.size());
+        }
+        string_view s = view.varchar_data(field);
+        return ValueRef(VARCHAR, (const uint8_t*)s.data(), s.size());
+    }
+    if (view.int_null(field)) return ValueRef();
+    return ValueRef(column.type, view.int_bytes(field), sizeof(int));
+}
+
+vector<Value> DBManager::to_value_list(const RecordView& view, const Schema& schema) {
+    return to_value_list(view, schema, vector<bool>(schema.columns.size(), true));
+}
+
+vector<Value> DBManager::to_value_list(const RecordView& view, const Schema& schema, const vector<bool>& used) {
+    vector<Value> value_list;
+    int int_count = 0, varchar_count = 0;
+    for (int i = 0; i < schema.columns.size(); ++i) {
+        auto& column = schema.columns[i];
+        int field = column.type == VARCHAR ? varchar_count++ : int_count++;
+        value_list.push_back(used[i] ? field_ref(view, column, field).value() : Value());
+    }
+    return value_list;
+}
+
 void DBManager::check_ins_pk(const Schema& schema, const vector<Value>& value_list) {
     if (!schema.pk.pks.empty()) {
         vector<int> pk_values;
         for (auto pk: schema.pk.pks) {
             int pki = schema.find_column(pk);
             if (value_list[pki].type == NULL_TYPE) throw DBException("Primary key should not be NULL");
-            pk_values.push_back(*((int*)value_list[pki].bytes.data()));  
+            pk_values.push_back(value_list[pki].toInt());  
         }
         auto index_path = db_dir / current_dbname / schema.table_name / (schema.table_name + "_pk.index");
         index_handler->openIndex(index_path.c_str(), schema.pk.pks.size());
@@ -106,7 +182,7 @@ void DBManager::check_ins_fk(const Schema& schema, const vector<Value>& value_li
         for (auto fk_col: fk.fks) {
             int fki = schema.find_column(fk_col);
             if (value_list[fki].type == NULL_TYPE) {has_null = true; break;}
-            fk_values.push_back(*((int*)value_list[fki].bytes.data()));
+            fk_values.push_back(value_list[fki].toInt());
         }
         if (has_null) continue;
         auto ref_index_path = db_dir / current_dbname / fk.ref_table / (fk.ref_table + "_pk.index");
@@ -132,7 +208,7 @@ vector<int> DBManager::get_pk_values(const Schema& schema, const vector<Value>&
     vector<int> pk_values;
     for(auto pk_col : schema.pk.pks) {
         int pk_i = schema.find_column(pk_col);
-        pk_values.push_back(*((int*)value_list[pk_i].bytes.data()));
+        pk_values.push_back(value_list[pk_i].toInt());
     }
     return pk_values;
 }
@@ -155,6 +231,7 @@ string DBManager::insert(string table_name, vector<vector<Value>> &value_lists){
 
     int count = 0;
     vector<string> fails;
+    DictionaryWriter dictionaries(schema, current_dbname);
     for(auto value_list: value_lists) {
         RecordType _type;
         Record record(_type);
@@ -169,6 +246,7 @@ string DBManager::insert(string table_name, vector<vector<Value>> &value_lists){
         }
         // insert record
         ++count;
+        dictionaries.added |= encode(schema, value_list, record);
         auto index_val = record_handler->ins(record).toInt();
         for (auto index: schema.get_indexes()) {
             vector<int> key_values;
@@ -176,13 +254,14 @@ string DBManager::insert(string table_name, vector<vector<Value>> &value_lists){
             for (auto key: index.second) {
                 int ki = schema.find_column(key);
                 if (value_list[ki].type == NULL_TYPE) {has_null = true; break;}
-                key_values.push_back(*((int*)value_list[ki].bytes.data()));  
+                key_values.push_back(value_list[ki].toInt());  
             }
             if (has_null) continue;
             index_handler->openIndex((table_path / index.first).c_str(), index.second.size());
             index_handler->ins(key_values.data(), index_val);
         }
     }
+    dictionaries.write();
     double use_time = (double)(clock() - start) / CLOCKS_PER_SEC;
     string result = "Insert " + rows_text(count) + " OK (" + to_string(use_time) + " Sec)";
     if (!fails.empty()) {
@@ -192,16 +271,48 @@ string DBManager::insert(string table_name, vector<vector<Value>> &value_lists){
     return result;
 }
 
-bool DBManager::check_conditions(const vector<Value>& value_list, const NameMap& column_map, const vector<Condition>& conditions) {
-    for (auto cond: conditions) {
-        Value a = value_list[column_map.at(cond.a.second)];
+void DBManager::encode_conditions(const Schema& schema, vector<Condition>& conditions) {
+    for (auto& cond: conditions) {
+        if (cond.a.first != schema.table_name || !cond.b_col.second.empty()) continue;
+        if (cond.op != EQUAL && cond.op != NOT_EQUAL && cond.op != IN) continue;
+        auto& dictionary = schema.columns[schema.find_column(cond.a.second)].dictionary;
+        if (!dictionary) continue;
+        if (cond.op == IN) {
+            cond.b_codes.assign(dictionary->values.size(), false);
+            for (auto& value_list: cond.b_value_lists) for (auto& value: value_list) {
+                // like Condition::check_in, a NULL in the list matches no row
+                if (value.type == NULL_TYPE) continue;
+                if (value.type != VARCHAR) throw DBException("Values to compare should have a same type");
+                int code = dictionary->find(string_view((const char*)value.data(), value.size()));
+                if (code >= 0) cond.b_codes[code] = true;
+            }
+        }
+        else if (cond.b_val.type == NULL_TYPE) cond.b_code = -2;
+        else if (cond.b_val.type != VARCHAR) throw DBException("Values to compare should have a same type");
+        else cond.b_code = dictionary->find(string_view((const char*)cond.b_val.data(), cond.b_val.size()));
+        cond.on_codes = true;
+    }
+}
+
+bool DBManager::check_conditions(const RecordView& view, const Schema& schema, const vector<int>& fields,
+        const NameMap& column_map, const vector<Condition>& conditions) {
+    for (auto& cond: conditions) {
+        int ai = column_map.at(cond.a.second);
+        if (cond.on_codes) {
+            if (cond.check_code(field_code(view, fields[ai]))) continue;
+            return false;
+        }
+        ValueRef a = field_ref(view, schema.columns[ai], fields[ai]);
         if (cond.op == IN) {
             if (cond.check_in(a)) continue;
-            else break;
+            return false;
         }
-        Value b;
+        ValueRef b;
         if (cond.b_col.second.empty()) b = cond.b_val;
-        else b = value_list[column_map.at(cond.b_col.second)];
+        else {
+            int bi = column_map.at(cond.b_col.second);
+            b = field_ref(view, schema.columns[bi], fields[bi]);
+        }
         if (!Condition::cmp(a, b, cond.op)) return false;
     }
     return true;
@@ -220,14 +331,17 @@ string DBManager::delete_(string table_name, vector<Condition> conditions) {
         check_column(table_name, column_map, cond.a);
         if (!cond.b_col.second.empty()) check_column(table_name, column_map, cond.b_col);
     }
+    encode_conditions(schema, conditions);
     // find tables whose fk references current table
     auto fks_ref_current = get_fks_ref(schema);
-    // delete
+    // delete, only rows passing the conditions are decoded, and only their keys
+    auto fields = schema.field_indexes();
+    auto keys = schema.key_columns();
     int count = 0;
     vector<string> fails;
     for (auto it = record_handler->begin(); !it.isEnd(); ) {
-        auto value_list = to_value_list(*it, schema);
-        if (check_conditions(value_list, column_map, conditions)) {
+        if (check_conditions(it.view(), schema, fields, column_map, conditions)) {
+            auto value_list = to_value_list(it.view(), schema, keys);
             // fk constraint check
             auto pk_values = get_pk_values(schema, value_list);
             try {
@@ -235,17 +349,18 @@ string DBManager::delete_(string table_name, vector<Condition> conditions) {
             }    
             catch (DBException e) {
                 fails.push_back(e.what());
+                ++it;
                 continue;
             }
             // delete from index
-            int index_val = it.toInt();
+            long long index_val = it.toInt();
             for(auto index : schema.get_indexes()){
                 vector<int> key_values;
                 bool has_null = false;
                 for(auto key : index.second){
                     int ki = schema.find_column(key);
                     if(value_list[ki].type == NULL_TYPE) {has_null = true; break;}
-                    key_values.push_back(*((int*)value_list[ki].bytes.data()));
+                    key_values.push_back(value_list[ki].toInt());
                 }
                 if(has_null) continue;
                 index_handler->openIndex((db_dir/current_dbname/table_name/index.first).c_str(), index.second.size());
@@ -257,6 +372,7 @@ string DBManager::delete_(string table_name, vector<Condition> conditions) {
         }
         else ++it;
     }
+    autovacuum(schema);
     double use_time = (double)(clock() - start) / CLOCKS_PER_SEC;
     string result = "Delete " + rows_text(count) + " OK (" + to_string(use_time) + " Sec)";
     if (!fails.empty()) {
@@ -266,6 +382,54 @@ string DBManager::delete_(string table_name, vector<Condition> conditions) {
     return result;
 }
 
+int DBManager::vacuum_table(const Schema& schema, int& moved) {
+    open_record(schema);
+    vector<pair<long long, long long>> moves;
+    int freed = record_handler->vacuum(moves);
+    moved += moves.size();
+    repoint_indexes(schema, moves);
+    return freed;
+}
+
+void DBManager::repoint_indexes(const Schema& schema, const vector<pair<long long, long long>>& moves) {
+    // the indexes still point at the old places of moved rows, their keys are unchanged
+    auto keys = schema.key_columns();
+    for (auto move: moves) {
+        auto value_list = to_value_list(RecordHandler::Iterator(record_handler, move.second).view(), schema, keys);
+        for (auto index : schema.get_indexes()) {
+            vector<int> key_values;
+            bool has_null = false;
+            for (auto key : index.second) {
+                int ki = schema.find_column(key);
+                if (value_list[ki].type == NULL_TYPE) {has_null = true; break;}
+                key_values.push_back(value_list[ki].toInt());
+            }
+            if (has_null) continue;
+            index_handler->openIndex((db_dir/current_dbname/schema.table_name/index.first).c_str(), index.second.size());
+            index_handler->upd(key_values.data(), move.first, key_values.data(), move.second);
+        }
+    }
+}
+
+string DBManager::vacuum(const string& table_name) {
+    check_db();
+    clock_t start = clock();
+    int moved = 0, freed = 0;
+    if (!table_name.empty()) freed = vacuum_table(get_schema(table_name), moved);
+    else for (auto& schema: schemas) freed += vacuum_table(schema.second, moved);
+    double use_time = (double)(clock() - start) / CLOCKS_PER_SEC;
+    return "Vacuum " + (table_name.empty() ? current_dbname : table_name) + " OK, " + rows_text(moved) + " moved, " +
+        to_string(freed) + " page" + (freed > 1 ? "s" : "") + " freed (" + to_string(use_time) + " Sec)";
+}
+
+void DBManager::autovacuum(const Schema& schema) {
+    if (!FileSystem::autovacuum) return;
+    // like the default of PostgreSQL: dead rows over a fifth of the table, and not just a few
+    if (record_handler->deadRows() <= AUTOVACUUM_THRESHOLD + record_handler->rows() / AUTOVACUUM_SCALE) return;
+    int moved = 0;
+    vacuum_table(schema, moved);
+}
+
 string DBManager::update(string table_name, vector<pair<string,Value>> assignments, vector<Condition> conditions) {
     check_db();
     Schema& schema = get_schema(table_name);
@@ -282,14 +446,17 @@ string DBManager::update(string table_name, vector<pair<string,Value>> assignmen
         check_column(table_name, column_map, cond.a);
         if (!cond.b_col.second.empty()) check_column(table_name, column_map, cond.b_col);
     }
+    encode_conditions(schema, conditions);
     // find tables whose fk references current table
     auto fks_ref_current = get_fks_ref(schema);
-    // update
+    // update, only rows passing the conditions are decoded
+    auto fields = schema.field_indexes();
     int count = 0;
     vector<string> fails;
+    DictionaryWriter dictionaries(schema, current_dbname);
     for (auto it = record_handler->begin(); !it.isEnd(); ) {
-        auto value_list = to_value_list(*it, schema);
-        if (check_conditions(value_list, column_map, conditions)) {
+        if (check_conditions(it.view(), schema, fields, column_map, conditions)) {
+            auto value_list = to_value_list(it.view(), schema);
             ++count;
             auto old_value_list = value_list;
             auto old_pk_values = get_pk_values(schema, value_list);
@@ -311,12 +478,14 @@ string DBManager::update(string table_name, vector<pair<string,Value>> assignmen
             }
             catch (DBException e) {
                 fails.push_back(e.what());
+                ++it;
                 continue;
             }
 
             // update record
-            int old_index_val = it.toInt();
-            int index_val = record_handler->upd(it++, record).toInt();
+            dictionaries.added |= encode(schema, value_list, record);
+            long long old_index_val = it.toInt();
+            long long index_val = record_handler->upd(it++, record).toInt();
 
             // update index
             for(auto index : schema.get_indexes()){
@@ -326,8 +495,8 @@ string DBManager::update(string table_name, vector<pair<string,Value>> assignmen
                     int ki = schema.find_column(key);
                     if (value_list[ki].type == NULL_TYPE) has_null = true;
                     if (old_value_list[ki].type == NULL_TYPE) old_has_null = true;
-                    if (!has_null) key_values.push_back(*((int*)value_list[ki].bytes.data()));
-                    if (!old_has_null) old_key_values.push_back(*((int*)old_value_list[ki].bytes.data()));
+                    if (!has_null) key_values.push_back(value_list[ki].toInt());
+                    if (!old_has_null) old_key_values.push_back(old_value_list[ki].toInt());
                 }
                 if (has_null && old_has_null) continue;
                 index_handler->openIndex((db_dir/current_dbname/table_name/index.first).c_str(), index.second.size());
@@ -341,6 +510,8 @@ string DBManager::update(string table_name, vector<pair<string,Value>> assignmen
         }
         else ++it;
     }
+    dictionaries.write();
+    autovacuum(schema);
     double use_time = (double)(clock() - start) / CLOCKS_PER_SEC;
     string result = "Update " + rows_text(count) + " OK (" + to_string(use_time) + " Sec)";
     if (!fails.empty()) {
@@ -365,11 +536,12 @@ void DBManager::check_column(const NameMap& table_map, const vector<NameMap>& co
         throw DBException((string)"Column \"" + col.first + "." + col.second + "\" does not exist");
 }
 
-Value DBManager::get_value(const vector<vector<Value>>& value_lists,
-        const NameMap& table_map, const vector<NameMap>& column_maps, const QueryCol& col) {
+ValueRef DBManager::get_value(const vector<vector<Value>>& value_lists, const RecordView& view, const Schema& schema,
+        const vector<int>& fields, const NameMap& table_map, const vector<NameMap>& column_maps, const QueryCol& col) {
     int table = table_map.at(col.first);
     int column = column_maps[table].at(col.second);
-    return value_lists[table][column];
+    if (table + 1 < value_lists.size()) return value_lists[table][column];
+    return field_ref(view, schema.columns[column], fields[column]);
 }
 
 Query DBManager::select(vector<QueryCol> cols, vector<string> tables, vector<Condition> conditions,
@@ -403,6 +575,18 @@ Query DBManager::select(vector<QueryCol> cols, vector<string> tables, vector<Con
         check_column(table_map, column_maps, cond.a);
         if (!cond.b_col.second.empty()) check_column(table_map, column_maps, cond.b_col);
     }
+    // only the columns the query reads are decoded from the rows of the outer tables
+    vector<vector<bool>> used;
+    for (auto& schema: schemas) used.push_back(vector<bool>(schema.columns.size()));
+    auto use = [&](const QueryCol& col) {
+        int table = table_map[col.first];
+        used[table][column_maps[table][col.second]] = true;
+    };
+    for (auto& col: query.columns) use(col);
+    for (auto& cond: conditions) {
+        use(cond.a);
+        if (!cond.b_col.second.empty()) use(cond.b_col);
+    }
     // search
     // -- init its
     vector<RecordHandler::Iterator> its;
@@ -420,60 +604,98 @@ Query DBManager::select(vector<QueryCol> cols, vector<string> tables, vector<Con
         auto it = find_index(schema, conditions, found, iname, isize);
         if (found && it.first == it.second) return query;
         ifound.push_back(found);
-        inames.push_back(schema.table_name + "/" + iname);
+        inames.push_back((db_dir / current_dbname / schema.table_name / iname).string());
         isizes.push_back(isize);
         iits.push_back(it.first);
         ibegin.push_back(it.first);
         iend.push_back(it.second);
     }
     // -- loop
+    // rows of the outer tables are decoded each time their iterator moves, the row of the innermost
+    // table is read in place and only decoded for the columns of combinations passing the conditions
+    int inner = its.size() - 1;
+    auto fields = schemas[inner].field_indexes();
+    vector<vector<Value>> value_lists(its.size());
+    // dictionary-encoded columns of the innermost table are compared and grouped by their codes
+    encode_conditions(schemas[inner], conditions);
+    auto& group_by = aggregator.group_by;
+    shared_ptr<Dictionary> group_dictionary;
+    int group_field;
+    if (!group_by.second.empty() && group_by.first == tables[inner]) {
+        int column = column_maps[inner][group_by.second];
+        group_dictionary = schemas[inner].columns[column].dictionary;
+        group_field = fields[column];
+    }
+    // the record file is only reopened when the scan moves to another table
+    int opened = -1;
+    auto open = [&](int i) {
+        if (i != opened) open_record(schemas[i]);
+        opened = i;
+    };
+    auto current = [&](int i) {
+        open(i);
+        if (!ifound[i]) return its[i];
+        index_handler->openIndex(inames[i].c_str(), isizes[i]);
+        return RecordHandler::Iterator(record_handler, *iits[i]);
+    };
+    int moved = 0;
     while (limit == -1 || query.value_lists.size() < limit) {
         int i;
         // get values
-        vector<vector<Value>> value_lists;
-        for (i = 0; i < its.size(); ++i) {
-            open_record(schemas[i]);
-            if (ifound[i]) {
-                index_handler->openIndex((db_dir / current_dbname / inames[i]).c_str(), isizes[i]);
-                auto it = RecordHandler::Iterator(record_handler, *iits[i]);
-                value_lists.push_back(to_value_list(*it, schemas[i]));
-            }
-            else value_lists.push_back(to_value_list(*its[i], schemas[i]));
-        }
+        for (i = moved; i < inner; ++i) value_lists[i] = to_value_list(current(i).view(), schemas[i], used[i]);
+        RecordView view = current(inner).view();
         // check conditions
         for (i = 0; i < conditions.size(); ++i) {
             Condition& cond = conditions[i];
-            Value a = get_value(value_lists, table_map, column_maps, cond.a);
+            if (cond.on_codes) {
+                if (cond.check_code(field_code(view, fields[column_maps[inner][cond.a.second]]))) continue;
+                else break;
+            }
+            ValueRef a = get_value(value_lists, view, schemas[inner], fields, table_map, column_maps, cond.a);
             if (cond.op == IN) {
                 if (cond.check_in(a)) continue;
                 else break;
             }
-            Value b;
+            ValueRef b;
             if (cond.b_col.second.empty()) b = cond.b_val;
-            else b = get_value(value_lists, table_map, column_maps, cond.b_col);
+            else b = get_value(value_lists, view, schemas[inner], fields, table_map, column_maps, cond.b_col);
             if (!Condition::cmp(a, b, cond.op)) break;
         }
         // conditions ok
         if (i == conditions.size()) {
-            vector<Value> value_list;
-            for (auto col: query.columns) value_list.push_back(get_value(value_lists, table_map, column_maps, col));
-            if (!offset) query += value_list;
+            if (!offset) {
+                vector<Value> value_list;
+                // the GROUP BY column comes last
+                int n = query.columns.size() - (group_dictionary ? 1 : 0);
+                for (int j = 0; j < n; ++j)
+                    value_list.push_back(get_value(value_lists, view, schemas[inner], fields, table_map, column_maps, query.columns[j]).value());
+                if (group_dictionary) {
+                    int code = field_code(view, group_field);
+                    value_list.push_back(code < 0 ? Value() : Value(code));
+                }
+                query += value_list;
+            }
             else --offset;
         }
         // ++its
         for (i=its.size()-1; i >= 0 ; --i) {
             if (ifound[i]) {
-                index_handler->openIndex((db_dir / current_dbname / inames[i]).c_str(), isizes[i]);
+                index_handler->openIndex(inames[i].c_str(), isizes[i]);
                 if (++iits[i] != iend[i]) break;
                 iits[i] = ibegin[i];
             }
             else {
-                open_record(schemas[i]);
+                open(i);
                 if (!(++its[i]).isEnd()) break;
                 its[i] = record_handler->begin();
             }
         }
         if (i < 0) break;
+        moved = i;
+    }
+    if (group_dictionary) for (auto& value_list: query.value_lists) {
+        auto& s = group_dictionary->values[value_list.back().toInt()];
+        value_list.back() = Value(VARCHAR, s.data(), s.size());
     }
     return query;
 }
@@ -490,7 +712,7 @@ pair<IndexHandler::Iterator,IndexHandler::Iterator> DBManager::find_index(
             for (auto cond: conditions) {
                 if (cond.a.first == schema.table_name && cond.a.second == col && cond.b_col.second.empty() &&
                         (cond.op == EQUAL || cond.op == LESS || cond.op == LESS_EQUAL || cond.op == GREATER || cond.op == GREATER_EQUAL)) {
-                    int b = *((int*)cond.b_val.bytes.data());
+                    int b = cond.b_val.toInt();
                     if (cond.op == EQUAL) l = max(l, b), r = min(r, b);
                     if (cond.op == LESS) {if (b != INT32_MIN) r = min(r, b-1); else l = INT32_MAX, r = INT32_MIN;}
                     if (cond.op == LESS_EQUAL) r = min(r, b);
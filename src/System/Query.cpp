@@ -8,40 +8,40 @@
 
 using namespace std;
 
-int Condition::cmpVarchar(const Value& a, const Value& b) {
-    for (int i = 0; i < a.bytes.size() && i < b.bytes.size(); ++i)
-        if (a.bytes[i] != b.bytes[i]) return a.bytes[i] < b.bytes[i] ? -1 : 1;
-    return a.bytes.size() < b.bytes.size() ? -1 : a.bytes.size() == b.bytes.size() ? 0 : 1;
+int Condition::cmpVarchar(const ValueRef& a, const ValueRef& b) {
+    int n = min(a.size, b.size), cmp = n ? memcmp(a.data, b.data, n) : 0;
+    if (cmp) return cmp < 0 ? -1 : 1;
+    return a.size < b.size ? -1 : a.size == b.size ? 0 : 1;
 }
 
-int Condition::cmpIntOrFloat(const Value& a, const Value& b) {
+int Condition::cmpIntOrFloat(const ValueRef& a, const ValueRef& b) {
     if (a.type == INT) {
-        int val_a = *((int*)a.bytes.data());
+        int val_a = a.toInt();
         if (b.type == INT) {
-            int val_b = *((int*)b.bytes.data());
+            int val_b = b.toInt();
             return val_a < val_b ? -1 : val_a == val_b ? 0 : 1;
         }
         else {
-            float val_b = *((float*)b.bytes.data());
+            float val_b = b.toFloat();
             return val_a < val_b ? -1 : val_a == val_b ? 0 : 1;
         }
     }
     else {
-        float val_a = *((float*)a.bytes.data());
+        float val_a = a.toFloat();
         if (b.type == INT) {
-            int val_b = *((int*)b.bytes.data());
+            int val_b = b.toInt();
             return val_a < val_b ? -1 : val_a == val_b ? 0 : 1;
         }
         else {
-            float val_b = *((float*)b.bytes.data());
+            float val_b = b.toFloat();
             return val_a < val_b ? -1 : val_a == val_b ? 0 : 1;
         }
     }
 }
 
-bool Condition::cmpLike(const Value&a, const Value&b) {
-    string s(a.bytes.begin(),a.bytes.end());
-    string m(b.bytes.begin(),b.bytes.end());
+bool Condition::cmpLike(const ValueRef&a, const ValueRef&b) {
+    string s(a.data, a.data + a.size);
+    string m(b.data, b.data + b.size);
     regex sp("[{}()\\[\\].+*?^$\\\\|]");
     string p;
     for (int i = 0; i < m.size(); ++i) {
@@ -56,7 +56,7 @@ bool Condition::cmpLike(const Value&a, const Value&b) {
     return regex_match(s, regex(p));
 }
 
-bool Condition::cmp(const Value& a, const Value& b, CMP_OP op) {
+bool Condition::cmp(const ValueRef& a, const ValueRef& b, CMP_OP op) {
     if (op == IS) return (a.type == NULL_TYPE) ^ (b.type != NULL_TYPE);
     if (a.type == NULL_TYPE || b.type == NULL_TYPE) return false;
     if ((a.type == VARCHAR) ^ (b.type == VARCHAR)) throw DBException("Values to compare should have a same type");
@@ -81,17 +81,24 @@ bool Condition::cmp(const Value& a, const Value& b, CMP_OP op) {
     }
 }
 
-bool Condition::check_in(const Value& a) {
-    for (auto value_list: b_value_lists)
-        for (auto value: value_list) if (cmp(a, value, EQUAL)) return true;
+bool Condition::check_in(const ValueRef& a) const {
+    for (auto& value_list: b_value_lists)
+        for (auto& value: value_list) if (cmp(a, value, EQUAL)) return true;
     return false;
 }
 
+bool Condition::check_code(int code) const {
+    if (code < 0) return false;
+    if (op == IN) return code < b_codes.size() && b_codes[code];
+    if (op == EQUAL) return code == b_code;
+    return b_code != -2 && code != b_code;
+}
+
 void Query::output(fort::char_table& table, const Value& val) {
     if (val.type == NULL_TYPE) table << "";
-    else if (val.type == VARCHAR) table << string(val.bytes.begin(), val.bytes.end());
-    else if (val.type == INT) table << *((int*)val.bytes.data());
-    else table << *((float*)val.bytes.data());
+    else if (val.type == VARCHAR) table << val.toString();
+    else if (val.type == INT) table << val.toInt();
+    else table << val.toFloat();
 }
 
 string Query::to_str() {
@@ -119,7 +126,7 @@ string Query::to_str() {
     }
     else for (auto col: columns) table << col.first + "." + col.second;
     table << fort::endr;
-    for (auto val_list: value_lists) {
+    for (auto& val_list: value_lists) {
         if (!aggregator.ops.empty()) {
             if (!aggregator.group_by.second.empty()) output(table, val_list.back());
             int i = 0;
@@ -133,7 +140,7 @@ string Query::to_str() {
                 else output(table, val_list[i++]);
             }
         }
-        else for (auto val: val_list) output(table, val);
+        else for (auto& val: val_list) output(table, val);
         table << fort::endr;
     }
     return table.to_string();
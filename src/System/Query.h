@@ -27,11 +27,19 @@ struct Condition{
     Value b_val;
     vector<vector<Value>> b_value_lists;
     CMP_OP op;
-    static int cmpVarchar(const Value& a, const Value& b);
-    static int cmpIntOrFloat(const Value& a, const Value& b);
-    static bool cmpLike(const Value& a, const Value& b);
-    static bool cmp(const Value& a, const Value& b, CMP_OP op);
-    bool check_in(const Value& a);
+    // set by DBManager::encode_conditions when a is a dictionary-encoded column compared with constants
+    // by EQUAL, NOT_EQUAL or IN: the code of b_val (-1 if the dictionary lacks it, -2 for NULL),
+    // or for IN whether each code is in the list
+    bool on_codes = false;
+    int b_code;
+    vector<bool> b_codes;
+    // code of a, -1 for NULL
+    bool check_code(int code) const;
+    static int cmpVarchar(const ValueRef& a, const ValueRef& b);
+    static int cmpIntOrFloat(const ValueRef& a, const ValueRef& b);
+    static bool cmpLike(const ValueRef& a, const ValueRef& b);
+    static bool cmp(const ValueRef& a, const ValueRef& b, CMP_OP op);
+    bool check_in(const ValueRef& a) const;
 };
 
 enum Aggregator_OP {
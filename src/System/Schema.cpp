@@ -29,8 +29,8 @@ bool Schema::write(string db_name) {
                 out << "1 ";
             else
                 out << "0 ";
-            out << c.default_value.bytes.size() << " ";
-            for (auto &v : c.default_value.bytes) out << int(v) << " ";
+            out << c.default_value.size() << " ";
+            for (int j = 0; j < c.default_value.size(); j++) out << int(c.default_value.data()[j]) << " ";
         }
     }
     // pk_name
@@ -66,10 +66,26 @@ bool Schema::write(string db_name) {
         out << index.size() << " ";
         for (auto i : index) out << i << " ";
     }
+    out << record_format << " ";
+    // dictionaries: their number, then per dictionary its column, its size and its values as bytes
+    int dictionaries = 0;
+    for (auto &c : columns) dictionaries += c.dictionary != nullptr;
+    out << dictionaries << " ";
+    for (int i = 0; i < columns.size(); i++) {
+        if (!columns[i].dictionary) continue;
+        auto &values = columns[i].dictionary->values;
+        out << i << " " << values.size() << " ";
+        for (auto &value : values) {
+            out << value.size() << " ";
+            for (auto c : value) out << int(uint8_t(c)) << " ";
+        }
+    }
+    out << compressed << " ";
+    out << index_format << " ";
     return true;
 }
 
-Schema::Schema() {}
+Schema::Schema() : index_format(INDEX_FORMAT) {}
 
 Schema::Schema(string table_name, string db_name) {
     ifstream in(string(DB_DIR) + "/" + db_name + "/" + table_name + "/" + table_name + ".schema");
@@ -87,17 +103,15 @@ Schema::Schema(string table_name, string db_name) {
         if (column.has_default) {
             bool is_null;
             in >> is_null;
-            if (is_null)
-                column.default_value.type = NULL_TYPE;
-            else
-                column.default_value.type = column.type;
             int default_value_size;
             in >> default_value_size;
+            vector<uint8_t> bytes;
             for (int j = 0; j < default_value_size; j++) {
                 int v;
                 in >> v;
-                column.default_value.bytes.push_back(uint8_t(v));
+                bytes.push_back(uint8_t(v));
             }
+            column.default_value = Value(is_null ? NULL_TYPE : column.type, bytes.data(), bytes.size());
         }
         this->columns.push_back(column);
     }
@@ -150,6 +164,29 @@ Schema::Schema(string table_name, string db_name) {
             this->indexes[i].push_back(sub_index);
         }
     }
+    if (!(in >> record_format)) record_format = RECORD_FORMAT_V1;
+    // absent in schemas written before dictionaries
+    if (!(in >> size)) size = 0;
+    for (int i = 0; i < size; i++) {
+        int column, values;
+        in >> column >> values;
+        auto dictionary = make_shared<Dictionary>();
+        for (int j = 0; j < values; j++) {
+            int len;
+            in >> len;
+            string value(len, 0);
+            for (auto &c : value) {
+                int v;
+                in >> v;
+                c = char(v);
+            }
+            dictionary->add(value);
+        }
+        this->columns[column].dictionary = dictionary;
+    }
+    if (!(in >> compressed)) compressed = false;
+    // absent in schemas written before index formats were recorded, whose indexes have 32-bit values
+    if (!(in >> index_format)) index_format = INDEX_FORMAT_V1;
 }
 
 string Schema::to_str() {
@@ -165,9 +202,9 @@ string Schema::to_str() {
         table << col.name << col.type_str()
               << (col.not_null ? "YES" : "NO");
         if (col.has_default) {  // if has default
-            if (col.default_value.type == INT) table << *((int *)(&col.default_value.bytes[0]));
-            if (col.default_value.type == FLOAT) table << *((float *)(&col.default_value.bytes[0]));
-            if (col.default_value.type == VARCHAR) table << "'" + string(col.default_value.bytes.begin(), col.default_value.bytes.end()) + "'";
+            if (col.default_value.type == INT) table << col.default_value.toInt();
+            if (col.default_value.type == FLOAT) table << col.default_value.toFloat();
+            if (col.default_value.type == VARCHAR) table << "'" + col.default_value.toString() + "'";
             if (col.default_value.type == NULL_TYPE) table << "NULL";
         } else {
             table << "NO";
@@ -199,6 +236,10 @@ string Schema::to_str() {
         for(auto i : index) ss << i << ", ";
         ss << "),\n";
     }
+    // dictionary
+    for (auto &col : this->columns) {
+        if (col.dictionary) ss << "DICTIONARY (" << col.name << "), " << col.dictionary->values.size() << " values\n";
+    }
     
     return ss.str();
 }
@@ -220,7 +261,7 @@ int Schema::find_fk_by_name(string &name){
 }
 
 RecordType Schema::record_type() const {
-    RecordType res;
+    RecordType res(0, 0, record_format);
     for (auto column : columns) {
         if (column.type == VARCHAR)
             ++res.num_varchar;
@@ -230,6 +271,21 @@ RecordType Schema::record_type() const {
     return res;
 }
 
+vector<int> Schema::field_indexes() const {
+    vector<int> res;
+    int num_int = 0, num_varchar = 0;
+    for (auto& column : columns)
+        res.push_back(column.type == VARCHAR ? num_varchar++ : num_int++);
+    return res;
+}
+
+vector<bool> Schema::key_columns() const {
+    vector<bool> res(columns.size());
+    for (auto& index : get_indexes())
+        for (auto& key : index.second) res[find_column(key)] = true;
+    return res;
+}
+
 vector<pair<string,vector<string>>> Schema::get_indexes() const {
     vector<pair<string,vector<string>>> res;
     if (!pk.pks.empty()) res.push_back(make_pair(table_name + "_pk.index", pk.pks));
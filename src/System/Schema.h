@@ -1,6 +1,11 @@
 #pragma once
 
+#include <cstdint>
+#include <cstring>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 #include "Record.h"
@@ -12,16 +17,109 @@ enum Type { INT,
             FLOAT,
             NULL_TYPE };
 
+// bytes of a VARCHAR Value kept inline, longer ones are allocated
+#define VALUE_INLINE 16
+
+// A tagged value: INT and FLOAT are stored inline, and so are VARCHARs of up to VALUE_INLINE bytes,
+// so that rows of scalars and short strings cost no allocation per value
 struct Value {
     Type type;
-    vector<uint8_t> bytes;
-    Value() {type = NULL_TYPE;}
-    Value(int x) {type = INT; bytes = vector<uint8_t>((uint8_t*)(&x), (uint8_t*)(&x) + 4); }
-    Value(float x) {type = FLOAT; bytes = vector<uint8_t>((uint8_t*)(&x), (uint8_t*)(&x) + 4); }
-    Value(string x) {type = INT; bytes = vector<uint8_t>(x.begin(), x.end());}
-    int toInt() const {return *((int*)bytes.data());}
-    float toFloat() const {return *((float*)bytes.data());}
-    string toString() const {return string(bytes.begin(), bytes.end());}
+    Value():type(NULL_TYPE), _size(0) {}
+    Value(int x):type(INT), _size(4), _int(x) {}
+    Value(float x):type(FLOAT), _size(4), _float(x) {}
+    // a VARCHAR, or the raw bytes of a value of another type
+    Value(Type type, const void* data, int size):type(type), _size(0) {_assign(data, size);}
+    Value(const Value& v):type(v.type), _size(0) {_assign(v.data(), v._size);}
+    Value(Value&& v) noexcept:type(v.type), _size(v._size) {
+        memcpy(_inline, v._inline, VALUE_INLINE);
+        v._size = 0;
+    }
+    Value& operator=(const Value& v) {
+        if (this != &v) {
+            _free();
+            type = v.type;
+            _assign(v.data(), v._size);
+        }
+        return *this;
+    }
+    Value& operator=(Value&& v) noexcept {
+        if (this != &v) {
+            _free();
+            type = v.type;
+            _size = v._size;
+            memcpy(_inline, v._inline, VALUE_INLINE);
+            v._size = 0;
+        }
+        return *this;
+    }
+    ~Value() {_free();}
+    const uint8_t* data() const {return _size > VALUE_INLINE ? _heap : _inline;}
+    int size() const {return _size;}
+    int toInt() const {int x; memcpy(&x, data(), 4); return x;}
+    float toFloat() const {float x; memcpy(&x, data(), 4); return x;}
+    string toString() const {return string((const char*)data(), _size);}
+private:
+    int _size;
+    union {
+        int _int;
+        float _float;
+        uint8_t _inline[VALUE_INLINE];
+        uint8_t* _heap;
+    };
+    void _assign(const void* data, int size) {
+        _size = size;
+        uint8_t* p = size > VALUE_INLINE ? (_heap = new uint8_t[size]) : _inline;
+        if (size) memcpy(p, data, size);
+    }
+    void _free() {
+        if (_size > VALUE_INLINE) delete[] _heap;
+        _size = 0;
+    }
+};
+
+// A value read in place, e.g. from a RecordView; the bytes belong to the page or Value it came from
+struct ValueRef {
+    Type type;
+    const uint8_t* data;
+    int size;
+    ValueRef():type(NULL_TYPE), data(NULL), size(0) {}
+    ValueRef(Type type, const uint8_t* data, int size):type(type), data(data), size(size) {}
+    ValueRef(const Value& v):type(v.type), data(v.data()), size(v.size()) {}
+    int toInt() const {int x; memcpy(&x, data, 4); return x;}
+    float toFloat() const {float x; memcpy(&x, data, 4); return x;}
+    Value value() const {
+        return Value(type, data, size);
+    }
+};
+
+// codes of a dictionary are stored as uint16
+#define DICTIONARY_MAX 65536
+
+// The distinct values of a dictionary-encoded VARCHAR column. Its records store the code of their value,
+// the value's index in values, as the 2 bytes of the varchar
+struct Dictionary {
+    vector<string> values;
+    unordered_map<string, int> codes;
+    // -1 if the value is not in the dictionary
+    int find(string_view value) const {
+        auto it = codes.find(string(value));
+        return it == codes.end() ? -1 : it->second;
+    }
+    // adds the value if it is new
+    int add(const string& value) {
+        auto it = codes.emplace(value, (int)values.size());
+        if (it.second) values.push_back(value);
+        return it.first->second;
+    }
+    static string encode(int code) {
+        uint16_t x = code;
+        return string((const char*)&x, sizeof(x));
+    }
+    static int decode(string_view bytes) {
+        uint16_t x;
+        memcpy(&x, bytes.data(), sizeof(x));
+        return x;
+    }
 };
 
 struct Column {
@@ -33,6 +131,8 @@ struct Column {
     // vector<uint8_t> default_value;  // zero length if no default
 	bool has_default;
 	Value default_value;
+    // NULL unless the column is dictionary-encoded; copies of the schema share it
+    shared_ptr<Dictionary> dictionary;
 	
 	string type_str();
 };
@@ -56,6 +156,12 @@ class Schema {
     PK pk;
     vector<FK> fks;
 	vector<vector<string>> indexes;
+    // RECORD_FORMAT_* of the table's records; tables created before formats were recorded use v1
+    int record_format = RECORD_FORMAT;
+    // files of the table are page-compressed, set by CREATE TABLE ... WITH COMPRESSION
+    bool compressed = false;
+    // INDEX_FORMAT_* of the table's index files, INDEX_FORMAT for new tables; older files are upgraded by USE
+    int index_format;
 
     Schema();
     Schema(string table_name, string db_name);
@@ -64,5 +170,9 @@ class Schema {
     int find_column(string &name) const;
     int find_fk_by_name(string &name);
     RecordType record_type() const;
+    // for each column, its index among the int (INT and FLOAT) or the varchar fields of a Record
+    vector<int> field_indexes() const;
     vector<pair<string,vector<string>>> get_indexes() const;
+    // for each column, whether it is in the primary key, a foreign key or an index
+    vector<bool> key_columns() const;
 };
@@ -6,12 +6,25 @@
 #include <string>
 
 #include "DBManager.h"
+#include "FileSystem.h"
 #include "antlr4-runtime.h"
 #include "parse.h"
 
 using namespace std;
 
-int main() {
+int main(int argc, char* argv[]) {
+    // startup options: --key=value, e.g. --replace=clock
+    for (int i = 1; i < argc; ++i) {
+        string arg(argv[i]);
+        size_t eq = arg.find('=');
+        if (!arg.starts_with("--") || eq == string::npos ||
+            !FileSystem::setOption(arg.substr(2, eq - 2), arg.substr(eq + 1))) {
+            cerr << "Invalid option: " << arg << endl;
+            cerr << "Usage: " << argv[0] << " [--buffer_pool_size=<bytes>[K|M|G]] [--db_buffer_pool_size=<db>:<bytes>[K|M|G]] [--replace=lru|clock|lru2|2q] [--flusher=on|off] [--io=uring|threads|sync] [--readahead=on|off] [--hugepages=on|off] [--direct=on|off] [--compressed_cache=<bytes>[K|M|G]] [--warmup=on|off] [--warmup_interval=<seconds>] [--autovacuum=on|off]" << endl;
+            return 1;
+        }
+    }
+
     cout << R""""(
     __  ___                                ____  ____ 
    /  |/  /__  ____________  _________  __/ __ \/ __ )
@@ -0,0 +1,71 @@
+/*
+ * benchBufPageManager.cpp
+ * 多线程getPage/markDirty吞吐量测试，比较不同分片数的缓存在1到N个线程下的扩展性
+ * 编译: g++ -O2 -std=c++20 -Isrc -Isrc/FileSystem test/benchBufPageManager.cpp src/FileSystem/utils/MyBitMap.cpp -pthread
+ * 运行: ./a.out [线程数上限]
+ */
+#include "FileSystem/bufmanager/BufPageManager.h"
+#include "FileSystem/fileio/FileManager.h"
+#include "FileSystem/utils/pagedef.h"
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+const int PAGE_NUM = 4096;
+const int OPS = 2000000;
+
+double run(BufPageManager* bpm, int fileID, int threadNum) {
+	vector<thread> threads;
+	auto start = chrono::steady_clock::now();
+	for (int t = 0; t < threadNum; ++t) {
+		threads.emplace_back([=]() {
+			mt19937 rng(t);
+			int ops = OPS / threadNum;
+			for (int i = 0; i < ops; ++i) {
+				int index;
+				BufType b = bpm->getPage(fileID, rng() % PAGE_NUM, index);
+				if ((i & 7) == 0) {
+					bpm->markDirty(index);
+				} else if (b[0] == 0xFFFFFFFF) {
+					cout << "?";
+				}
+			}
+		});
+	}
+	for (auto& th : threads) th.join();
+	double sec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	return OPS / sec / 1e6;
+}
+
+int main(int argc, char** argv) {
+	int maxThread = argc > 1 ? atoi(argv[1]) : thread::hardware_concurrency();
+	FileManager* fm = new FileManager();
+	fm->createFile("bench.data");
+	int fileID;
+	fm->openFile("bench.data", fileID);
+	{
+		BufPageManager bpm(fm);
+		for (int pageID = 0; pageID < PAGE_NUM; ++pageID) {
+			int index;
+			BufType b = bpm.allocPage(fileID, pageID, index, false);
+			b[0] = pageID;
+			bpm.markDirty(index);
+		}
+		bpm.close();
+	}
+	cout << "threads\tshards=1 (Mops/s)\tshards=" << BUF_SHARD_NUM << " (Mops/s)" << endl;
+	for (int t = 1; t <= maxThread; t <<= 1) {
+		BufPageManager single(fm, CAP, 1), sharded(fm);
+		run(&single, fileID, t);
+		run(&sharded, fileID, t);
+		double a = run(&single, fileID, t);
+		double b = run(&sharded, fileID, t);
+		cout << t << "\t" << a << "\t\t\t" << b << endl;
+	}
+	remove("bench.data");
+	return 0;
+}
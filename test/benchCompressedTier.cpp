@@ -0,0 +1,84 @@
+/*
+ * benchCompressedTier.cpp
+ * 工作集比缓存稍大时随机读页面，比较有无压缩缓存时的耗时和读磁盘的次数，同时检查页面内容
+ * 页面内容是容易压缩的类似记录的数据，读文件用O_DIRECT，避免操作系统的缓存掩盖差别
+ * 编译: g++ -O2 -std=c++20 -Isrc -Isrc/FileSystem test/benchCompressedTier.cpp src/FileSystem/utils/MyBitMap.cpp -pthread
+ * 运行: ./a.out
+ */
+#include "FileSystem/bufmanager/BufPageManager.h"
+#include "FileSystem/fileio/FileManager.h"
+#include "FileSystem/utils/pagedef.h"
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+
+using namespace std;
+
+const int BUF_PAGES = 1024;
+const int FILE_PAGES = BUF_PAGES * 5 / 4;
+const int READS = 200000;
+
+void fill(BufType b, int p) {
+	char* c = (char*)b;
+	for (int i = 0; i < PAGE_SIZE; i += 32) {
+		snprintf(c + i, 32, "page %06d row %04d name_%03d", p, i / 32, (p + i / 32) % 1000);
+	}
+	b[0] = p;
+}
+
+void run(const char* name, long long tierBytes) {
+	FileManager* fm = new FileManager();
+	fm->setDirect(true);
+	int fileID;
+	fm->openFile(name, fileID);
+	fm->advise(fileID, 0, 0, POSIX_FADV_DONTNEED);
+	BufConfig config(BUF_PAGES, BUF_SHARD_NUM, LRU_REPLACE);
+	config.flusher = false;
+	config.readAhead = false;
+	config.warmup = false;
+	config.tierBytes = tierBytes;
+	BufPageManager* bpm = new BufPageManager(fm, config);
+	mt19937 rng(1);
+	int wrong = 0;
+	auto start = chrono::steady_clock::now();
+	for (int i = 0; i < READS; ++i) {
+		int p = rng() % FILE_PAGES;
+		PageGuard guard = bpm->getPageGuard(fileID, p);
+		wrong += guard.get()[0] != (unsigned)p || guard.get()[PAGE_INT_NUM - 8] != 0;
+	}
+	double sec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	long long hits, misses, tierHits, tierMisses, pages, bytes;
+	bpm->getStats(hits, misses);
+	bpm->getTierStats(tierHits, tierMisses, pages, bytes);
+	printf("tier %5lld KB  %.3fs  misses %lld  tier hits %lld  disk reads %lld  tier pages %lld (%lld KB)  wrong %d\n",
+		tierBytes >> 10, sec, misses, tierHits, tierBytes ? tierMisses : misses, pages, bytes >> 10, wrong);
+	bpm->close();
+	delete bpm;
+	fm->closeFile(fileID);
+	delete fm;
+}
+
+int main() {
+	MyBitMap::initConst();
+	const char* name = "benchCompressedTier.tmp";
+	remove(name);
+	FileManager* fm = new FileManager();
+	fm->createFile(name);
+	int fileID;
+	fm->openFile(name, fileID);
+	BufType b = new unsigned int[PAGE_INT_NUM];
+	for (int p = 0; p < FILE_PAGES; ++p) {
+		fill(b, p);
+		b[PAGE_INT_NUM - 8] = 0;
+		fm->writePage(fileID, p, b, 0);
+	}
+	delete[] b;
+	fm->closeFile(fileID);
+	delete fm;
+	run(name, 0);
+	run(name, (long long)BUF_PAGES / 8 * PAGE_SIZE);
+	run(name, (long long)BUF_PAGES / 2 * PAGE_SIZE);
+	remove(name);
+	return 0;
+}
@@ -0,0 +1,77 @@
+/*
+ * benchDirectIO.cpp
+ * 比较普通读写和O_DIRECT读写时，缓存比文件小的情况下反复扫描文件的耗时
+ * 同时输出缓存页面区实际使用的内存类型
+ * 编译: g++ -O2 -std=c++20 -Isrc -Isrc/FileSystem test/benchDirectIO.cpp src/FileSystem/utils/MyBitMap.cpp -pthread
+ * 运行: ./a.out
+ */
+#include "FileSystem/bufmanager/BufPageManager.h"
+#include "FileSystem/fileio/FileManager.h"
+#include "FileSystem/utils/pagedef.h"
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+
+using namespace std;
+
+const int BUF_PAGES = 1024;
+const int FILE_PAGES = 8192;
+const int SCANS = 3;
+
+void run(const char* name, bool direct, bool huge) {
+	FileManager* fm = new FileManager();
+	fm->setDirect(direct);
+	int fileID;
+	fm->openFile(name, fileID);
+	fm->advise(fileID, 0, 0, POSIX_FADV_DONTNEED);
+	BufConfig config(BUF_PAGES, 1, LRU_REPLACE);
+	config.flusher = false;
+	config.hugePages = huge;
+	// 缓存大小固定，有预留的大页时用MAP_HUGETLB
+	config.maxCapacity = BUF_PAGES;
+	BufPageManager* bpm = new BufPageManager(fm, config);
+	int wrong = 0;
+	auto start = chrono::steady_clock::now();
+	for (int r = 0; r < SCANS; ++r) {
+		for (int p = 0; p < FILE_PAGES; ++p) {
+			PageGuard guard = bpm->getPageGuard(fileID, p);
+			wrong += guard.get()[0] != (unsigned)p;
+			// 每一轮都改写一部分页面，替换时需要写回
+			if (p % 8 == 0) {
+				guard.get()[1] = r;
+				guard.markDirty();
+			}
+		}
+	}
+	bpm->close();
+	double sec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	printf("direct %-3s (%s)  arena %-22s %.3fs  wrong %d\n", direct ? "on" : "off",
+		fm->getDirect(fileID) ? "O_DIRECT" : "page cache", arenaKindName(bpm->arena->getKind()), sec, wrong);
+	delete bpm;
+	fm->closeFile(fileID);
+	delete fm;
+}
+
+int main() {
+	MyBitMap::initConst();
+	const char* name = "benchDirectIO.tmp";
+	remove(name);
+	FileManager* fm = new FileManager();
+	fm->createFile(name);
+	int fileID;
+	fm->openFile(name, fileID);
+	BufType b = new unsigned int[PAGE_INT_NUM]();
+	for (int p = 0; p < FILE_PAGES; ++p) {
+		b[0] = p;
+		fm->writePage(fileID, p, b, 0);
+	}
+	delete[] b;
+	fm->closeFile(fileID);
+	delete fm;
+	sync();
+	run(name, false, false);
+	run(name, false, true);
+	run(name, true, true);
+	remove(name);
+	return 0;
+}
@@ -0,0 +1,96 @@
+/*
+ * benchMmap.cpp
+ * 比较通过缓存(复制到缓存页面)和通过内存映射读取页面的耗时，文件比缓存大
+ * 负载为若干次全表扫描和随机点查
+ * 编译: g++ -O2 -std=c++20 -Isrc -Isrc/FileSystem test/benchMmap.cpp src/FileSystem/utils/MyBitMap.cpp -pthread
+ * 运行: ./a.out
+ */
+#include "FileSystem/bufmanager/BufPageManager.h"
+#include "FileSystem/fileio/FileManager.h"
+#include "FileSystem/utils/pagedef.h"
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+
+using namespace std;
+
+const int BUF_PAGES = 1024;
+const int FILE_PAGES = 8192;
+const int SCANS = 5;
+const int LOOKUPS = 200000;
+
+void run(bool mapped) {
+	const char* dir = "benchMmap.dir/";
+	const char* name = "benchMmap.dir/data";
+	FileManager* fm = new FileManager();
+	fm->setMapped(dir, mapped);
+	int fileID;
+	fm->openFile(name, fileID);
+	BufConfig config(BUF_PAGES, BUF_SHARD_NUM, LRU_REPLACE);
+	config.flusher = false;
+	config.readAhead = false;
+	BufPageManager* bpm = new BufPageManager(fm, config);
+	mt19937 rng(0);
+	unsigned sum = 0;
+	int wrong = 0;
+	auto start = chrono::steady_clock::now();
+	for (int r = 0; r < SCANS; ++r) {
+		for (int p = 0; p < FILE_PAGES; ++p) {
+			PageGuard guard = bpm->getPageGuard(fileID, p);
+			wrong += guard.get()[0] != (unsigned)p;
+			sum += guard.get()[PAGE_INT_NUM - 1];
+		}
+	}
+	double scanSec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	start = chrono::steady_clock::now();
+	for (int i = 0; i < LOOKUPS; ++i) {
+		int p = rng() % FILE_PAGES;
+		PageGuard guard = bpm->getPageGuard(fileID, p);
+		wrong += guard.get()[0] != (unsigned)p;
+	}
+	double lookupSec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	// 修改一个页面，检查flush之后文件中的内容
+	PageGuard guard = bpm->getPageGuard(fileID, 7);
+	guard.get()[1] = 12345;
+	guard.markDirty();
+	guard.release();
+	bpm->flush();
+	BufType b = new unsigned int[PAGE_INT_NUM];
+	fm->readPage(fileID, 7, b, 0);
+	wrong += b[1] != 12345;
+	b[1] = 0;
+	fm->writePage(fileID, 7, b, 0);
+	delete[] b;
+	long long hits, misses, accesses, syncs;
+	bpm->getStats(hits, misses);
+	bpm->getMapStats(accesses, syncs);
+	printf("%-7s scan %.3fs  lookup %.3fs  misses %7lld  mapped %7lld  msync %lld  wrong %d  (%u)\n",
+		mapped ? "mmap" : "buffer", scanSec, lookupSec, misses, accesses, syncs, wrong, sum & 1);
+	delete bpm;
+	fm->closeFile(fileID);
+	delete fm;
+}
+
+int main() {
+	MyBitMap::initConst();
+	mkdir("benchMmap.dir", 0755);
+	const char* name = "benchMmap.dir/data";
+	FileManager* fm = new FileManager();
+	fm->createFile(name);
+	int fileID;
+	fm->openFile(name, fileID);
+	BufType b = new unsigned int[PAGE_INT_NUM]();
+	for (int p = 0; p < FILE_PAGES; ++p) {
+		b[0] = p;
+		fm->writePage(fileID, p, b, 0);
+	}
+	delete[] b;
+	fm->closeFile(fileID);
+	delete fm;
+	run(false);
+	run(true);
+	remove(name);
+	rmdir("benchMmap.dir");
+	return 0;
+}
@@ -0,0 +1,139 @@
+/*
+ * benchPageTable.cpp
+ * 比较原来的链式hash表MyHashMap((k1+k2)%MOD)和开放定址的PageTable的查找耗时，
+ * 以及缓存管理器中getPage命中时的平均耗时
+ * 键取自许多个小文件(索引文件)和几个大文件，与数据库中的情况相近
+ * 编译: g++ -O2 -std=c++20 -Isrc -Isrc/FileSystem test/benchPageTable.cpp src/FileSystem/utils/MyBitMap.cpp -pthread
+ * 运行: ./a.out
+ */
+#include "FileSystem/bufmanager/BufPageManager.h"
+#include "FileSystem/fileio/FileManager.h"
+#include "FileSystem/utils/MyHashMap.h"
+#include "FileSystem/utils/PageTable.h"
+#include "FileSystem/utils/pagedef.h"
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+const int ENTRIES = 60000;
+const int LOOKUPS = 5000000;
+
+vector<pair<int, int>> makeKeys() {
+	vector<pair<int, int>> keys;
+	// 400个文件各100页，再加4个文件各5000页
+	for (int f = 0; f < 400; ++f) {
+		for (int p = 0; p < 100; ++p) {
+			keys.push_back(make_pair(f, p));
+		}
+	}
+	for (int f = 400; f < 404; ++f) {
+		for (int p = 0; p < 5000; ++p) {
+			keys.push_back(make_pair(f, p));
+		}
+	}
+	return keys;
+}
+
+template <typename Table>
+void run(const char* name, Table* t, const vector<pair<int, int>>& keys) {
+	for (int i = 0; i < ENTRIES; ++i) {
+		t->replace(i, keys[i].first, keys[i].second);
+	}
+	mt19937 rng(0);
+	vector<int> order(LOOKUPS);
+	for (int& x : order) {
+		x = rng() % ENTRIES;
+	}
+	long long check = 0;
+	auto start = chrono::steady_clock::now();
+	for (int x : order) {
+		check += t->findIndex(keys[x].first, keys[x].second);
+	}
+	double hitNs = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / LOOKUPS;
+	start = chrono::steady_clock::now();
+	for (int x : order) {
+		check += t->findIndex(keys[x].first + 1000, keys[x].second);
+	}
+	double missNs = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / LOOKUPS;
+	// 替换：不断把页面换成新的键
+	start = chrono::steady_clock::now();
+	for (int i = 0; i < LOOKUPS; ++i) {
+		int v = order[i];
+		t->replace(v, 2000 + i % 64, i);
+	}
+	double replaceNs = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / LOOKUPS;
+	printf("%-10s hit %6.1f ns  miss %6.1f ns  replace %6.1f ns  (%lld)\n", name, hitNs, missNs, replaceNs, check & 1);
+}
+
+void runGetPage(FileManager* fm, const vector<int>& fileIDs) {
+	BufConfig config(ENTRIES, BUF_SHARD_NUM, LRU_REPLACE);
+	config.flusher = false;
+	config.readAhead = false;
+	BufPageManager* bpm = new BufPageManager(fm, config);
+	vector<pair<int, int>> keys;
+	for (int f : fileIDs) {
+		for (int p = 0; p < 16; ++p) {
+			keys.push_back(make_pair(f, p));
+			int index;
+			bpm->allocPage(f, p, index);
+		}
+	}
+	mt19937 rng(0);
+	vector<int> order(LOOKUPS);
+	for (int& x : order) {
+		x = rng() % keys.size();
+	}
+	long long check = 0;
+	auto start = chrono::steady_clock::now();
+	for (int x : order) {
+		int index;
+		check += (long long)bpm->getPage(keys[x].first, keys[x].second, index)[0] + index;
+	}
+	double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / LOOKUPS;
+	long long hits, misses;
+	bpm->getStats(hits, misses);
+	printf("getPage hit %.1f ns  (hits %lld misses %lld)  (%lld)\n", ns, hits, misses, check & 1);
+	for (int f : fileIDs) {
+		for (int p = 0; p < 16; ++p) {
+			int index;
+			bpm->getPage(f, p, index);
+			bpm->release(index);
+		}
+	}
+	delete bpm;
+}
+
+int main() {
+	MyBitMap::initConst();
+	vector<pair<int, int>> keys = makeKeys();
+	MyHashMap* chained = new MyHashMap(ENTRIES, ENTRIES);
+	run("MyHashMap", chained, keys);
+	delete chained;
+	PageTable* table = new PageTable(ENTRIES);
+	run("PageTable", table, keys);
+	delete table;
+	// getPage：1000个文件各16页，全部在缓存中
+	FileManager* fm = new FileManager();
+	vector<int> fileIDs;
+	char name[64];
+	for (int i = 0; i < 1000; ++i) {
+		snprintf(name, sizeof(name), "benchPageTable.%d.tmp", i);
+		fm->createFile(name);
+		int fileID;
+		fm->openFile(name, fileID);
+		fileIDs.push_back(fileID);
+	}
+	runGetPage(fm, fileIDs);
+	for (int i = 0; i < 1000; ++i) {
+		fm->closeFile(fileIDs[i]);
+		snprintf(name, sizeof(name), "benchPageTable.%d.tmp", i);
+		remove(name);
+	}
+	delete fm;
+	return 0;
+}
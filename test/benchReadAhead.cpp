@@ -0,0 +1,79 @@
+/*
+ * benchReadAhead.cpp
+ * 清空操作系统的页缓存后顺序扫描整个文件，比较开启和关闭预读时的耗时
+ * 同时检查读到的页面内容是否正确
+ * 编译: g++ -O2 -std=c++20 -Isrc -Isrc/FileSystem test/benchReadAhead.cpp src/FileSystem/utils/MyBitMap.cpp -pthread
+ * 运行: ./a.out
+ */
+#include "FileSystem/bufmanager/BufPageManager.h"
+#include "FileSystem/fileio/FileManager.h"
+#include "FileSystem/utils/pagedef.h"
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <unistd.h>
+
+using namespace std;
+
+const int BUF_PAGES = 1024;
+const int SCAN_PAGES = 8192;
+// 每个页面上模拟的计算量
+const int WORK = 4;
+
+void run(FileManager* fm, int fileID, bool readAhead, bool useRing) {
+	// 从磁盘读，而不是从页缓存读
+	fm->advise(fileID, 0, 0, POSIX_FADV_DONTNEED);
+	BufConfig config(BUF_PAGES, 1, LRU_REPLACE);
+	config.flusher = false;
+	config.readAhead = readAhead;
+	BufPageManager* bpm = new BufPageManager(fm, config);
+	BufRing* ring = bpm->newRing();
+	auto start = chrono::steady_clock::now();
+	int wrong = 0;
+	unsigned sum = 0;
+	for (int p = 0; p < SCAN_PAGES; ++p) {
+		PageGuard guard = useRing ? bpm->getPageGuard(fileID, p, ring) : bpm->getPageGuard(fileID, p);
+		BufType b = guard.get();
+		if (b[0] != (unsigned)p) {
+			++wrong;
+		}
+		for (int w = 0; w < WORK; ++w) {
+			for (int i = 0; i < PAGE_INT_NUM; ++i) {
+				sum += b[i] * (w + 1);
+			}
+		}
+	}
+	double sec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	long long hits, misses, pages, waits;
+	bpm->getStats(hits, misses);
+	bpm->getPrefetchStats(pages, waits);
+	printf("readahead %-3s%-6s %.3fs  misses %6lld  prefetched %6lld  waits %6lld  wrong %d  (%u)\n",
+		readAhead ? "on" : "off", useRing ? "+ring" : "", sec, misses, pages, waits, wrong, sum & 1);
+	delete ring;
+	delete bpm;
+}
+
+int main() {
+	MyBitMap::initConst();
+	FileManager* fm = new FileManager();
+	const char* name = "benchReadAhead.tmp";
+	remove(name);
+	fm->createFile(name);
+	int fileID;
+	fm->openFile(name, fileID);
+	BufType b = new unsigned int[PAGE_INT_NUM]();
+	for (int p = 0; p < SCAN_PAGES; ++p) {
+		b[0] = p;
+		fm->writePage(fileID, p, b, 0);
+	}
+	delete[] b;
+	sync();
+	for (bool useRing : {false, true}) {
+		run(fm, fileID, false, useRing);
+		run(fm, fileID, true, useRing);
+	}
+	fm->closeFile(fileID);
+	remove(name);
+	delete fm;
+	return 0;
+}
@@ -0,0 +1,73 @@
+/*
+ * benchReplace.cpp
+ * 比较不同替换算法在“热点点查 + 大表顺序扫描”混合负载下的命中率和耗时
+ * 以及扫描使用环形缓存(BufRing)时的效果
+ * 编译: g++ -O2 -std=c++20 -Isrc -Isrc/FileSystem test/benchReplace.cpp src/FileSystem/utils/MyBitMap.cpp -pthread
+ * 运行: ./a.out
+ */
+#include "FileSystem/bufmanager/BufPageManager.h"
+#include "FileSystem/fileio/FileManager.h"
+#include "FileSystem/utils/pagedef.h"
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+
+using namespace std;
+
+const int BUF_PAGES = 1024;
+const int HOT_PAGES = 768;
+const int SCAN_PAGES = 8192;
+const int ROUNDS = 20;
+const int LOOKUPS = 20000;
+
+void run(FileManager* fm, int fileID, ReplacePolicy policy, bool useRing) {
+	BufPageManager* bpm = new BufPageManager(fm, BUF_PAGES, 1, policy);
+	BufRing* ring = bpm->newRing();
+	mt19937 rng(0);
+	auto start = chrono::steady_clock::now();
+	for (int r = 0; r < ROUNDS; ++r) {
+		// 热点页面[0, HOT_PAGES)上的随机点查
+		for (int i = 0; i < LOOKUPS; ++i) {
+			int index;
+			bpm->getPage(fileID, rng() % HOT_PAGES, index);
+		}
+		// 一次全表扫描，每个页面只访问一次
+		for (int p = 0; p < SCAN_PAGES; ++p) {
+			if (useRing) {
+				PageGuard guard = bpm->getPageGuard(fileID, HOT_PAGES + p, ring);
+			} else {
+				int index;
+				bpm->getPage(fileID, HOT_PAGES + p, index);
+			}
+		}
+	}
+	double sec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	long long hits, misses;
+	bpm->getStats(hits, misses);
+	printf("%-6s%-6s hit ratio %6.2f%%  misses %8lld  %.3fs\n", replacePolicyName(policy),
+		useRing ? "+ring" : "", 100.0 * hits / (hits + misses), misses, sec);
+	delete ring;
+	delete bpm;
+}
+
+int main() {
+	FileManager* fm = new FileManager();
+	const char* name = "benchReplace.tmp";
+	fm->createFile(name);
+	int fileID;
+	fm->openFile(name, fileID);
+	BufType b = new unsigned int[PAGE_INT_NUM]();
+	for (int p = 0; p < HOT_PAGES + SCAN_PAGES; ++p) {
+		fm->writePage(fileID, p, b, 0);
+	}
+	delete[] b;
+	for (ReplacePolicy policy : {LRU_REPLACE, CLOCK_REPLACE, LRU2_REPLACE, TWO_Q_REPLACE}) {
+		run(fm, fileID, policy, false);
+	}
+	run(fm, fileID, LRU_REPLACE, true);
+	fm->closeFile(fileID);
+	remove(name);
+	delete fm;
+	return 0;
+}
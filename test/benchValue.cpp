@@ -0,0 +1,66 @@
+/*
+ * benchValue.cpp
+ * 用Query收集一个有整数、浮点数和长短不一的字符串的结果集，再对同样的行做分组聚合，
+ * 输出两者每秒处理的行数和进程的内存峰值，用来比较Value的不同表示
+ * 编译: gcc -O2 -c third-party/libfort/lib/fort.c -o fort.o && g++ -O2 -std=c++20 -Isrc -Isrc/FileSystem -Isrc/Record -Isrc/Index -Isrc/System -Ithird-party/libfort/lib test/benchValue.cpp src/System/Query.cpp fort.o -pthread
+ * 运行: ./a.out [行数]
+ */
+#include "Query.h"
+#include <sys/resource.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+using namespace std;
+
+double seconds(chrono::steady_clock::time_point start) {
+	return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+long peakRSS() {
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss;
+}
+
+int main(int argc, char* argv[]) {
+	int rows = argc > 1 ? atoi(argv[1]) : 2000000;
+	mt19937 rng(1);
+	const char* names[] = {"alpha", "beta", "gamma", "delta", "alpha beta gamma delta"};
+
+	// 结果集：(id, v, f, name)
+	Query result;
+	result.columns = {{"t", "id"}, {"t", "v"}, {"t", "f"}, {"t", "name"}};
+	auto start = chrono::steady_clock::now();
+	for (int i = 0; i < rows; ++i) {
+		const char* name = names[rng() % 5];
+		vector<Value> row;
+		row.push_back(Value(i));
+		row.push_back(Value((int)(rng() % 1000)));
+		row.push_back(Value((float)(rng() % 10000) / 100));
+		row.push_back(ValueRef(VARCHAR, (const uint8_t*)name, strlen(name)).value());
+		result += row;
+	}
+	double scan = seconds(start);
+	long scanRSS = peakRSS();
+
+	// COUNT(*), SUM(v), AVG(f), MAX(name) GROUP BY v % 100
+	Query agg;
+	agg.columns = {{"t", "v"}, {"t", "f"}, {"t", "name"}};
+	agg.aggregator.ops = {CNT_, SUM, AVG, MAX};
+	agg.aggregator.group_by = {"t", "g"};
+	start = chrono::steady_clock::now();
+	for (auto& r : result.value_lists) {
+		vector<Value> row = {r[1], r[2], r[3], Value(r[1].toInt() % 100)};
+		agg += row;
+	}
+	double aggregate = seconds(start);
+
+	long long count = 0;
+	for (auto& g : agg.value_lists) count += g[0].toInt();
+	printf("%d rows  collect %.0f rows/s  aggregate %.0f rows/s  %d groups\n",
+		rows, rows / scan, rows / aggregate, (int)agg.value_lists.size());
+	printf("peak RSS after collecting %ld KB\n", scanRSS);
+	return count == rows ? 0 : 1;
+}
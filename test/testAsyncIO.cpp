@@ -0,0 +1,90 @@
+/*
+ * testAsyncIO.cpp
+ * 分别用io_uring和线程池批量写入、读回页面，检查内容是否一致
+ * 编译: g++ -O2 -std=c++20 -Isrc -Isrc/FileSystem test/testAsyncIO.cpp src/FileSystem/utils/MyBitMap.cpp -pthread
+ */
+#include "FileSystem/fileio/AsyncIO.h"
+#include "FileSystem/fileio/FileManager.h"
+#include "FileSystem/utils/pagedef.h"
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+const int PAGE_NUM = 1000;
+// 每个请求包含的连续页面数
+const int RUN = 8;
+
+bool test(IOBackend backend) {
+	FileManager* fm = new FileManager();
+	const char* name = "testAsyncIO.tmp";
+	remove(name);
+	fm->createFile(name);
+	int fileID;
+	fm->openFile(name, fileID);
+	AsyncIO* aio = AsyncIO::create(backend, AIO_DEPTH, AIO_WORKERS);
+	vector<BufType> pages(PAGE_NUM);
+	vector<struct iovec> iov(PAGE_NUM);
+	vector<IORequest> reqs(PAGE_NUM / RUN);
+	vector<IORequest*> ptrs;
+	for (int i = 0; i < PAGE_NUM; ++i) {
+		pages[i] = new unsigned int[PAGE_INT_NUM];
+		for (int j = 0; j < PAGE_INT_NUM; ++j) {
+			pages[i][j] = i * 7 + j;
+		}
+		iov[i].iov_base = pages[i];
+		iov[i].iov_len = PAGE_SIZE;
+	}
+	// 写
+	for (int k = 0; k < PAGE_NUM / RUN; ++k) {
+		fm->pageRequest(reqs[k], fileID, k * RUN, &iov[k * RUN], RUN, true);
+		ptrs.push_back(&reqs[k]);
+	}
+	aio->submit(ptrs.data(), ptrs.size());
+	int failed = aio->wait();
+	// 读
+	for (int i = 0; i < PAGE_NUM; ++i) {
+		for (int j = 0; j < PAGE_INT_NUM; ++j) {
+			pages[i][j] = 0;
+		}
+	}
+	for (int k = 0; k < PAGE_NUM / RUN; ++k) {
+		fm->pageRequest(reqs[k], fileID, k * RUN, &iov[k * RUN], RUN, false);
+	}
+	aio->submit(ptrs.data(), ptrs.size());
+	IORequest* done[16];
+	int completed = 0;
+	while (aio->pending() > 0) {
+		int n = aio->complete(done, 16, 1);
+		for (int i = 0; i < n; ++i) {
+			if (done[i]->result != RUN * PAGE_SIZE) {
+				++failed;
+			}
+		}
+		completed += n;
+	}
+	int wrong = 0;
+	for (int i = 0; i < PAGE_NUM; ++i) {
+		for (int j = 0; j < PAGE_INT_NUM; ++j) {
+			if (pages[i][j] != (unsigned)(i * 7 + j)) {
+				++wrong;
+			}
+		}
+		delete[] pages[i];
+	}
+	cout << ioBackendName(aio->backend()) << ": completed " << completed << " failed " << failed
+		<< " wrong " << wrong << endl;
+	delete aio;
+	fm->closeFile(fileID);
+	remove(name);
+	delete fm;
+	return completed == PAGE_NUM / RUN && failed == 0 && wrong == 0;
+}
+
+int main() {
+	MyBitMap::initConst();
+	bool ok = test(URING_IO) & test(THREAD_IO);
+	cout << (ok ? "ok" : "FAILED") << endl;
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,14 @@
+/*
+ * testCheck.h
+ * 测试程序共用的检查：不成立时输出检查的内容，返回失败的个数，由调用者累加
+ */
+#pragma once
+
+#include <cstdio>
+
+int check(bool ok, const char* what) {
+	if (!ok) {
+		printf("failed: %s\n", what);
+	}
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,119 @@
+/*
+ * testCompressedFile.cpp
+ * 在压缩的目录下新建文件，通过缓存写入压缩率不同的页面(有的不能压缩)，用很小的缓存让页面反复写回；
+ * 再改写一部分页面使压缩后变长、变短，检查写回磁盘后读出的内容不变、占用的空间小于原来；
+ * 截断后重新打开，检查页数、内容，截掉的页面读出来是0，目录外的文件仍然不压缩
+ * 编译: g++ -O2 -std=c++20 -Isrc -Isrc/FileSystem test/testCompressedFile.cpp src/FileSystem/utils/MyBitMap.cpp -pthread
+ * 运行: ./a.out
+ */
+#include "FileSystem/bufmanager/BufPageManager.h"
+#include "FileSystem/fileio/FileManager.h"
+#include "FileSystem/utils/pagedef.h"
+#include "testCheck.h"
+#include <cstdio>
+#include <filesystem>
+#include <random>
+
+using namespace std;
+
+const char* DIR_NAME = "testCompressedFile/";
+const char* NAME = "testCompressedFile/t.data";
+const char* RAW_NAME = "testCompressedFile.tmp";
+const int PAGES = 2000;
+const int KEPT = 1200;
+
+// 第p页第version版的内容：每4页有一页是随机字节，其他的是长短不一的重复文本，其余部分为0
+void makePage(int p, int version, unsigned* page) {
+	mt19937 rng(p * 7 + version);
+	unsigned char* b = (unsigned char*)page;
+	memset(b, 0, PAGE_SIZE);
+	int len = (p + version) % 4 == 0 ? PAGE_SIZE : (int)(rng() % PAGE_SIZE);
+	for (int i = 0; i < len; ++i) {
+		b[i] = (p + version) % 4 == 0 ? (unsigned char)rng() : "row status open closed "[(i + p) % 23];
+	}
+	page[0] = p;
+	page[1] = version;
+}
+
+int verify(BufPageManager* bpm, int fileID, int pages, const vector<int>& versions) {
+	unsigned expect[PAGE_INT_NUM];
+	int wrong = 0;
+	for (int p = 0; p < pages; ++p) {
+		PageGuard guard = bpm->getPageGuard(fileID, p);
+		makePage(p, versions[p], expect);
+		wrong += memcmp(guard.get(), expect, PAGE_SIZE) != 0;
+	}
+	return wrong;
+}
+
+int main() {
+	MyBitMap::initConst();
+	filesystem::remove_all(DIR_NAME);
+	filesystem::create_directory(DIR_NAME);
+	remove(RAW_NAME);
+	FileManager* fm = new FileManager();
+	fm->setCompressed(DIR_NAME, true);
+	BufConfig config(64, 4, LRU_REPLACE);
+	config.warmup = false;
+	BufPageManager* bpm = new BufPageManager(fm, config);
+	int failed = 0;
+
+	int fileID, rawID;
+	fm->createFile(NAME);
+	fm->createFile(RAW_NAME);
+	fm->openFile(NAME, fileID);
+	fm->openFile(RAW_NAME, rawID);
+	failed += check(fm->isCompressed(fileID) && !fm->isCompressed(rawID), "only files in the directory are compressed");
+
+	vector<int> versions(PAGES, 0);
+	for (int p = 0; p < PAGES; ++p) {
+		PageGuard guard = bpm->allocPageGuard(fileID, p);
+		makePage(p, 0, guard.get());
+		guard.markDirty();
+	}
+	// 改写每3页中的一页，压缩后的长度改变，放不下时换到别的区段
+	for (int p = 0; p < PAGES; p += 3) {
+		PageGuard guard = bpm->getPageGuard(fileID, p);
+		versions[p] = 1 + p % 5;
+		makePage(p, versions[p], guard.get());
+		guard.markDirty();
+	}
+	bpm->invalidateFile(fileID, true);
+	failed += check(fm->getPageNum(fileID) == PAGES, "page count");
+	failed += check(verify(bpm, fileID, PAGES, versions) == 0, "pages read back");
+
+	long long pages, stored, bytes;
+	fm->getZipSize(fileID, pages, stored, bytes);
+	const ZipStats& stats = fm->getZipStats();
+	printf("%lld pages of %d KB stored in %lld KB (ratio %.2f), file %lld KB; %.2f us to compress, %.2f us to decompress a page\n",
+		pages, PAGE_SIZE >> 10, stored >> 10, (double)pages * PAGE_SIZE / stored, bytes >> 10,
+		stats.compressNs / 1000.0 / stats.written, stats.decompressNs / 1000.0 / max(stats.read.load(), 1LL));
+	failed += check(stored < (long long)PAGES * PAGE_SIZE / 2 && bytes < (long long)PAGES * PAGE_SIZE * 3 / 4, "compressed size");
+	failed += check((long long)filesystem::file_size(NAME) <= bytes, "file size");
+
+	// 截断后重新打开
+	bpm->invalidateFile(fileID, true);
+	failed += check(fm->truncateFile(fileID, KEPT), "truncate");
+	fm->closeFile(fileID);
+	fm->openFile(NAME, fileID);
+	failed += check(fm->isCompressed(fileID) && fm->getPageNum(fileID) == KEPT, "page count after reopening");
+	failed += check(verify(bpm, fileID, KEPT, versions) == 0, "pages after reopening");
+	{
+		PageGuard guard = bpm->getPageGuard(fileID, KEPT + 10);
+		unsigned zero[PAGE_INT_NUM] = {};
+		failed += check(memcmp(guard.get(), zero, PAGE_SIZE) == 0, "truncated pages read as zeros");
+	}
+	long long keptBytes;
+	fm->getZipSize(fileID, pages, stored, keptBytes);
+	failed += check(keptBytes < bytes && (long long)filesystem::file_size(NAME) == keptBytes, "truncated file is smaller");
+
+	bpm->close();
+	delete bpm;
+	delete fm;
+	filesystem::remove_all(DIR_NAME);
+	remove(RAW_NAME);
+	if (failed == 0) {
+		printf("ok\n");
+	}
+	return failed;
+}
@@ -0,0 +1,175 @@
+/*
+ * testDictionary.cpp
+ * 建一张有VARCHAR列(含NULL)的表，ADD DICTIONARY前后、重新USE后、UPDATE成新值后、DROP DICTIONARY后和再次ADD后，
+ * 检查=、<>、IN(含NULL和字典里没有的值)选出的行和GROUP BY的结果都与内存中的表一致；
+ * 违反主键的插入不会把新值加进字典
+ * 编译: gcc -O2 -c third-party/libfort/lib/fort.c -o fort.o && g++ -O2 -std=c++20 -Isrc -Isrc/FileSystem -Isrc/Record -Isrc/Index -Isrc/System -Ithird-party/libfort/lib test/testDictionary.cpp src/System/DBManager.cpp src/System/DBManager_Alter.cpp src/System/DBManager_Table.cpp src/System/Query.cpp src/System/Schema.cpp src/Index/IndexHandler.cpp src/Record/RecordHandler.cpp src/FileSystem/FileSystem.cpp src/FileSystem/utils/MyBitMap.cpp fort.o -pthread
+ * 运行: ./a.out
+ */
+#include "DBManager.h"
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <optional>
+#include <vector>
+
+using namespace std;
+
+const int ROWS = 200;
+const char* COLORS[] = {"red", "green", "blue", "yellow"};
+string dbName = "testDictionary", table = "t", column = "c", home = MANAGER_NAME;
+
+// 内存中的表：id -> c，nullopt为NULL
+map<int, optional<string>> rows;
+
+Value varchar(const string& s) {
+	return Value(VARCHAR, s.data(), s.size());
+}
+
+Value value(const optional<string>& s) {
+	return s ? varchar(*s) : Value();
+}
+
+Condition condition(CMP_OP op, const vector<optional<string>>& values) {
+	Condition cond;
+	cond.a = make_pair(table, column);
+	cond.op = op;
+	if (op == IN) {
+		cond.b_value_lists.emplace_back();
+		for (auto& v : values) cond.b_value_lists.back().push_back(value(v));
+	}
+	else cond.b_val = value(values[0]);
+	return cond;
+}
+
+// 内存中的表上的同一个条件，NULL与任何值比较都不成立
+bool matches(const optional<string>& c, CMP_OP op, const vector<optional<string>>& values) {
+	if (!c) return false;
+	if (op == IN) return find(values.begin(), values.end(), c) != values.end();
+	if (!values[0]) return false;
+	return op == EQUAL ? *c == *values[0] : *c != *values[0];
+}
+
+bool checkSelect(DBManager& manager, CMP_OP op, const vector<optional<string>>& values, const char* what) {
+	vector<int> expected, selected;
+	for (auto& row : rows) if (matches(row.second, op, values)) expected.push_back(row.first);
+	Query query = manager.select({make_pair(table, string("id"))}, {table}, {condition(op, values)}, Aggregator());
+	for (auto& value_list : query.value_lists) selected.push_back(value_list[0].toInt());
+	sort(selected.begin(), selected.end());
+	if (selected == expected) return true;
+	printf("%s: %d rows selected, %d expected\n", what, (int)selected.size(), (int)expected.size());
+	return false;
+}
+
+bool checkGroupBy(DBManager& manager, const char* what) {
+	map<string, int> expected, grouped;
+	for (auto& row : rows) if (row.second) ++expected[*row.second];
+	Aggregator aggregator;
+	aggregator.ops.push_back(CNT_);
+	aggregator.group_by = make_pair(table, column);
+	Query query = manager.select({aggregator.group_by}, {table}, {}, aggregator);
+	for (auto& value_list : query.value_lists) grouped[value_list.back().toString()] = value_list[0].toInt();
+	if (grouped == expected) return true;
+	printf("%s: %d groups, %d expected\n", what, (int)grouped.size(), (int)expected.size());
+	return false;
+}
+
+bool checkAll(DBManager& manager, const char* what) {
+	bool ok = true;
+	ok &= checkSelect(manager, EQUAL, {"red"}, what);
+	ok &= checkSelect(manager, EQUAL, {"missing"}, what);
+	ok &= checkSelect(manager, EQUAL, {nullopt}, what);
+	ok &= checkSelect(manager, NOT_EQUAL, {"green"}, what);
+	ok &= checkSelect(manager, NOT_EQUAL, {"missing"}, what);
+	ok &= checkSelect(manager, NOT_EQUAL, {nullopt}, what);
+	ok &= checkSelect(manager, IN, {"blue", "missing", nullopt}, what);
+	ok &= checkSelect(manager, IN, {"purple", "yellow"}, what);
+	ok &= checkGroupBy(manager, what);
+	if (!ok) printf("%s failed\n", what);
+	return ok;
+}
+
+// 表的schema文件中字典的值的个数，没有字典时为-1
+int dictionarySize() {
+	Schema schema(table, dbName);
+	auto& dictionary = schema.columns[schema.find_column(column)].dictionary;
+	return dictionary ? dictionary->values.size() : -1;
+}
+
+void reopen(DBManager& manager) {
+	manager.use_db(home);
+	manager.use_db(dbName);
+}
+
+int main() {
+	MyBitMap::initConst();
+	bool ok = true;
+	DBManager manager;
+	manager.drop_db(dbName);
+	manager.create_db(dbName);
+	manager.use_db(dbName);
+	Schema schema;
+	schema.table_name = table;
+	Column id, c;
+	id.name = "id";
+	id.type = INT;
+	id.not_null = true;
+	id.has_default = false;
+	c.name = column;
+	c.type = VARCHAR;
+	c.varchar_len = 20;
+	c.not_null = false;
+	c.has_default = false;
+	schema.columns = {id, c};
+	schema.pk.name = "pk";
+	schema.pk.pks = {"id"};
+	manager.create_table(schema);
+
+	// 每5行有一行为NULL
+	vector<vector<Value>> value_lists;
+	for (int i = 0; i < ROWS; ++i) {
+		rows[i] = i % 5 == 4 ? nullopt : optional<string>(COLORS[i % 4]);
+		value_lists.push_back({Value(i), value(rows[i])});
+	}
+	manager.insert(table, value_lists);
+	ok &= checkAll(manager, "plain");
+
+	manager.alter_dictionary(table, column, true);
+	ok &= dictionarySize() == 4;
+	ok &= checkAll(manager, "dictionary");
+	reopen(manager);
+	ok &= checkAll(manager, "dictionary reopened");
+
+	// 主键重复的行被拒绝，它的新值不进字典；通过检查的行的新值进字典
+	vector<vector<Value>> duplicate = {{Value(0), varchar("cyan")}}, added = {{Value(ROWS), varchar("magenta")}};
+	manager.insert(table, duplicate);
+	ok &= dictionarySize() == 4;
+	manager.insert(table, added);
+	rows[ROWS] = "magenta";
+	ok &= dictionarySize() == 5;
+	ok &= checkAll(manager, "insert");
+
+	// 更新成字典里没有的值
+	manager.update(table, {make_pair(column, varchar("purple"))}, {condition(EQUAL, {"red"})});
+	for (auto& row : rows) if (row.second == "red") row.second = "purple";
+	ok &= dictionarySize() == 6;
+	ok &= checkAll(manager, "update");
+	reopen(manager);
+	ok &= checkAll(manager, "update reopened");
+
+	manager.alter_dictionary(table, column, false);
+	ok &= dictionarySize() == -1;
+	ok &= checkAll(manager, "dropped");
+	reopen(manager);
+	ok &= checkAll(manager, "dropped reopened");
+	manager.alter_dictionary(table, column, true);
+	ok &= dictionarySize() == 5;
+	ok &= checkAll(manager, "added again");
+
+	manager.use_db(home);
+	manager.drop_db(dbName);
+	if (ok) {
+		printf("ok\n");
+	}
+	return ok ? 0 : 1;
+}
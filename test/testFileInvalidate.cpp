@@ -0,0 +1,103 @@
+/*
+ * testFileInvalidate.cpp
+ * 检查flushFile、invalidateFile只影响一个文件：另一个文件的页面仍然命中缓存，
+ * 丢弃的脏页没有写回，关闭后重新使用的文件id读到的是新文件的内容
+ * 编译: g++ -O2 -std=c++20 -Isrc -Isrc/FileSystem test/testFileInvalidate.cpp src/FileSystem/utils/MyBitMap.cpp -pthread
+ * 运行: ./a.out
+ */
+#include "FileSystem/bufmanager/BufPageManager.h"
+#include "FileSystem/fileio/FileManager.h"
+#include "FileSystem/utils/pagedef.h"
+#include "testCheck.h"
+#include <cstdio>
+#include <iostream>
+
+using namespace std;
+
+const int FILE_PAGES = 256;
+
+// 把文件的每个页面写成base + 页号
+void fill(BufPageManager* bpm, int fileID, unsigned base) {
+	for (int p = 0; p < FILE_PAGES; ++p) {
+		PageGuard guard = bpm->allocPageGuard(fileID, p);
+		guard.get()[0] = base + p;
+		guard.markDirty();
+	}
+}
+
+// 返回内容不是base + 页号的页面个数
+int verify(BufPageManager* bpm, int fileID, unsigned base) {
+	int wrong = 0;
+	for (int p = 0; p < FILE_PAGES; ++p) {
+		PageGuard guard = bpm->getPageGuard(fileID, p);
+		wrong += guard.get()[0] != base + p;
+	}
+	return wrong;
+}
+
+int main() {
+	MyBitMap::initConst();
+	const char* names[] = {"testFileInvalidate0.tmp", "testFileInvalidate1.tmp", "testFileInvalidate2.tmp"};
+	for (const char* name : names) {
+		remove(name);
+	}
+	FileManager* fm = new FileManager();
+	BufConfig config(4 * FILE_PAGES, BUF_SHARD_NUM, LRU_REPLACE);
+	config.flusher = false;
+	// 预读会把页面算作命中
+	config.readAhead = false;
+	BufPageManager* bpm = new BufPageManager(fm, config);
+	int a, b, c;
+	fm->createFile(names[0]);
+	fm->createFile(names[1]);
+	fm->openFile(names[0], a);
+	fm->openFile(names[1], b);
+	fill(bpm, a, 1000);
+	fill(bpm, b, 2000);
+	int failed = 0;
+
+	// flushFile只写a的脏页
+	long long evictWrites, pages, calls;
+	bpm->flushFile(a);
+	bpm->getWriteStats(evictWrites, pages, calls);
+	failed += check(pages == FILE_PAGES, "flushFile writes only the pages of its file");
+
+	// 写回并去掉a的页面，b仍然在缓存中
+	bpm->invalidateFile(a, true);
+	bpm->resetStats();
+	failed += check(verify(bpm, b, 2000) == 0, "pages of the other file");
+	long long hits, misses;
+	bpm->getStats(hits, misses);
+	failed += check(misses == 0, "other file stays cached");
+	failed += check(verify(bpm, a, 1000) == 0, "invalidated file is read back from disk");
+	bpm->getStats(hits, misses);
+	failed += check(misses == FILE_PAGES, "invalidated file is no longer cached");
+
+	// 丢弃a上的修改
+	fill(bpm, a, 3000);
+	bpm->invalidateFile(a, false);
+	failed += check(verify(bpm, a, 1000) == 0, "discarded pages are not written back");
+
+	// 关闭a之后它的id被新文件重新使用，不能读到a的页面
+	bpm->invalidateFile(a, false);
+	fm->closeFile(a);
+	fm->createFile(names[2]);
+	fm->openFile(names[2], c);
+	failed += check(c == a, "file id is reused");
+	fill(bpm, c, 4000);
+	bpm->close();
+	failed += check(verify(bpm, c, 4000) == 0, "reused file id");
+	failed += check(verify(bpm, b, 2000) == 0, "other file after close");
+
+	delete bpm;
+	fm->closeFile(b);
+	fm->closeFile(c);
+	for (const char* name : names) {
+		remove(name);
+	}
+	delete fm;
+	if (failed == 0) {
+		printf("ok\n");
+	}
+	return failed;
+}
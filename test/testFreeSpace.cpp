@@ -0,0 +1,112 @@
+/*
+ * testFreeSpace.cpp
+ * 插入一批记录后删掉一半，再插入删掉的记录数的4/5，检查删掉的空间被重新利用、文件没有变大，记录内容正确；
+ * 重新打开文件时行数从堆头页读出，删掉.fsm文件后重新打开时重建；
+ * 另建一个表删掉一半记录后把其余的改短，检查原地改短空出的空间也被重新利用
+ * 编译: g++ -O2 -std=c++20 -Isrc -Isrc/FileSystem -Isrc/Record test/testFreeSpace.cpp src/Record/RecordHandler.cpp src/FileSystem/FileSystem.cpp src/FileSystem/utils/MyBitMap.cpp -pthread
+ * 运行: ./a.out
+ */
+#include "testRecords.h"
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+const char* NAME = "testFreeSpace.data";
+const int ROWS = 20000;
+const int REINSERT = ROWS / 2 * 4 / 5;
+
+int main() {
+	MyBitMap::initConst();
+	remove(NAME);
+	remove((string(NAME) + ".fsm").c_str());
+	mt19937 rng(1);
+	vector<bool> live(2 * ROWS);
+	bool ok = true;
+
+	RecordHandler* handler = new RecordHandler();
+	handler->createFile(NAME, type);
+	for (int id = 0; id < ROWS; ++id) {
+		handler->ins(makeRecord(id, rng));
+		live[id] = true;
+	}
+	int pages = check(*handler, live, ok);
+	for (auto it = handler->begin(); !it.isEnd(); ) {
+		if ((*it).int_data[0] % 2 == 0) {
+			live[(*it).int_data[0]] = false;
+			handler->del(it++);
+		} else {
+			++it;
+		}
+	}
+	long long half = handler->rows();
+	for (int id = ROWS; id < ROWS + REINSERT; ++id) {
+		handler->ins(makeRecord(id, rng));
+		live[id] = true;
+	}
+	int reused = check(*handler, live, ok);
+	long long rows = handler->rows();
+	printf("pages %d -> %d after deleting half and inserting again  rows %lld -> %lld\n", pages + 1, reused + 1, half, rows);
+	ok &= half == ROWS / 2 && rows == ROWS / 2 + REINSERT && reused <= pages;
+	delete handler;
+
+	// 行数和最后一页从堆头页读出
+	handler = new RecordHandler();
+	handler->openFile(NAME, type);
+	long long reopened = handler->rows();
+	handler->ins(makeRecord(2 * ROWS - 1, rng));
+	live[2 * ROWS - 1] = true;
+	check(*handler, live, ok);
+	ok &= reopened == rows && handler->rows() == rows + 1;
+	delete handler;
+
+	// 没有.fsm文件的表在打开时重建
+	remove((string(NAME) + ".fsm").c_str());
+	handler = new RecordHandler();
+	handler->openFile(NAME, type);
+	long long rebuilt = handler->rows();
+	check(*handler, live, ok);
+	printf("reopened %lld rows  rebuilt %lld rows\n", reopened, rebuilt);
+	ok &= rebuilt == rows + 1;
+	delete handler;
+
+	remove(NAME);
+	remove((string(NAME) + ".fsm").c_str());
+
+	// 删掉一半记录后把其余的改短，再插入同样多的更长的记录，删掉的记录的空间放不下，加上改短空出的空间正好放下
+	live.assign(2 * ROWS, false);
+	handler = new RecordHandler();
+	handler->createFile(NAME, type);
+	for (int id = 0; id < ROWS; ++id) {
+		handler->ins(makeRecord(id, 60));
+		live[id] = true;
+	}
+	pages = check(*handler, live, ok);
+	for (auto it = handler->begin(); !it.isEnd(); ++it) {
+		int id = (*it).int_data[0];
+		if (id % 2 == 0) {
+			live[id] = false;
+			handler->del(it);
+		}
+	}
+	for (auto it = handler->begin(); !it.isEnd(); ++it) {
+		handler->upd(it, makeRecord((*it).int_data[0], 1));
+	}
+	for (int id = ROWS; id < ROWS + ROWS / 2; ++id) {
+		handler->ins(makeRecord(id, 100));
+		live[id] = true;
+	}
+	reused = check(*handler, live, ok);
+	printf("pages %d -> %d after shrinking the rows left\n", pages + 1, reused + 1);
+	ok &= reused <= pages;
+	delete handler;
+
+	remove(NAME);
+	remove((string(NAME) + ".fsm").c_str());
+	if (ok) {
+		printf("ok\n");
+	}
+	return ok ? 0 : 1;
+}
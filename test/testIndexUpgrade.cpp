@@ -0,0 +1,95 @@
+/*
+ * testIndexUpgrade.cpp
+ * 按第一版格式(int类型的值)手工写一个两层的索引文件，按表结构记录的第一版格式用openIndex打开后检查升级成当前格式、内容不变；
+ * 再插入超过32位的记录编号，重新打开后用lowerBound和find检查
+ * 编译: g++ -O2 -std=c++20 -Isrc -Isrc/FileSystem -Isrc/Record -Isrc/Index test/testIndexUpgrade.cpp src/Index/IndexHandler.cpp src/Record/RecordHandler.cpp src/FileSystem/FileSystem.cpp src/FileSystem/utils/MyBitMap.cpp -pthread
+ * 运行: ./a.out
+ */
+#include "IndexHandler.h"
+#include <cstdio>
+#include <filesystem>
+#include <vector>
+
+using namespace std;
+
+const char* NAME = "testIndexUpgrade.index";
+const int ROWS = 50000;
+const int LEAF = 500;
+
+// 第一版的页面：[数量 | 叶子标记] [页0中是最后一页的页号]，之后是(key0, key1, 值)
+void writeV1(const vector<int>& keys, const vector<int>& vals) {
+	int leaves = (ROWS + LEAF - 1) / LEAF;
+	vector<int> pages((leaves + 1) * PAGE_INT_NUM);
+	int* root = pages.data();
+	root[0] = leaves;
+	root[1] = leaves;
+	for (int l = 0; l < leaves; ++l) {
+		int* page = pages.data() + (l + 1) * PAGE_INT_NUM;
+		int n = min(LEAF, ROWS - l * LEAF);
+		page[0] = (1 << 15) | n;
+		for (int i = 0; i < n; ++i) {
+			int r = l * LEAF + i;
+			page[2 + i * 3] = keys[r * 2];
+			page[3 + i * 3] = keys[r * 2 + 1];
+			page[4 + i * 3] = vals[r];
+		}
+		root[2 + l * 3] = page[2];
+		root[3 + l * 3] = page[3];
+		root[4 + l * 3] = l + 1;
+	}
+	FILE* f = fopen(NAME, "wb");
+	fwrite(pages.data(), sizeof(int), pages.size(), f);
+	fclose(f);
+}
+
+int main() {
+	MyBitMap::initConst();
+	bool ok = true;
+	vector<int> keys, vals;
+	for (int r = 0; r < ROWS; ++r) {
+		keys.push_back(r / 10);
+		keys.push_back(r % 10);
+		vals.push_back(r * 7);
+	}
+	writeV1(keys, vals);
+	long long v1Bytes = filesystem::file_size(NAME);
+
+	IndexHandler* handler = new IndexHandler();
+	ok &= handler->openIndex(NAME, 2, INDEX_FORMAT_V1) == 0;
+	int rows = 0;
+	for (auto it = handler->begin(); !it.isEnd(); ++it, ++rows) {
+		ok &= rows < ROWS && *it == vals[rows];
+	}
+	ok &= rows == ROWS;
+
+	// 超过32位的值
+	const long long BIG = 5LL << 32;
+	for (int r = 0; r < ROWS; r += 100) {
+		int key[2] = {keys[r * 2], 10};
+		handler->ins(key, BIG + r);
+	}
+	delete handler;
+	printf("v1 file %lld bytes, upgraded %lld bytes\n", v1Bytes, (long long)filesystem::file_size(NAME));
+	ok &= !filesystem::exists(string(NAME) + ".upgrade");
+
+	handler = new IndexHandler();
+	ok &= handler->openIndex(NAME, 2) == 0;
+	rows = 0;
+	for (auto it = handler->begin(); !it.isEnd(); ++it) ++rows;
+	ok &= rows == ROWS + ROWS / 100;
+	for (int r = 0; r < ROWS; r += 100) {
+		int key[2] = {keys[r * 2], 10};
+		auto it = handler->find(key);
+		ok &= !it.isEnd() && *it == BIG + r;
+		key[1] = 0;
+		it = handler->lowerBound(key);
+		ok &= !it.isEnd() && *it == vals[r];
+	}
+	delete handler;
+
+	remove(NAME);
+	if (ok) {
+		printf("ok\n");
+	}
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,167 @@
+/*
+ * testOverflow.cpp
+ * 插入带长varchar(最长3页)的记录，检查长varchar放进溢出页、内容不变，只读其他字段的扫描不读溢出页；
+ * 删掉一半再插入同样多，检查溢出页被重新利用；再更新、VACUUM之后重新打开检查
+ * 编译: g++ -O2 -std=c++20 -Isrc -Isrc/FileSystem -Isrc/Record test/testOverflow.cpp src/Record/RecordHandler.cpp src/FileSystem/FileSystem.cpp src/FileSystem/utils/MyBitMap.cpp -pthread
+ * 运行: ./a.out
+ */
+#include "RecordHandler.h"
+#include <cstdio>
+#include <filesystem>
+#include <map>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+const char* NAME = "testOverflow.data";
+const int ROWS = 3000;
+RecordType type(2, 3);
+
+// varchar 0短，1有一半超过1/8页(最长3页)，2一般不超过
+Record makeRecord(int id, mt19937& rng) {
+	Record record(type);
+	record.int_data[0] = id;
+	record.int_data[1] = id * 7;
+	record.varchar_data[0] = string(1 + rng() % 50, 'a' + id % 26);
+	record.varchar_null[1] = id % 10 == 0;
+	if (!record.varchar_null[1]) {
+		int len = id % 2 ? 1 + rng() % 500 : rng() % (3 * PAGE_SIZE);
+		for (int i = 0; i < len; ++i) record.varchar_data[1] += 'a' + (id + i) % 26;
+	}
+	record.varchar_data[2] = string(rng() % 1000, 'A' + id % 26);
+	return record;
+}
+
+bool same(const Record& a, const Record& b) {
+	return a.int_data == b.int_data && a.varchar_null == b.varchar_null && a.varchar_data == b.varchar_data;
+}
+
+// 检查表中正好是rows中的记录
+bool check(RecordHandler& handler, map<int, Record>& rows) {
+	bool ok = true;
+	int n = 0;
+	for (auto it = handler.begin(); !it.isEnd(); ++it, ++n) {
+		Record record = *it;
+		ok &= rows.count(record.int_data[0]) && same(record, rows.at(record.int_data[0]));
+	}
+	return ok && n == (int)rows.size() && handler.rows() == n;
+}
+
+long long overflowPages() {
+	string name = string(NAME) + ".overflow";
+	FileSystem::flushFiles(name);
+	return filesystem::file_size(name) / PAGE_SIZE;
+}
+
+void removeFiles() {
+	remove(NAME);
+	remove((string(NAME) + ".fsm").c_str());
+	remove((string(NAME) + ".overflow").c_str());
+}
+
+int main() {
+	MyBitMap::initConst();
+	removeFiles();
+	mt19937 rng(1);
+	map<int, Record> rows;
+	bool ok = true;
+
+	RecordHandler* handler = new RecordHandler();
+	handler->createFile(NAME, type);
+	// 每个varchar都接近一页的记录也能放下
+	Record wide(type);
+	for (auto& s : wide.varchar_data) s = string(PAGE_SIZE - 100, 'w');
+	ok &= handler->fits(wide);
+	for (int id = 0; id < ROWS; ++id) {
+		Record record = makeRecord(id, rng);
+		ok &= handler->fits(record);
+		handler->ins(record);
+		rows.emplace(id, record);
+	}
+	ok &= check(*handler, rows);
+	long long pages = overflowPages();
+
+	// 只读int和短varchar的扫描每个数据页读一次，长varchar要读溢出页
+	long long hits, misses, before, after;
+	int dataPages = 0, lastPage = -1, overflowed = 0;
+	FileSystem::bpm->getStats(hits, misses);
+	before = hits + misses;
+	for (auto it = handler->begin(); !it.isEnd(); ++it) {
+		RecordView view = it.view();
+		ok &= view.int_data(1) == view.int_data(0) * 7 && view.varchar_data(0)[0] == 'a' + view.int_data(0) % 26;
+		overflowed += view.varchar_overflow(1);
+		ok &= !view.varchar_overflow(0);
+		if (it.toInt() / PAGE_SIZE != lastPage) ++dataPages, lastPage = it.toInt() / PAGE_SIZE;
+	}
+	FileSystem::bpm->getStats(hits, misses);
+	after = hits + misses;
+	long long scanned = after - before;
+	for (auto it = handler->begin(); !it.isEnd(); ++it) {
+		RecordView view = it.view();
+		Record& record = rows.at(view.int_data(0));
+		ok &= view.varchar_null(1) == record.varchar_null[1] && view.varchar_data(1) == record.varchar_data[1];
+	}
+	FileSystem::bpm->getStats(hits, misses);
+	printf("%d of %d rows overflowed into %lld pages; %d data pages, scan without them read %lld pages, with them %lld\n",
+		overflowed, ROWS, pages, dataPages, scanned, hits + misses - after);
+	ok &= overflowed > 0 && scanned == dataPages && hits + misses - after > dataPages + pages / 2;
+
+	// 删掉一半再插入同样多，溢出页重新利用
+	for (auto it = handler->begin(); !it.isEnd(); ) {
+		int id = (*it).int_data[0];
+		if (id % 2 == 0) {
+			rows.erase(id);
+			handler->del(it++);
+		} else ++it;
+	}
+	for (int id = 0; id < ROWS; id += 2) {
+		Record record = makeRecord(id, rng);
+		handler->ins(record);
+		rows.emplace(id, record);
+	}
+	ok &= check(*handler, rows);
+	long long reused = overflowPages();
+
+	// 长的更新成短的、短的更新成长的
+	for (auto it = handler->begin(); !it.isEnd(); ) {
+		int id = (*it).int_data[0];
+		if (id % 3 == 0) {
+			Record record = makeRecord(id + 1, rng);
+			record.int_data[0] = id;
+			record.int_data[1] = id * 7;
+			record.varchar_data[0][0] = 'a' + id % 26;
+			handler->upd(it++, record);
+			rows.at(id) = record;
+		} else ++it;
+	}
+	ok &= check(*handler, rows);
+
+	// VACUUM移动的记录保留原来的溢出页
+	for (auto it = handler->begin(); !it.isEnd(); ) {
+		int id = (*it).int_data[0];
+		if (id % 4 == 1) {
+			rows.erase(id);
+			handler->del(it++);
+		} else ++it;
+	}
+	vector<pair<long long, long long>> moves;
+	int freed = handler->vacuum(moves);
+	ok &= check(*handler, rows);
+	delete handler;
+
+	handler = new RecordHandler();
+	handler->openFile(NAME, type);
+	ok &= check(*handler, rows);
+	long long end = overflowPages();
+	printf("overflow pages %lld -> %lld after reinserting half -> %lld after updates and vacuum; vacuum moved %d rows, freed %d pages\n",
+		pages, reused, end, (int)moves.size(), freed);
+	ok &= reused <= pages + pages / 10 && freed > 0;
+	delete handler;
+
+	removeFiles();
+	if (ok) {
+		printf("ok\n");
+	}
+	return ok ? 0 : 1;
+}
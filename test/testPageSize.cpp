@@ -0,0 +1,113 @@
+/*
+ * testPageSize.cpp
+ * 分别用8KB到64KB的页面建表和索引：插入长短不一(最长半页)的记录并删掉一部分，VACUUM后重新打开，
+ * 检查记录、索引内容和文件大小都按页面大小对齐
+ * 编译: g++ -O2 -std=c++20 -Isrc -Isrc/FileSystem -Isrc/Record -Isrc/Index test/testPageSize.cpp src/Index/IndexHandler.cpp src/Record/RecordHandler.cpp src/FileSystem/FileSystem.cpp src/FileSystem/utils/MyBitMap.cpp -pthread
+ * 运行: ./a.out
+ */
+#include "IndexHandler.h"
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+const char* TEST_DIR = "testPageSize/";
+const int ROWS = 20000;
+RecordType type(2, 1);
+
+Record makeRecord(int id, int pageSize, mt19937& rng) {
+	Record record(type);
+	record.int_data[0] = id;
+	record.int_data[1] = id * 3;
+	// 每100条有一条半页长
+	int len = id % 100 == 0 ? pageSize / 2 : 1 + rng() % 100;
+	record.varchar_data[0] = string(len, 'a' + id % 26);
+	return record;
+}
+
+bool check(int idx) {
+	int pageSize = 1 << idx;
+	string data = string(TEST_DIR) + "t.data", index = string(TEST_DIR) + "t.index";
+	filesystem::remove_all(TEST_DIR);
+	filesystem::create_directory(TEST_DIR);
+	FileSystem::setPageSize(TEST_DIR, idx);
+	BufConfig config(256, 4, LRU_REPLACE);
+	config.maxCapacity = 256;
+	config.pageSizeIdx = idx;
+	config.warmup = false;
+	BufPageManager* bpm = new BufPageManager(FileSystem::fm, config);
+	mt19937 rng(idx);
+	bool ok = true;
+
+	RecordHandler* records = new RecordHandler();
+	IndexHandler* indexes = new IndexHandler();
+	records->setPool(bpm);
+	indexes->setPool(bpm);
+	records->createFile(data.c_str(), type);
+	indexes->createIndex(index.c_str(), 1);
+	for (int id = 0; id < ROWS; ++id) {
+		Record record = makeRecord(id, pageSize, rng);
+		ok &= records->fits(record);
+		indexes->ins(&id, records->ins(record).toInt());
+	}
+	for (auto it = records->begin(); !it.isEnd(); ) {
+		int id = (*it).int_data[0];
+		if (id % 3 == 0) {
+			indexes->del(&id, it.toInt());
+			records->del(it++);
+		} else ++it;
+	}
+	vector<pair<long long, long long>> moves;
+	records->vacuum(moves);
+	for (auto move : moves) {
+		int id = (*RecordHandler::Iterator(records, move.second)).int_data[0];
+		indexes->upd(&id, move.first, &id, move.second);
+	}
+	delete records;
+	delete indexes;
+
+	records = new RecordHandler();
+	indexes = new IndexHandler();
+	records->setPool(bpm);
+	indexes->setPool(bpm);
+	records->openFile(data.c_str(), type);
+	indexes->openIndex(index.c_str(), 1);
+	int rows = 0;
+	for (auto it = indexes->begin(); !it.isEnd(); ++it, ++rows) {
+		Record record = *RecordHandler::Iterator(records, *it);
+		int id = record.int_data[0];
+		ok &= id % 3 != 0 && record.int_data[1] == id * 3 && record.varchar_data[0][0] == 'a' + id % 26;
+		ok &= id % 100 != 0 || (int)record.varchar_data[0].size() == pageSize / 2;
+	}
+	ok &= rows == ROWS - (ROWS + 2) / 3 && records->rows() == rows;
+	delete records;
+	delete indexes;
+	bpm->close();
+	delete bpm;
+
+	long long bytes = filesystem::file_size(data);
+	printf("%2d KB pages: %d rows, %lld pages of data, %d moved by vacuum\n",
+		pageSize >> 10, rows, bytes / pageSize, (int)moves.size());
+	ok &= bytes % pageSize == 0 && filesystem::file_size(index) % pageSize == 0;
+	FileSystem::closeFiles(TEST_DIR, true);
+	FileSystem::setPageSize(TEST_DIR, PAGE_SIZE_IDX);
+	return ok;
+}
+
+int main() {
+	MyBitMap::initConst();
+	FileSystem::config.warmup = false;
+	FileSystem::init();
+	bool ok = true;
+	for (int idx = PAGE_SIZE_IDX; idx <= MAX_PAGE_SIZE_IDX; ++idx) {
+		ok &= check(idx);
+	}
+	FileSystem::release();
+	filesystem::remove_all(TEST_DIR);
+	if (ok) {
+		printf("ok\n");
+	}
+	return ok ? 0 : 1;
+}
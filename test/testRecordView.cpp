@@ -0,0 +1,74 @@
+/*
+ * testRecordView.cpp
+ * 分别用v1、v2、v3三种记录格式插入带NULL的随机记录，检查迭代器的view()逐个字段读出的内容和插入的记录一致
+ * 编译: g++ -O2 -std=c++20 -Isrc -Isrc/FileSystem -Isrc/Record test/testRecordView.cpp src/Record/RecordHandler.cpp src/FileSystem/FileSystem.cpp src/FileSystem/utils/MyBitMap.cpp -pthread
+ * 运行: ./a.out
+ */
+#include "RecordHandler.h"
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+const char* NAME = "testRecordView.data";
+const int ROWS = 5000;
+
+bool check(int format) {
+	RecordType type(5, 4, format);
+	remove(NAME);
+	remove((string(NAME) + ".fsm").c_str());
+	mt19937 rng(1);
+	bool ok = true;
+
+	vector<Record> records;
+	RecordHandler* handler = new RecordHandler();
+	handler->createFile(NAME, type);
+	for (int id = 0; id < ROWS; ++id) {
+		Record record(type);
+		record.int_data[0] = id;
+		record.int_null[0] = false;
+		for (int i = 1; i < type.num_int; ++i) {
+			record.int_null[i] = rng() % 4 == 0;
+			record.int_data[i] = record.int_null[i] ? 0 : (int)rng();
+		}
+		for (int i = 0; i < type.num_varchar; ++i) {
+			record.varchar_null[i] = rng() % 4 == 0;
+			if (!record.varchar_null[i]) record.varchar_data[i] = string(rng() % 30, 'a' + rng() % 26);
+		}
+		handler->ins(record);
+		records.push_back(record);
+	}
+	int rows = 0;
+	for (auto it = handler->begin(); !it.isEnd(); ++it, ++rows) {
+		RecordView view = it.view();
+		Record& record = records[view.int_data(0)];
+		Record decoded = *it;
+		ok &= decoded.varchar_data == record.varchar_data && decoded.int_null == record.int_null;
+		for (int i = 0; i < type.num_int; ++i) {
+			ok &= view.int_null(i) == record.int_null[i];
+			ok &= record.int_null[i] || view.int_data(i) == record.int_data[i];
+		}
+		// 倒序读，v1每次都从第一个varchar开始找
+		for (int i = type.num_varchar - 1; i >= 0; --i) {
+			ok &= view.varchar_null(i) == record.varchar_null[i];
+			ok &= record.varchar_null[i] || view.varchar_data(i) == record.varchar_data[i];
+		}
+	}
+	printf("v%d: %d rows\n", format, rows);
+	ok &= rows == ROWS;
+	delete handler;
+	return ok;
+}
+
+int main() {
+	MyBitMap::initConst();
+	bool ok = check(RECORD_FORMAT_V1) && check(RECORD_FORMAT_V2) && check(RECORD_FORMAT_V3);
+	remove(NAME);
+	remove((string(NAME) + ".fsm").c_str());
+	if (ok) {
+		printf("ok\n");
+	}
+	return ok ? 0 : 1;
+}
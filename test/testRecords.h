@@ -0,0 +1,45 @@
+/*
+ * testRecords.h
+ * 测试堆文件的程序共用的记录：编号为id的记录是(id, id * 7, 长度不定、由'a' + id % 26组成的字符串)
+ */
+#pragma once
+
+#include "RecordHandler.h"
+#include <random>
+#include <vector>
+
+RecordType type(2, 1);
+
+Record makeRecord(int id, int len) {
+	Record record(type);
+	record.int_data[0] = id;
+	record.int_data[1] = id * 7;
+	record.varchar_data[0] = std::string(len, 'a' + id % 26);
+	return record;
+}
+
+// 字符串长20到59
+Record makeRecord(int id, std::mt19937& rng) {
+	return makeRecord(id, 20 + rng() % 40);
+}
+
+// 检查表中正好是live中的记录，返回用到的最大页号
+int check(RecordHandler& handler, const std::vector<bool>& live, bool& ok) {
+	std::vector<int> seen(live.size());
+	int maxPage = 0;
+	for (auto it = handler.begin(); !it.isEnd(); ++it) {
+		Record record = *it;
+		int id = record.int_data[0];
+		maxPage = std::max(maxPage, (int)(it.toInt() / PAGE_SIZE));
+		if (id < 0 || id >= (int)live.size() || record.int_data[1] != id * 7 ||
+				record.varchar_data[0].empty() || record.varchar_data[0][0] != 'a' + id % 26) {
+			ok = false;
+			continue;
+		}
+		++seen[id];
+	}
+	for (size_t i = 0; i < live.size(); ++i) {
+		ok &= seen[i] == (live[i] ? 1 : 0);
+	}
+	return maxPage;
+}
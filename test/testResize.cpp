@@ -0,0 +1,86 @@
+/*
+ * testResize.cpp
+ * 在随机读写页面的过程中反复扩大、缩小缓存，检查每个页面读到的内容都是最后一次写入的内容
+ * 编译: g++ -O2 -std=c++20 -Isrc -Isrc/FileSystem test/testResize.cpp src/FileSystem/utils/MyBitMap.cpp -pthread
+ * 运行: ./a.out
+ */
+#include "FileSystem/bufmanager/BufPageManager.h"
+#include "FileSystem/fileio/FileManager.h"
+#include "FileSystem/utils/pagedef.h"
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+const int FILE_PAGES = 2048;
+const int STEPS = 50000;
+const int SIZES[] = {256, 128, 1024, 130, 512, 3000, 200};
+
+bool test(ReplacePolicy policy) {
+	const char* name = "testResize.tmp";
+	remove(name);
+	FileManager* fm = new FileManager();
+	fm->createFile(name);
+	int fileID;
+	fm->openFile(name, fileID);
+	BufConfig config(128, BUF_SHARD_NUM, policy);
+	config.maxCapacity = 4096;
+	BufPageManager* bpm = new BufPageManager(fm, config);
+	vector<unsigned> expect(FILE_PAGES, 0);
+	for (int p = 0; p < FILE_PAGES; ++p) {
+		PageGuard guard = bpm->allocPageGuard(fileID, p);
+		guard.get()[0] = 0;
+		guard.markDirty();
+	}
+	mt19937 rng(1);
+	int wrong = 0, resized = 0;
+	for (int i = 0; i < STEPS; ++i) {
+		if (i % 1000 == 999) {
+			resized += bpm->resize(SIZES[i / 1000 % 7]);
+		}
+		int p = rng() % FILE_PAGES;
+		PageGuard guard = bpm->getPageGuard(fileID, p);
+		if (guard.get()[0] != expect[p]) {
+			++wrong;
+		}
+		if (rng() % 3 == 0) {
+			guard.get()[0] = expect[p] = i;
+			guard.markDirty();
+		}
+	}
+	// 被pin住的页面在要去掉的范围里时不能缩小
+	bpm->resize(4096);
+	PageGuard guard;
+	for (int p = 0; p < FILE_PAGES && guard.getIndex() < 128; ++p) {
+		guard = bpm->getPageGuard(fileID, p);
+	}
+	bool refused = guard.getIndex() >= 128 && !bpm->resize(128) && bpm->capacity == 4096;
+	guard.release();
+	bpm->close();
+	for (int p = 0; p < FILE_PAGES; ++p) {
+		unsigned b[PAGE_INT_NUM];
+		fm->readPage(fileID, p, b, 0);
+		if (b[0] != expect[p]) {
+			++wrong;
+		}
+	}
+	printf("%-6s resized %d  capacity %d  wrong %d  refused %d\n", replacePolicyName(policy), resized,
+		bpm->capacity, wrong, refused);
+	delete bpm;
+	fm->closeFile(fileID);
+	remove(name);
+	delete fm;
+	return wrong == 0 && refused && resized == STEPS / 1000;
+}
+
+int main() {
+	MyBitMap::initConst();
+	bool ok = true;
+	for (ReplacePolicy policy : {LRU_REPLACE, CLOCK_REPLACE, LRU2_REPLACE, TWO_Q_REPLACE}) {
+		ok = test(policy) && ok;
+	}
+	cout << (ok ? "ok" : "FAILED") << endl;
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,79 @@
+/*
+ * testVacuum.cpp
+ * 插入一批记录后删掉3/4，VACUUM之后检查文件变小、记录内容正确，返回的移动记录的新旧位置对应同一条记录；
+ * 之后插入的记录和重新打开文件都正常
+ * 编译: g++ -O2 -std=c++20 -Isrc -Isrc/FileSystem -Isrc/Record test/testVacuum.cpp src/Record/RecordHandler.cpp src/FileSystem/FileSystem.cpp src/FileSystem/utils/MyBitMap.cpp -pthread
+ * 运行: ./a.out
+ */
+#include "testRecords.h"
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+const char* NAME = "testVacuum.data";
+const int ROWS = 20000;
+
+int main() {
+	MyBitMap::initConst();
+	remove(NAME);
+	remove((string(NAME) + ".fsm").c_str());
+	mt19937 rng(1);
+	vector<bool> live(ROWS + 1);
+	bool ok = true;
+
+	RecordHandler* handler = new RecordHandler();
+	handler->createFile(NAME, type);
+	for (int id = 0; id < ROWS; ++id) {
+		handler->ins(makeRecord(id, rng));
+		live[id] = true;
+	}
+	int pages = check(*handler, live, ok);
+	map<long long, int> ids;
+	for (auto it = handler->begin(); !it.isEnd(); ) {
+		int id = (*it).int_data[0];
+		if (id % 4 != 0) {
+			live[id] = false;
+			handler->del(it++);
+		} else {
+			ids[it.toInt()] = id;
+			++it;
+		}
+	}
+	long long dead = handler->deadRows();
+
+	vector<pair<long long, long long>> moves;
+	int freed = handler->vacuum(moves);
+	int vacuumed = check(*handler, live, ok);
+	for (auto move : moves) {
+		Record record = *RecordHandler::Iterator(handler, move.second);
+		ok &= ids.count(move.first) && record.int_data[0] == ids[move.first];
+	}
+	delete handler;
+	long long bytes = filesystem::file_size(NAME);
+	printf("pages %d -> %d  freed %d  moved %d rows  dead %lld  file %lld bytes\n",
+		pages + 1, vacuumed + 1, freed, (int)moves.size(), dead, bytes);
+	ok &= dead == ROWS / 4 * 3 && vacuumed + 1 == pages + 1 - freed && vacuumed < pages / 3 + 2;
+	ok &= bytes == (long long)(vacuumed + 1) * PAGE_SIZE;
+
+	// 重新打开后行数不变，插入的记录接在末尾
+	handler = new RecordHandler();
+	handler->openFile(NAME, type);
+	ok &= handler->rows() == ROWS / 4 && handler->deadRows() == 0;
+	handler->ins(makeRecord(ROWS, rng));
+	live[ROWS] = true;
+	check(*handler, live, ok);
+	ok &= handler->rows() == ROWS / 4 + 1;
+	delete handler;
+
+	remove(NAME);
+	remove((string(NAME) + ".fsm").c_str());
+	if (ok) {
+		printf("ok\n");
+	}
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,95 @@
+/*
+ * testWarmup.cpp
+ * 在大缓存中读一遍文件后反复访问其中一小部分页面，dump之后用只能放下这部分页面的小缓存启动，
+ * 检查预热读回的正是这些热点页面，并且内容正确
+ * 编译: g++ -O2 -std=c++20 -Isrc -Isrc/FileSystem test/testWarmup.cpp src/FileSystem/utils/MyBitMap.cpp -pthread
+ * 运行: ./a.out
+ */
+#include "FileSystem/bufmanager/BufPageManager.h"
+#include "FileSystem/fileio/FileManager.h"
+#include "FileSystem/utils/pagedef.h"
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <thread>
+
+using namespace std;
+
+const int FILE_PAGES = 2048;
+const int HOT_PAGES = 256;
+// 热点页面是页号为HOT_STRIDE的倍数的页面
+const int HOT_STRIDE = FILE_PAGES / HOT_PAGES;
+
+bool test(ReplacePolicy policy, bool readAhead) {
+	const char* name = "testWarmup.tmp";
+	const char* dumpName = "testWarmup.dump";
+	remove(name);
+	remove(dumpName);
+	FileManager* fm = new FileManager();
+	fm->createFile(name);
+	int fileID;
+	fm->openFile(name, fileID);
+	BufConfig config(4 * FILE_PAGES, BUF_SHARD_NUM, policy);
+	config.flusher = false;
+	config.readAhead = readAhead;
+	config.dumpFile = dumpName;
+	BufType b = new unsigned int[PAGE_INT_NUM]();
+	for (int p = 0; p < FILE_PAGES; ++p) {
+		b[0] = p;
+		fm->writePage(fileID, p, b, 0);
+	}
+	delete[] b;
+	BufPageManager* bpm = new BufPageManager(fm, config);
+	for (int p = 0; p < FILE_PAGES; ++p) {
+		bpm->getPageGuard(fileID, p);
+	}
+	for (int round = 0; round < 3; ++round) {
+		for (int p = 0; p < FILE_PAGES; p += HOT_STRIDE) {
+			bpm->getPageGuard(fileID, p);
+		}
+	}
+	bool dumped = bpm->dump();
+	bpm->close();
+	delete bpm;
+
+	config.capacity = HOT_PAGES;
+	config.shardNum = 1;
+	bpm = new BufPageManager(fm, config);
+	long long loaded, total;
+	for (int i = 0; i < 1000; ++i) {
+		bpm->getWarmStats(loaded, total);
+		if (total > 0 && loaded == total) {
+			break;
+		}
+		this_thread::sleep_for(chrono::milliseconds(1));
+	}
+	bpm->resetStats();
+	int wrong = 0;
+	for (int p = 0; p < FILE_PAGES; p += HOT_STRIDE) {
+		PageGuard guard = bpm->getPageGuard(fileID, p);
+		wrong += guard.get()[0] != (unsigned)p;
+	}
+	long long hits, misses;
+	bpm->getStats(hits, misses);
+	printf("%-6s readahead %-3s  dumped %d  warmed %lld/%lld  hot misses %lld  wrong %d\n",
+		replacePolicyName(policy), readAhead ? "on" : "off", dumped, loaded, total, misses, wrong);
+	delete bpm;
+	fm->closeFile(fileID);
+	delete fm;
+	remove(name);
+	remove(dumpName);
+	return dumped && total == HOT_PAGES && misses == 0 && wrong == 0;
+}
+
+int main() {
+	MyBitMap::initConst();
+	bool ok = true;
+	for (ReplacePolicy policy : {LRU_REPLACE, CLOCK_REPLACE, LRU2_REPLACE, TWO_Q_REPLACE}) {
+		ok &= test(policy, true);
+	}
+	ok &= test(LRU_REPLACE, false);
+	if (ok) {
+		printf("ok\n");
+	}
+	return ok ? 0 : 1;
+}